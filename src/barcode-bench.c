@@ -0,0 +1,502 @@
+/*
+ *  barcode-bench.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Barcode microbenchmark (not installed).
+ *
+ * Every barcode style known to bc.c is timed with a typical payload (the
+ * style's default digits) and, for freeform styles, a long payload.  Each
+ * stage of getting a barcode onto a page is timed separately:
+ *
+ *   encode     backend encoding into a glBarcode, with the cache disabled
+ *   cached     gl_barcode_new() answered by the encode cache
+ *   measure    gl_barcode_measure()
+ *   image      drawing the barcode object onto an image surface
+ *   pdf        drawing onto a PDF surface, one page per barcode
+ *   recording  drawing onto a new recording surface
+ *
+ * Drawing goes through label-barcode.c, as when printing.  Results are the
+ * mean time per operation in microseconds, written to standard output as
+ * JSON (default) or CSV.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <cairo.h>
+#include <cairo-pdf.h>
+
+#include <libglabels.h>
+#include "label.h"
+#include "label-barcode.h"
+#include "text-node.h"
+#include "bc.h"
+#include "prefs.h"
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+/* Image surface resolution. */
+#define IMAGE_DPI 300.0
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef enum {
+        STAGE_ENCODE,
+        STAGE_CACHED,
+        STAGE_MEASURE,
+        STAGE_IMAGE,
+        STAGE_PDF,
+        STAGE_RECORDING,
+
+        N_STAGES
+} BenchStage;
+
+typedef struct {
+        const gchar         *id;
+        const gchar         *payload;
+        gint                 length;
+        gboolean             valid;
+        gdouble              us[N_STAGES];
+} BenchResult;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static const gchar *stage_names[N_STAGES] = {
+        "encode", "cached", "measure", "image", "pdf", "recording"
+};
+
+static gint     n_iterations     = 100;
+static gint     long_length      = 100;
+static gchar    *format          = "json";
+static gchar    *style           = NULL;
+
+static GOptionEntry option_entries[] = {
+        {"iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+         "number of times each stage is timed (default=100)", "count"},
+        {"long", 'l', 0, G_OPTION_ARG_INT, &long_length,
+         "digits in long payload of freeform styles (default=100)", "digits"},
+        {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+         "output format, \"json\" or \"csv\" (default=\"json\")", "format"},
+        {"style", 's', 0, G_OPTION_ARG_STRING, &style,
+         "only time given barcode style id", "id"},
+        { NULL }
+};
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void     bench_payload         (glLabel             *label,
+                                       const gchar         *id,
+                                       const gchar         *payload,
+                                       gchar               *digits,
+                                       GList              **results);
+
+static gdouble  bench_draw            (glLabelObject       *object,
+                                       BenchStage           stage);
+
+static cairo_status_t null_write      (void                *closure,
+                                       const unsigned char *data,
+                                       unsigned int         length);
+
+static void     print_json            (GList               *results);
+
+static void     print_csv             (GList               *results);
+
+
+
+/*****************************************************************************/
+/* Main.                                                                     */
+/*****************************************************************************/
+int
+main (int argc, char **argv)
+{
+        GOptionContext *option_context;
+        GError         *error = NULL;
+        glLabel        *label;
+        GList          *styles, *p;
+        GHashTable     *seen;
+        const gchar    *id;
+        GList          *results = NULL;
+
+        option_context = g_option_context_new (NULL);
+        g_option_context_set_summary (option_context,
+                                      "Time barcode encoding and drawing for every barcode style.");
+        g_option_context_add_main_entries (option_context, option_entries, NULL);
+
+        g_type_init ();
+        if (!g_option_context_parse (option_context, &argc, &argv, &error))
+        {
+                g_printerr ("%s\n", error->message);
+                g_error_free (error);
+                return 1;
+        }
+        g_option_context_free (option_context);
+
+        if ( (n_iterations < 1) || (long_length < 1) )
+        {
+                g_printerr ("Iterations and long payload digits must be positive.\n");
+                return 1;
+        }
+        if ( (strcmp (format, "json") != 0) && (strcmp (format, "csv") != 0) )
+        {
+                g_printerr ("Unknown format \"%s\", expected \"json\" or \"csv\".\n", format);
+                return 1;
+        }
+
+        gl_debug_init ();
+        lgl_db_init ();
+        gl_prefs_init ();
+
+        label = GL_LABEL (gl_label_new ());
+
+        /* Names listed by more than one library resolve to the same style. */
+        seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+        styles = gl_barcode_get_styles_list ();
+        for ( p = styles; p != NULL; p = p->next )
+        {
+                id = gl_barcode_name_to_id ((gchar *)p->data);
+
+                if ( ((style != NULL) && (g_ascii_strcasecmp (style, id) != 0)) ||
+                     g_hash_table_lookup (seen, id) )
+                {
+                        continue;
+                }
+                g_hash_table_insert (seen, (gpointer)id, (gpointer)id);
+
+                bench_payload (label, id, "typical",
+                               gl_barcode_default_digits (id, gl_barcode_get_prefered_n (id)),
+                               &results);
+
+                if ( gl_barcode_can_freeform (id) )
+                {
+                        bench_payload (label, id, "long",
+                                       gl_barcode_default_digits (id, long_length),
+                                       &results);
+                }
+        }
+        gl_barcode_free_styles_list (styles);
+        g_hash_table_destroy (seen);
+
+        results = g_list_reverse (results);
+
+        if ( strcmp (format, "csv") == 0 )
+        {
+                print_csv (results);
+        }
+        else
+        {
+                print_json (results);
+        }
+
+        g_list_foreach (results, (GFunc)g_free, NULL);
+        g_list_free (results);
+        g_object_unref (label);
+
+        return 0;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Time all stages for one style and payload.  Takes digits.       */
+/*---------------------------------------------------------------------------*/
+static void
+bench_payload (glLabel      *label,
+               const gchar  *id,
+               const gchar  *payload,
+               gchar        *digits,
+               GList       **results)
+{
+        BenchResult          *result;
+        const glBarcodeStyle *bc_style;
+        gboolean              text_flag, checksum_flag;
+        glBarcode            *gbc;
+        GTimer               *timer;
+        gdouble               width, height;
+        glLabelObject        *object;
+        glTextNode           *text_node;
+        gint                  i;
+
+        result = g_new0 (BenchResult, 1);
+        result->id      = id;
+        result->payload = payload;
+        result->length  = strlen (digits);
+        *results = g_list_prepend (*results, result);
+
+        bc_style      = gl_barcode_style_lookup (id);
+        text_flag     = gl_barcode_can_text (id);
+        checksum_flag = gl_barcode_can_csum (id);
+
+        /* Encode, every time. */
+        gl_barcode_cache_set_enabled (FALSE);
+
+        gbc = gl_barcode_style_new (bc_style, text_flag, checksum_flag, 0, 0, digits);
+        result->valid = (gbc != NULL);
+        gl_barcode_free (&gbc);
+
+        if ( !result->valid )
+        {
+                gl_barcode_cache_set_enabled (TRUE);
+                g_free (digits);
+                return;
+        }
+
+        timer = g_timer_new ();
+        for ( i = 0; i < n_iterations; i++ )
+        {
+                gbc = gl_barcode_style_new (bc_style, text_flag, checksum_flag, 0, 0, digits);
+                gl_barcode_free (&gbc);
+        }
+        result->us[STAGE_ENCODE] = 1e6 * g_timer_elapsed (timer, NULL) / n_iterations;
+
+        gl_barcode_cache_set_enabled (TRUE);
+
+        /* Cache hits, once encoded. */
+        gbc = gl_barcode_style_new (bc_style, text_flag, checksum_flag, 0, 0, digits);
+        gl_barcode_free (&gbc);
+
+        g_timer_start (timer);
+        for ( i = 0; i < n_iterations; i++ )
+        {
+                gbc = gl_barcode_style_new (bc_style, text_flag, checksum_flag, 0, 0, digits);
+                gl_barcode_free (&gbc);
+        }
+        result->us[STAGE_CACHED] = 1e6 * g_timer_elapsed (timer, NULL) / n_iterations;
+
+        g_timer_start (timer);
+        for ( i = 0; i < n_iterations; i++ )
+        {
+                gl_barcode_style_measure (bc_style, text_flag, checksum_flag, 0, 0, digits,
+                                          &width, &height);
+        }
+        result->us[STAGE_MEASURE] = 1e6 * g_timer_elapsed (timer, NULL) / n_iterations;
+
+        g_timer_destroy (timer);
+
+        /* Draw as a label object, at its natural size. */
+        object = GL_LABEL_OBJECT (gl_label_barcode_new (label, FALSE));
+        gl_label_barcode_set_props (GL_LABEL_BARCODE (object), (gchar *)id,
+                                    text_flag, checksum_flag, result->length, FALSE);
+        text_node = gl_text_node_new_from_text (digits);
+        gl_label_barcode_set_data (GL_LABEL_BARCODE (object), text_node, FALSE);
+        gl_text_node_free (&text_node);
+
+        result->us[STAGE_IMAGE]     = bench_draw (object, STAGE_IMAGE);
+        result->us[STAGE_PDF]       = bench_draw (object, STAGE_PDF);
+        result->us[STAGE_RECORDING] = bench_draw (object, STAGE_RECORDING);
+
+        gl_label_delete_object (label, object);
+
+        g_free (digits);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Time drawing object onto one kind of surface.                   */
+/*---------------------------------------------------------------------------*/
+static gdouble
+bench_draw (glLabelObject *object,
+            BenchStage     stage)
+{
+        gdouble          w, h, scale;
+        cairo_surface_t *surface = NULL;
+        cairo_t         *cr = NULL;
+        GTimer          *timer;
+        gdouble          us;
+        gint             i;
+
+        gl_label_object_get_size (object, &w, &h);
+
+        switch (stage)
+        {
+        case STAGE_IMAGE:
+                scale   = IMAGE_DPI / 72.0;
+                surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                      ceil (w * scale), ceil (h * scale));
+                cr = cairo_create (surface);
+                cairo_scale (cr, scale, scale);
+                break;
+        case STAGE_PDF:
+                surface = cairo_pdf_surface_create_for_stream (null_write, NULL, w, h);
+                cr = cairo_create (surface);
+                break;
+        default:
+                break;
+        }
+
+        timer = g_timer_new ();
+        for ( i = 0; i < n_iterations; i++ )
+        {
+                if ( stage == STAGE_RECORDING )
+                {
+                        surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, NULL);
+                        cr = cairo_create (surface);
+                }
+
+                cairo_save (cr);
+                gl_label_object_draw (object, cr, FALSE, NULL);
+                cairo_restore (cr);
+
+                if ( stage == STAGE_PDF )
+                {
+                        cairo_show_page (cr);
+                }
+                else if ( stage == STAGE_RECORDING )
+                {
+                        cairo_destroy (cr);
+                        cairo_surface_destroy (surface);
+                }
+        }
+        if ( stage == STAGE_IMAGE )
+        {
+                cairo_surface_flush (surface);
+        }
+        us = 1e6 * g_timer_elapsed (timer, NULL) / n_iterations;
+        g_timer_destroy (timer);
+
+        if ( stage != STAGE_RECORDING )
+        {
+                cairo_destroy (cr);
+                cairo_surface_destroy (surface);
+        }
+
+        return us;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Discard PDF output.                                             */
+/*---------------------------------------------------------------------------*/
+static cairo_status_t
+null_write (void                *closure,
+            const unsigned char *data,
+            unsigned int         length)
+{
+        return CAIRO_STATUS_SUCCESS;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Print results as JSON.                                          */
+/*---------------------------------------------------------------------------*/
+static void
+print_json (GList *results)
+{
+        GList       *p;
+        BenchResult *result;
+        gint         i;
+
+        printf ("{\"iterations\": %d,\n \"results\": [", n_iterations);
+
+        for ( p = results; p != NULL; p = p->next )
+        {
+                result = (BenchResult *)p->data;
+
+                printf ("%s\n  {\"style\": \"%s\", \"payload\": \"%s\", \"length\": %d, \"valid\": %s",
+                        (p == results) ? "" : ",",
+                        result->id, result->payload, result->length,
+                        result->valid ? "true" : "false");
+
+                for ( i = 0; i < N_STAGES; i++ )
+                {
+                        if ( result->valid )
+                        {
+                                printf (", \"%s-us\": %.3f", stage_names[i], result->us[i]);
+                        }
+                        else
+                        {
+                                printf (", \"%s-us\": null", stage_names[i]);
+                        }
+                }
+
+                printf ("}");
+        }
+
+        printf ("]}\n");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Print results as CSV, one line per style and payload.           */
+/*---------------------------------------------------------------------------*/
+static void
+print_csv (GList *results)
+{
+        GList       *p;
+        BenchResult *result;
+        gint         i;
+
+        printf ("style,payload,length,valid");
+        for ( i = 0; i < N_STAGES; i++ )
+        {
+                printf (",%s-us", stage_names[i]);
+        }
+        printf ("\n");
+
+        for ( p = results; p != NULL; p = p->next )
+        {
+                result = (BenchResult *)p->data;
+
+                printf ("%s,%s,%d,%s", result->id, result->payload, result->length,
+                        result->valid ? "true" : "false");
+
+                for ( i = 0; i < N_STAGES; i++ )
+                {
+                        if ( result->valid )
+                        {
+                                printf (",%.3f", result->us[i]);
+                        }
+                        else
+                        {
+                                printf (",");
+                        }
+                }
+
+                printf ("\n");
+        }
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
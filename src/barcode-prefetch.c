@@ -0,0 +1,350 @@
+/*
+ *  barcode-prefetch.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Barcode pre-encoding for merge print jobs.
+ *
+ * While a sheet is being drawn, the merged barcodes of the next few records
+ * are encoded on a pool of worker threads.  Encoded symbols are handed to
+ * the renderer through the barcode encode cache (see bc.c): when the
+ * renderer reaches a record, gl_barcode_new() normally finds its symbols
+ * already there.
+ *
+ * Only the barcode properties are copied from the label, when the prefetch
+ * is created, so the workers never touch the label objects themselves.
+ * The records must stay put until the prefetch is freed.  Only barcode
+ * styles whose backend is reentrant are prefetched.
+ *
+ * Prefetching is off unless a program turns it on, after initializing
+ * threads, with gl_barcode_prefetch_enable().
+ *
+ * The look-ahead is a bounded window of records, sized so that the symbols
+ * it holds fit well within the encode cache.  Jobs for records that the
+ * renderer has already passed are dropped by the workers unencoded.
+ */
+
+#include <config.h>
+
+#include "barcode-prefetch.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "label-barcode.h"
+#include "bc.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+/* Symbols queued ahead of the renderer, half of the encode cache in bc.c. */
+#define MAX_AHEAD_SYMBOLS  128
+
+/* Records queued ahead of the renderer. */
+#define MAX_WINDOW          32
+
+#define MAX_WORKERS          8
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        const glBarcodeStyle *style;
+        gboolean             text_flag;
+        gboolean             checksum_flag;
+        gdouble              w;
+        gdouble              h;
+        glTextNode          *text_node;
+} PrefetchBarcode;
+
+struct _glBarcodePrefetch {
+        GThreadPool         *pool;
+
+        PrefetchBarcode     *barcodes;
+        gint                 n_barcodes;
+
+        gint                 window;
+        GQueue              *queued;      /* Records from renderer onward. */
+        GList               *p_next;      /* Next record to queue. */
+        gint                 i_next;      /* Sequence number of p_next. */
+        volatile gint        i_render;    /* Sequence number at renderer. */
+};
+
+typedef struct {
+        glMergeRecord       *record;
+        gint                 i;
+} PrefetchJob;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static gboolean prefetch_enabled = FALSE;
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void     prefetch_worker     (PrefetchJob       *job,
+                                     glBarcodePrefetch *prefetch);
+
+
+
+/*****************************************************************************/
+/* Allow merge print jobs to prefetch barcodes.  Threads must already be     */
+/* initialized.                                                              */
+/*****************************************************************************/
+void
+gl_barcode_prefetch_enable (void)
+{
+        g_return_if_fail (g_thread_supported ());
+
+        prefetch_enabled = TRUE;
+}
+
+
+/*****************************************************************************/
+/* Create barcode prefetch for merge print job of label.                     */
+/*                                                                           */
+/* Returns NULL if there is nothing to prefetch: prefetching has not been    */
+/* enabled, or the label has no merged barcodes of a reentrant style.        */
+/*****************************************************************************/
+glBarcodePrefetch *
+gl_barcode_prefetch_new (glLabel *label)
+{
+        glBarcodePrefetch *prefetch;
+        GArray            *barcodes;
+        const GList       *p;
+        glLabelObject     *object;
+        PrefetchBarcode    barcode;
+        gchar             *id;
+        guint              format_digits;
+        gint               n_workers;
+
+        if ( !prefetch_enabled )
+        {
+                return NULL;
+        }
+
+        gl_debug (DEBUG_PRINT, "START");
+
+        barcodes = g_array_new (FALSE, FALSE, sizeof (PrefetchBarcode));
+
+        for ( p = gl_label_get_object_list (label); p != NULL; p = p->next )
+        {
+                object = GL_LABEL_OBJECT (p->data);
+
+                if ( !GL_IS_LABEL_BARCODE (object) )
+                {
+                        continue;
+                }
+
+                barcode.style = gl_label_barcode_get_style (GL_LABEL_BARCODE (object));
+                if ( !gl_barcode_style_is_thread_safe (barcode.style) )
+                {
+                        /* Only ever encoded on the renderer's thread. */
+                        continue;
+                }
+
+                barcode.text_node = gl_label_barcode_get_data (GL_LABEL_BARCODE (object));
+                if ( !barcode.text_node->field_flag )
+                {
+                        /* Same symbol on every label, nothing to gain. */
+                        gl_text_node_free (&barcode.text_node);
+                        continue;
+                }
+
+                gl_label_barcode_get_props (GL_LABEL_BARCODE (object),
+                                            &id,
+                                            &barcode.text_flag,
+                                            &barcode.checksum_flag,
+                                            &format_digits);
+                g_free (id);
+
+                gl_label_object_get_size (object, &barcode.w, &barcode.h);
+
+                g_array_append_val (barcodes, barcode);
+        }
+
+        if ( barcodes->len == 0 )
+        {
+                g_array_free (barcodes, TRUE);
+
+                gl_debug (DEBUG_PRINT, "END");
+                return NULL;
+        }
+
+        prefetch = g_new0 (glBarcodePrefetch, 1);
+
+        prefetch->n_barcodes = barcodes->len;
+        prefetch->barcodes   = (PrefetchBarcode *)g_array_free (barcodes, FALSE);
+
+        prefetch->window = CLAMP (MAX_AHEAD_SYMBOLS / prefetch->n_barcodes, 1, MAX_WINDOW);
+        prefetch->queued = g_queue_new ();
+
+        /* Leave a processor for the renderer. */
+        n_workers = CLAMP (sysconf (_SC_NPROCESSORS_ONLN) - 1, 1, MAX_WORKERS);
+        prefetch->pool = g_thread_pool_new ((GFunc)prefetch_worker, prefetch,
+                                            n_workers, FALSE, NULL);
+
+        gl_debug (DEBUG_PRINT, "END");
+
+        return prefetch;
+}
+
+
+/*****************************************************************************/
+/* Advance prefetch to the record about to be drawn.                         */
+/*                                                                           */
+/* Queues selected records following p_record, until the window is full.    */
+/* Drawing the same record again (copies) is cheap; if p_record is not in    */
+/* the window at all, e.g. when the records start over for the next copy,    */
+/* the window is restarted there.                                            */
+/*****************************************************************************/
+void
+gl_barcode_prefetch_advance (glBarcodePrefetch *prefetch,
+                             GList             *p_record)
+{
+        glMergeRecord *record;
+        PrefetchJob   *job;
+
+        if ( prefetch == NULL )
+        {
+                return;
+        }
+
+        while ( !g_queue_is_empty (prefetch->queued) &&
+                (g_queue_peek_head (prefetch->queued) != p_record->data) )
+        {
+                g_queue_pop_head (prefetch->queued);
+        }
+
+        if ( g_queue_is_empty (prefetch->queued) )
+        {
+                prefetch->p_next = p_record;
+        }
+
+        g_atomic_int_set (&prefetch->i_render,
+                          prefetch->i_next - (gint)g_queue_get_length (prefetch->queued));
+
+        while ( (prefetch->p_next != NULL) &&
+                ((gint)g_queue_get_length (prefetch->queued) < prefetch->window) )
+        {
+                record = (glMergeRecord *)prefetch->p_next->data;
+
+                if ( record->select_flag )
+                {
+                        job = g_new0 (PrefetchJob, 1);
+                        job->record = record;
+                        job->i      = prefetch->i_next++;
+
+                        g_queue_push_tail (prefetch->queued, record);
+                        g_thread_pool_push (prefetch->pool, job, NULL);
+                }
+
+                prefetch->p_next = prefetch->p_next->next;
+        }
+}
+
+
+/*****************************************************************************/
+/* Free barcode prefetch, waiting for any job already being encoded.         */
+/*****************************************************************************/
+void
+gl_barcode_prefetch_free (glBarcodePrefetch *prefetch)
+{
+        gint i;
+
+        if ( prefetch == NULL )
+        {
+                return;
+        }
+
+        gl_debug (DEBUG_PRINT, "START");
+
+        /* Everything still queued is stale now: let the workers drain the
+         * queue, so each job is freed without being encoded. */
+        g_atomic_int_set (&prefetch->i_render, G_MAXINT);
+        g_thread_pool_free (prefetch->pool, FALSE, TRUE);
+
+        for ( i = 0; i < prefetch->n_barcodes; i++ )
+        {
+                gl_text_node_free (&prefetch->barcodes[i].text_node);
+        }
+        g_free (prefetch->barcodes);
+
+        g_queue_free (prefetch->queued);
+        g_free (prefetch);
+
+        gl_debug (DEBUG_PRINT, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Worker: encode the barcodes of one record into the cache.       */
+/*---------------------------------------------------------------------------*/
+static void
+prefetch_worker (PrefetchJob       *job,
+                 glBarcodePrefetch *prefetch)
+{
+        PrefetchBarcode *barcode;
+        gchar           *text;
+        glBarcode       *gbc;
+        gint             i;
+
+        if ( job->i >= g_atomic_int_get (&prefetch->i_render) )
+        {
+                for ( i = 0; i < prefetch->n_barcodes; i++ )
+                {
+                        barcode = &prefetch->barcodes[i];
+
+                        text = gl_text_node_expand (barcode->text_node, job->record);
+                        gbc  = gl_barcode_style_new (barcode->style,
+                                                     barcode->text_flag,
+                                                     barcode->checksum_flag,
+                                                     barcode->w,
+                                                     barcode->h,
+                                                     text);
+                        gl_barcode_free (&gbc);
+                        g_free (text);
+                }
+        }
+
+        g_free (job);
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
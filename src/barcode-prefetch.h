@@ -0,0 +1,57 @@
+/*
+ *  barcode-prefetch.h
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BARCODE_PREFETCH_H__
+#define __BARCODE_PREFETCH_H__
+
+#include <glib.h>
+
+#include "label.h"
+
+G_BEGIN_DECLS
+
+
+typedef struct _glBarcodePrefetch glBarcodePrefetch;
+
+
+void                gl_barcode_prefetch_enable         (void);
+
+glBarcodePrefetch  *gl_barcode_prefetch_new            (glLabel             *label);
+
+void                gl_barcode_prefetch_advance        (glBarcodePrefetch   *prefetch,
+                                                        GList               *p_record);
+
+void                gl_barcode_prefetch_free           (glBarcodePrefetch   *prefetch);
+
+
+G_END_DECLS
+
+#endif /* __BARCODE_PREFETCH_H__ */
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
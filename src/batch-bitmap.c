@@ -0,0 +1,494 @@
+/*
+ *  batch-bitmap.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Bitmap output: each label of a job is drawn at the printer's resolution,
+ * reduced to one bit per dot (by a fixed threshold or an ordered dither) and
+ * written to a single raster stream, as used by roll label printers that
+ * take one line of dots at a time.
+ *
+ * Stream format (all integers are unsigned, big-endian):
+ *
+ *   label:  'L' width(16) height(16) compression(8)  line...  0x0C
+ *   line:   'G' length(16) data                      dots of one line
+ *           'Z'                                      blank line
+ *
+ * Width and height are in dots; each line holds (width+7)/8 bytes, 8 dots
+ * per byte, most significant bit first, 1 for black.  With compression 1
+ * line data is PackBits encoded, and length is that of the encoded data.
+ */
+
+#include <config.h>
+
+#include "batch-bitmap.h"
+
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <cairo.h>
+
+#include <libglabels.h>
+#include "print.h"
+#include "stats.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define BITMAP_LABEL        'L'
+#define BITMAP_LINE         'G'
+#define BITMAP_BLANK_LINE   'Z'
+#define BITMAP_END_LABEL    0x0C
+
+#define MAX_PACKBITS_RUN    128
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        glLabel             *label;
+        glBatchJob          *job;
+        glPrintState         state;
+        gboolean             rle_flag;
+        gdouble              scale;       /* Dots per point. */
+        gint                 width;       /* Size of label, in dots. */
+        gint                 height;
+        gint                 row_bytes;
+        guint8               thresholds[8][8];
+        guint8              *row;
+        GByteArray          *packed_row;
+} BitmapJob;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+/* 8x8 Bayer matrix. */
+static const guint8 bayer[8][8] = {
+        {  0, 32,  8, 40,  2, 34, 10, 42 },
+        { 48, 16, 56, 24, 50, 18, 58, 26 },
+        { 12, 44,  4, 36, 14, 46,  6, 38 },
+        { 60, 28, 52, 20, 62, 30, 54, 22 },
+        {  3, 35, 11, 43,  1, 33,  9, 41 },
+        { 51, 19, 59, 27, 49, 17, 57, 25 },
+        { 15, 47,  7, 39, 13, 45,  5, 37 },
+        { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void       render_label      (BitmapJob       *bj,
+                                     glMergeRecord   *record,
+                                     GByteArray      *stream);
+
+static void       pack_row          (const guint32   *pixels,
+                                     gint             width,
+                                     const guint8    *thresholds,
+                                     guint8          *row);
+
+static void       packbits          (const guint8    *data,
+                                     gint             n,
+                                     GByteArray      *packed);
+
+static void       append_uint16     (GByteArray      *stream,
+                                     guint            value);
+
+
+/*****************************************************************************/
+/* Parse dither name.                                                        */
+/*****************************************************************************/
+gboolean
+gl_batch_bitmap_parse_dither (const gchar         *string,
+                              glBatchBitmapDither *dither)
+{
+        if ( g_ascii_strcasecmp (string, "threshold") == 0 )
+        {
+                *dither = BATCH_BITMAP_DITHER_THRESHOLD;
+                return TRUE;
+        }
+        if ( g_ascii_strcasecmp (string, "ordered") == 0 )
+        {
+                *dither = BATCH_BITMAP_DITHER_ORDERED;
+                return TRUE;
+        }
+
+        return FALSE;
+}
+
+
+/*****************************************************************************/
+/* Render job as a bitmap raster stream, one image per label.                */
+/*                                                                           */
+/* With merge data each selected record is printed n_copies times in a row;  */
+/* without, a single label is printed once per label of n_sheets sheets.     */
+/* Identical labels are only drawn once.                                     */
+/*****************************************************************************/
+gboolean
+gl_batch_bitmap_run (glBatchJob          *job,
+                     glLabel             *label,
+                     glBatchBitmapDither  dither,
+                     gdouble              dpi,
+                     gboolean             rle_flag,
+                     glBatchJobResult    *result)
+{
+        GTimer            *timer;
+        const lglTemplate *template;
+        lglTemplateFrame  *frame;
+        glMerge           *merge;
+        const GList       *p;
+        glMergeRecord     *record;
+        BitmapJob          bj;
+        GByteArray        *stream;
+        gchar             *abs_fn;
+        FILE              *fp;
+        glStatsMark        mark;
+        gdouble            w, h;
+        gint               x, y, i, n_copies, n_labels = 0;
+        gboolean           ok = TRUE;
+
+        gl_debug (DEBUG_PRINT, "START");
+
+        timer = g_timer_new ();
+
+        memset (result, 0, sizeof (glBatchJobResult));
+
+        gl_batch_job_apply_input (job, label);
+
+        gl_stats_mark (&mark);
+
+        template = gl_label_get_template (label);
+        frame    = (lglTemplateFrame *)template->frames->data;
+        merge    = gl_label_get_merge (label);
+
+        lgl_template_frame_get_size (frame, &w, &h);
+
+        bj.label      = label;
+        bj.job        = job;
+        bj.rle_flag   = rle_flag;
+        bj.scale      = dpi / 72.0;
+        bj.width      = ceil (w * bj.scale);
+        bj.height     = ceil (h * bj.scale);
+        bj.row_bytes  = (bj.width + 7) / 8;
+        bj.row        = g_new0 (guint8, bj.row_bytes);
+        bj.packed_row = g_byte_array_new ();
+        gl_print_state_init (&bj.state);
+
+        for ( y = 0; y < 8; y++ )
+        {
+                for ( x = 0; x < 8; x++ )
+                {
+                        if ( dither == BATCH_BITMAP_DITHER_ORDERED )
+                        {
+                                bj.thresholds[y][x] = bayer[y][x] * 4 + 2;
+                        }
+                        else
+                        {
+                                bj.thresholds[y][x] = 128;
+                        }
+                }
+        }
+
+        abs_fn = gl_batch_job_output_filename (job, ".bin");
+
+        fp = g_fopen (abs_fn, "wb");
+        if ( fp == NULL )
+        {
+                fprintf ( stderr, _("cannot write %s\n"), abs_fn );
+                ok = FALSE;
+        }
+
+        stream = g_byte_array_new ();
+
+        for ( p = (merge != NULL) ? gl_merge_get_record_list (merge) : NULL;
+              ok && ((merge == NULL) || (p != NULL));
+              p = (p != NULL) ? p->next : NULL )
+        {
+                if ( merge != NULL )
+                {
+                        record = (glMergeRecord *)p->data;
+                        if ( !record->select_flag )
+                        {
+                                continue;
+                        }
+                        n_copies = job->n_copies;
+                }
+                else
+                {
+                        record   = NULL;
+                        n_copies = job->n_sheets * lgl_template_frame_get_n_labels (frame);
+                }
+
+                g_byte_array_set_size (stream, 0);
+                render_label (&bj, record, stream);
+
+                for ( i = 0; i < n_copies; i++ )
+                {
+                        if ( fwrite (stream->data, 1, stream->len, fp) != stream->len )
+                        {
+                                ok = FALSE;
+                                break;
+                        }
+                        n_labels++;
+                }
+
+                if ( merge == NULL )
+                {
+                        break;
+                }
+        }
+
+        if ( fp != NULL )
+        {
+                if ( (fclose (fp) != 0) || !ok )
+                {
+                        fprintf ( stderr, _("cannot write %s\n"), abs_fn );
+                        ok = FALSE;
+                }
+        }
+
+        g_byte_array_free (stream, TRUE);
+        g_byte_array_free (bj.packed_row, TRUE);
+        g_free (bj.row);
+        g_free (abs_fn);
+        gl_print_state_clear (&bj.state);
+        if ( merge != NULL )
+        {
+                g_object_unref (merge);
+        }
+
+        gl_stats_add_phase (GL_STATS_PHASE_OUTPUT, &mark);
+
+        result->status      = ok ? BATCH_JOB_OK : BATCH_JOB_ERROR_WRITE;
+        result->n_sheets    = n_labels;
+        result->n_labels    = n_labels;
+        result->render_time = g_timer_elapsed (timer, NULL);
+
+        gl_stats_add_output (result->n_sheets, result->n_labels);
+        g_timer_destroy (timer);
+
+        gl_debug (DEBUG_PRINT, "END");
+
+        return ok;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw one label and append it to stream.                         */
+/*---------------------------------------------------------------------------*/
+static void
+render_label (BitmapJob     *bj,
+              glMergeRecord *record,
+              GByteArray    *stream)
+{
+        cairo_surface_t *surface;
+        cairo_t         *cr;
+        guchar          *data;
+        gint             stride, y, i;
+        gboolean         blank;
+        guint8           header[1];
+
+        surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, bj->width, bj->height);
+        cr = cairo_create (surface);
+
+        cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+        cairo_paint (cr);
+        cairo_scale (cr, bj->scale, bj->scale);
+
+        gl_print_label (bj->label, cr, record,
+                        bj->job->outline_flag, bj->job->reverse_flag, &bj->state);
+
+        cairo_destroy (cr);
+        cairo_surface_flush (surface);
+
+        data   = cairo_image_surface_get_data (surface);
+        stride = cairo_image_surface_get_stride (surface);
+
+        header[0] = BITMAP_LABEL;
+        g_byte_array_append (stream, header, 1);
+        append_uint16 (stream, bj->width);
+        append_uint16 (stream, bj->height);
+        header[0] = bj->rle_flag ? 1 : 0;
+        g_byte_array_append (stream, header, 1);
+
+        for ( y = 0; y < bj->height; y++ )
+        {
+                pack_row ((const guint32 *)(data + y * stride), bj->width,
+                          bj->thresholds[y % 8], bj->row);
+
+                blank = TRUE;
+                for ( i = 0; blank && (i < bj->row_bytes); i++ )
+                {
+                        blank = (bj->row[i] == 0);
+                }
+
+                if ( blank )
+                {
+                        header[0] = BITMAP_BLANK_LINE;
+                        g_byte_array_append (stream, header, 1);
+                }
+                else if ( bj->rle_flag )
+                {
+                        g_byte_array_set_size (bj->packed_row, 0);
+                        packbits (bj->row, bj->row_bytes, bj->packed_row);
+
+                        header[0] = BITMAP_LINE;
+                        g_byte_array_append (stream, header, 1);
+                        append_uint16 (stream, bj->packed_row->len);
+                        g_byte_array_append (stream, bj->packed_row->data, bj->packed_row->len);
+                }
+                else
+                {
+                        header[0] = BITMAP_LINE;
+                        g_byte_array_append (stream, header, 1);
+                        append_uint16 (stream, bj->row_bytes);
+                        g_byte_array_append (stream, bj->row, bj->row_bytes);
+                }
+        }
+
+        header[0] = BITMAP_END_LABEL;
+        g_byte_array_append (stream, header, 1);
+
+        cairo_surface_destroy (surface);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Reduce one line of RGB24 pixels to packed bits.  A dot is black */
+/* if its luminance is below the threshold for its column (mod 8).           */
+/*                                                                           */
+/* Each output byte is built from 8 pixels without branches, so the inner    */
+/* loop is simple enough for the compiler to vectorize.                      */
+/*---------------------------------------------------------------------------*/
+static void
+pack_row (const guint32 *pixels,
+          gint           width,
+          const guint8  *thresholds,
+          guint8        *row)
+{
+        gint    x, k, n;
+        guint   byte, luminance;
+        guint32 pixel;
+
+        for ( x = 0; x < width; x += 8 )
+        {
+                n = MIN (8, width - x);
+
+                byte = 0;
+                for ( k = 0; k < n; k++ )
+                {
+                        pixel = pixels[x + k];
+                        luminance = (  77 * ((pixel >> 16) & 0xff)
+                                     + 150 * ((pixel >> 8) & 0xff)
+                                     +  29 * (pixel & 0xff) ) >> 8;
+
+                        byte |= (guint)(luminance < thresholds[k]) << (7 - k);
+                }
+
+                row[x / 8] = byte;
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  PackBits encode data.  A run of 2 to 128 equal bytes is encoded */
+/* as 1-n and the byte; 1 to 128 literal bytes as n-1 and the bytes.         */
+/*---------------------------------------------------------------------------*/
+static void
+packbits (const guint8 *data,
+          gint          n,
+          GByteArray   *packed)
+{
+        gint   i, start, run;
+        guint8 count;
+
+        i = 0;
+        while ( i < n )
+        {
+                run = 1;
+                while ( (i + run < n) && (run < MAX_PACKBITS_RUN) && (data[i + run] == data[i]) )
+                {
+                        run++;
+                }
+
+                if ( run > 1 )
+                {
+                        count = (guint8)(257 - run);
+                        g_byte_array_append (packed, &count, 1);
+                        g_byte_array_append (packed, &data[i], 1);
+                        i += run;
+                }
+                else
+                {
+                        start = i;
+                        while ( (i < n) && (i - start < MAX_PACKBITS_RUN) )
+                        {
+                                if ( (i + 1 < n) && (data[i] == data[i + 1]) )
+                                {
+                                        break;
+                                }
+                                i++;
+                        }
+
+                        count = (guint8)(i - start - 1);
+                        g_byte_array_append (packed, &count, 1);
+                        g_byte_array_append (packed, &data[start], i - start);
+                }
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Append 16 bit big-endian integer.                               */
+/*---------------------------------------------------------------------------*/
+static void
+append_uint16 (GByteArray *stream,
+               guint       value)
+{
+        guint8 bytes[2];
+
+        bytes[0] = (value >> 8) & 0xff;
+        bytes[1] = value & 0xff;
+
+        g_byte_array_append (stream, bytes, 2);
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -0,0 +1,1308 @@
+/*
+ *  batch-job.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "batch-job.h"
+
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <pango/pangocairo.h>
+
+#include <libglabels.h>
+#include "xml-label.h"
+#include "label-image.h"
+#include "text-node.h"
+#include "print.h"
+#include "print-op.h"
+#include "zpl.h"
+#include "stats.h"
+#include "file-util.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define DEFAULT_OUTPUT   "output.pdf"
+
+#define CHECKPOINT_GROUP "Checkpoint"
+
+#define HASH_SUFFIX      ".hash"
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static gboolean  print_sheets       (glBatchJob  *job,
+                                     glLabel     *label,
+                                     const gchar *filename,
+                                     gint         start_sheet,
+                                     gint         n_sheets_op);
+
+static gboolean  print_checkpointed (glBatchJob  *job,
+                                     glLabel     *label,
+                                     const gchar *abs_fn,
+                                     gint         n_sheets_total);
+
+static gboolean  checkpoint_read    (glBatchJob  *job,
+                                     const gchar *state_fn,
+                                     gint         n_sheets_total,
+                                     gint        *next_sheet,
+                                     gint        *next_shard);
+
+static void      checkpoint_write   (glBatchJob  *job,
+                                     const gchar *state_fn,
+                                     gint         n_sheets_total,
+                                     gint         next_sheet,
+                                     gint         next_record,
+                                     gint         next_shard);
+
+static gint      count_labels       (glBatchJob  *job,
+                                     glLabel     *label,
+                                     gint         start_sheet,
+                                     gint         n_sheets);
+
+static gchar    *compute_hash       (glBatchJob  *job,
+                                     glLabel     *label);
+
+static void      hash_string        (GChecksum   *checksum,
+                                     const gchar *string);
+
+static gboolean  hash_file          (GChecksum   *checksum,
+                                     const gchar *filename);
+
+static void      hash_font          (GChecksum   *checksum,
+                                     const gchar *family);
+
+static gchar    *get_string_member  (JsonObject  *object,
+                                     const gchar *name,
+                                     const gchar *default_value);
+
+static gint      get_int_member     (JsonObject  *object,
+                                     const gchar *name,
+                                     gint         default_value);
+
+static gboolean  get_boolean_member (JsonObject  *object,
+                                     const gchar *name,
+                                     gboolean     default_value);
+
+
+/*****************************************************************************/
+/* Create a new batch job with default options.                              */
+/*****************************************************************************/
+glBatchJob *
+gl_batch_job_new (void)
+{
+        glBatchJob *job;
+
+        job = g_new0 (glBatchJob, 1);
+
+        job->output   = g_strdup (DEFAULT_OUTPUT);
+        job->n_copies = 1;
+        job->n_sheets = 1;
+        job->first    = 1;
+
+        return job;
+}
+
+
+/*****************************************************************************/
+/* Create a new batch job from a JSON object.                                */
+/*                                                                           */
+/* Members are named after the long command line options ("label", "input",  */
+/* "output", "copies", "sheets", "first", "outline", "reverse", "cropmarks", */
+/* "incremental", and "pages" and "records" as range strings).               */
+/* Returns NULL and sets error_message if the object does not describe a job. */
+/*****************************************************************************/
+glBatchJob *
+gl_batch_job_new_from_json (JsonObject  *object,
+                            gchar      **error_message)
+{
+        glBatchJob *job;
+        gchar      *pages, *records;
+
+        if ( !json_object_has_member (object, "label") )
+        {
+                *error_message = g_strdup (_("missing \"label\""));
+                return NULL;
+        }
+
+        job = gl_batch_job_new ();
+
+        g_free (job->output);
+
+        job->label_filename  = get_string_member  (object, "label",     NULL);
+        job->input           = get_string_member  (object, "input",     NULL);
+        job->output          = get_string_member  (object, "output",    DEFAULT_OUTPUT);
+        job->n_copies        = get_int_member     (object, "copies",    1);
+        job->n_sheets        = get_int_member     (object, "sheets",    1);
+        job->first           = get_int_member     (object, "first",     1);
+        job->outline_flag    = get_boolean_member (object, "outline",   FALSE);
+        job->reverse_flag    = get_boolean_member (object, "reverse",   FALSE);
+        job->crop_marks_flag = get_boolean_member (object, "cropmarks", FALSE);
+        job->incremental_flag = get_boolean_member (object, "incremental", FALSE);
+        pages                = get_string_member  (object, "pages",     NULL);
+        records              = get_string_member  (object, "records",   NULL);
+
+        if ( (job->label_filename == NULL) || (job->output == NULL) )
+        {
+                *error_message = g_strdup (_("\"label\" and \"output\" must be strings"));
+                g_free (pages);
+                g_free (records);
+                gl_batch_job_free (job);
+                return NULL;
+        }
+
+        if ( ((pages != NULL) && !gl_batch_job_parse_range (pages, &job->first_page, &job->last_page)) ||
+             ((records != NULL) && !gl_batch_job_parse_range (records, &job->first_record, &job->last_record)) )
+        {
+                *error_message = g_strdup (_("\"pages\" and \"records\" must be ranges, e.g. \"5-10\""));
+                g_free (pages);
+                g_free (records);
+                gl_batch_job_free (job);
+                return NULL;
+        }
+        g_free (pages);
+        g_free (records);
+
+        if ( (job->n_copies < 1) || (job->n_sheets < 1) || (job->first < 1) )
+        {
+                *error_message = g_strdup (_("\"copies\", \"sheets\" and \"first\" must be positive"));
+                gl_batch_job_free (job);
+                return NULL;
+        }
+
+        return job;
+}
+
+
+/*****************************************************************************/
+/* Free batch job.                                                           */
+/*****************************************************************************/
+void
+gl_batch_job_free (glBatchJob *job)
+{
+        if ( job )
+        {
+                g_free (job->label_filename);
+                g_free (job->input);
+                g_free (job->output);
+                g_free (job->hash);
+                g_free (job);
+        }
+}
+
+
+/*****************************************************************************/
+/* Open label file of job.                                                   */
+/*****************************************************************************/
+glLabel *
+gl_batch_job_open_label (glBatchJob       *job,
+                         glBatchJobResult *result)
+{
+        glLabel          *label;
+        glXMLLabelStatus  status;
+        GTimer           *timer;
+        glStatsMark       mark;
+
+        timer = g_timer_new ();
+        gl_stats_mark (&mark);
+
+        label = gl_xml_label_open (job->label_filename, &status);
+
+        gl_stats_add_phase (GL_STATS_PHASE_LOAD, &mark);
+        result->load_time = g_timer_elapsed (timer, NULL);
+        g_timer_destroy (timer);
+
+        if ( status != XML_LABEL_OK )
+        {
+                fprintf ( stderr, _("cannot open glabels file %s\n"),
+                          job->label_filename );
+                result->status = BATCH_JOB_ERROR_OPEN_LABEL;
+                return NULL;
+        }
+
+        result->status = BATCH_JOB_OK;
+        return label;
+}
+
+
+/*****************************************************************************/
+/* Get total number of sheets of job.                                        */
+/*****************************************************************************/
+gint
+gl_batch_job_get_n_sheets (glBatchJob *job,
+                           glLabel    *label)
+{
+        glMerge           *merge;
+        const lglTemplate *template;
+        lglTemplateFrame  *frame;
+        gint               n_sheets;
+
+        merge    = gl_label_get_merge (label);
+        template = gl_label_get_template (label);
+        frame    = (lglTemplateFrame *)template->frames->data;
+
+        if (merge)
+        {
+                n_sheets = ceil ((double)(job->first-1 + job->n_copies * gl_merge_get_record_count(merge))
+                                 / lgl_template_frame_get_n_labels (frame));
+                g_object_unref (merge);
+        }
+        else
+        {
+                n_sheets = job->n_sheets;
+        }
+
+        return n_sheets;
+}
+
+
+/*****************************************************************************/
+/* Set merge source of label to job's input file and record range, if any.   */
+/*****************************************************************************/
+void
+gl_batch_job_apply_input (glBatchJob *job,
+                          glLabel    *label)
+{
+        glMerge     *merge;
+        gchar       *src;
+        glStatsMark  mark;
+        struct stat  st;
+
+        if ( (job->input == NULL) && (job->first_record == 0) )
+        {
+                return;
+        }
+
+        merge = gl_label_get_merge (label);
+        if (merge != NULL) {
+                gl_stats_mark (&mark);
+                src = (job->input != NULL) ? g_strdup (job->input) : gl_merge_get_src (merge);
+                gl_merge_set_src_range (merge, src, MAX (job->first_record, 1), job->last_record);
+                gl_label_set_merge(label, merge, FALSE);
+                gl_stats_add_phase (GL_STATS_PHASE_MERGE, &mark);
+                if ( gl_stats_enabled () &&
+                     (gl_merge_get_src_type (merge) == GL_MERGE_SRC_IS_FILE) &&
+                     (src != NULL) && (g_stat (src, &st) == 0) )
+                {
+                        gl_stats_add_merge_bytes (st.st_size);
+                }
+                g_object_unref (merge);
+                g_free (src);
+        } else {
+                fprintf ( stderr,
+                          _("cannot perform document merge with glabels file %s\n"),
+                          job->label_filename );
+        }
+}
+
+
+/*****************************************************************************/
+/* Check whether output of job is up to date.                                */
+/*                                                                           */
+/* Computes a content hash of everything the output depends on, keeps it in  */
+/* job->hash, and compares it with the hash saved next to the output by the  */
+/* last incremental print.                                                   */
+/*****************************************************************************/
+gboolean
+gl_batch_job_is_up_to_date (glBatchJob *job,
+                            glLabel    *label)
+{
+        gchar    *abs_fn, *hash_fn, *output_fn;
+        gchar    *saved_hash = NULL;
+        gboolean  ret;
+
+        g_free (job->hash);
+        job->hash = compute_hash (job, label);
+        if ( job->hash == NULL )
+        {
+                return FALSE;
+        }
+
+        abs_fn  = gl_file_util_make_absolute (job->output);
+        hash_fn = g_strconcat (abs_fn, HASH_SUFFIX, NULL);
+
+        /* A checkpointed job's output is its series of shards. */
+        if ( job->checkpoint > 0 )
+        {
+                output_fn = gl_batch_job_numbered_filename (abs_fn, 0);
+        }
+        else
+        {
+                output_fn = g_strdup (abs_fn);
+        }
+
+        ret = ( g_file_test (output_fn, G_FILE_TEST_EXISTS)
+                && g_file_get_contents (hash_fn, &saved_hash, NULL, NULL)
+                && (strcmp (g_strstrip (saved_hash), job->hash) == 0) );
+
+        g_free (saved_hash);
+        g_free (output_fn);
+        g_free (hash_fn);
+        g_free (abs_fn);
+
+        return ret;
+}
+
+
+/*****************************************************************************/
+/* Print job, using an already opened label.                                 */
+/*                                                                           */
+/* An incremental job is skipped if its output is up to date.  If the caller */
+/* has already checked with gl_batch_job_is_up_to_date(), it is not checked  */
+/* again.                                                                    */
+/*****************************************************************************/
+gboolean
+gl_batch_job_print (glBatchJob       *job,
+                    glLabel          *label,
+                    glBatchJobResult *result)
+{
+        gchar    *abs_fn;
+        gchar    *hash_fn = NULL;
+        gint      n_sheets_total, start_sheet, last_page;
+        GTimer   *timer;
+        glStatsMark mark;
+        gboolean  ok;
+
+        timer = g_timer_new ();
+
+        result->up_to_date = FALSE;
+
+        gl_batch_job_apply_input (job, label);
+
+        gl_stats_mark (&mark);
+
+        abs_fn = gl_file_util_make_absolute ( job->output );
+        n_sheets_total = gl_batch_job_get_n_sheets (job, label);
+
+        if (job->incremental_flag)
+        {
+                if ( (job->hash == NULL) && gl_batch_job_is_up_to_date (job, label) )
+                {
+                        result->up_to_date = TRUE;
+                }
+                else
+                {
+                        /* Old hash no longer describes output being replaced. */
+                        hash_fn = g_strconcat (abs_fn, HASH_SUFFIX, NULL);
+                        g_unlink (hash_fn);
+                }
+        }
+
+        start_sheet = 0;
+        last_page   = n_sheets_total;
+
+        if (result->up_to_date)
+        {
+                ok = TRUE;
+        }
+        else if (job->first_page > 0)
+        {
+                if (job->checkpoint > 0)
+                {
+                        fprintf ( stderr,
+                                  _("--checkpoint cannot be used with --pages, printing without checkpoints\n") );
+                }
+                if (job->first_page > n_sheets_total)
+                {
+                        fprintf ( stderr, _("%s: job has only %d sheets\n"),
+                                  job->label_filename, n_sheets_total );
+                        ok = FALSE;
+                }
+                else
+                {
+                        start_sheet = job->first_page - 1;
+                        if (job->last_page > 0)
+                        {
+                                last_page = MIN (job->last_page, n_sheets_total);
+                        }
+                        ok = print_sheets (job, label, abs_fn,
+                                           start_sheet, last_page - start_sheet);
+                }
+        }
+        else if (job->checkpoint > 0)
+        {
+                ok = print_checkpointed (job, label, abs_fn, n_sheets_total);
+        }
+        else
+        {
+                if (job->resume_flag)
+                {
+                        fprintf ( stderr,
+                                  _("--resume requires --checkpoint, printing from first sheet\n") );
+                }
+                ok = print_sheets (job, label, abs_fn, 0, n_sheets_total);
+        }
+
+        if ( ok && (hash_fn != NULL) && (job->hash != NULL) )
+        {
+                if ( !g_file_set_contents (hash_fn, job->hash, -1, NULL) )
+                {
+                        fprintf ( stderr, _("cannot write %s\n"), hash_fn );
+                }
+        }
+
+        g_free (hash_fn);
+        g_free (abs_fn);
+
+        if (!result->up_to_date)
+        {
+                gl_stats_add_phase (GL_STATS_PHASE_OUTPUT, &mark);
+        }
+
+        result->status      = ok ? BATCH_JOB_OK : BATCH_JOB_ERROR_WRITE;
+        result->n_sheets    = n_sheets_total;
+        result->n_labels    = (ok && !result->up_to_date)
+                ? count_labels (job, label, start_sheet, last_page - start_sheet) : 0;
+        result->render_time = g_timer_elapsed (timer, NULL);
+
+        if (ok && !result->up_to_date)
+        {
+                gl_stats_add_output (last_page - start_sheet, result->n_labels);
+        }
+        g_timer_destroy (timer);
+
+        return ok;
+}
+
+
+/*****************************************************************************/
+/* Open label and print job.                                                 */
+/*****************************************************************************/
+gboolean
+gl_batch_job_run (glBatchJob       *job,
+                  glBatchJobResult *result)
+{
+        glLabel  *label;
+        gboolean  ok;
+
+        memset (result, 0, sizeof (glBatchJobResult));
+
+        label = gl_batch_job_open_label (job, result);
+        if ( label == NULL )
+        {
+                return FALSE;
+        }
+
+        ok = gl_batch_job_print (job, label, result);
+
+        g_object_unref (label);
+
+        return ok;
+}
+
+
+/*****************************************************************************/
+/* Print job as ZPL, one label format per merge record (each with a print    */
+/* quantity of n_copies, i.e. collated).  Without merge data a single format */
+/* is printed once per label of n_sheets sheets.                             */
+/*****************************************************************************/
+gboolean
+gl_batch_job_print_zpl (glBatchJob       *job,
+                        glLabel          *label,
+                        gdouble           dpi,
+                        glBatchJobResult *result)
+{
+        const lglTemplate *template;
+        lglTemplateFrame  *frame;
+        glMerge           *merge;
+        const GList       *p;
+        glMergeRecord     *record;
+        GString           *zpl;
+        gchar             *abs_fn;
+        GTimer            *timer;
+        glStatsMark        mark;
+        gint               n_labels = 0;
+        gboolean           ok;
+
+        timer = g_timer_new ();
+
+        memset (result, 0, sizeof (glBatchJobResult));
+
+        gl_batch_job_apply_input (job, label);
+
+        gl_stats_mark (&mark);
+
+        template = gl_label_get_template (label);
+        frame    = (lglTemplateFrame *)template->frames->data;
+        merge    = gl_label_get_merge (label);
+
+        zpl = g_string_new ("");
+
+        if ( merge == NULL )
+        {
+                n_labels = job->n_sheets * lgl_template_frame_get_n_labels (frame);
+                gl_zpl_label (label, zpl, NULL, dpi, n_labels,
+                              job->outline_flag, job->reverse_flag);
+        }
+        else
+        {
+                for ( p = gl_merge_get_record_list (merge); p != NULL; p = p->next )
+                {
+                        record = (glMergeRecord *)p->data;
+                        if ( record->select_flag )
+                        {
+                                gl_zpl_label (label, zpl, record, dpi, job->n_copies,
+                                              job->outline_flag, job->reverse_flag);
+                                n_labels += job->n_copies;
+                        }
+                }
+                g_object_unref (merge);
+        }
+
+        abs_fn = gl_batch_job_output_filename (job, ".zpl");
+        ok = g_file_set_contents (abs_fn, zpl->str, zpl->len, NULL);
+        if ( !ok )
+        {
+                fprintf ( stderr, _("cannot write %s\n"), abs_fn );
+        }
+
+        g_free (abs_fn);
+        g_string_free (zpl, TRUE);
+
+        gl_stats_add_phase (GL_STATS_PHASE_OUTPUT, &mark);
+
+        result->status      = ok ? BATCH_JOB_OK : BATCH_JOB_ERROR_WRITE;
+        result->n_sheets    = n_labels;
+        result->n_labels    = n_labels;
+        result->render_time = g_timer_elapsed (timer, NULL);
+
+        gl_stats_add_output (result->n_sheets, result->n_labels);
+        g_timer_destroy (timer);
+
+        return ok;
+}
+
+
+/*****************************************************************************/
+/* Get absolute output filename, with a ".pdf" extension replaced by ext.    */
+/*****************************************************************************/
+gchar *
+gl_batch_job_output_filename (glBatchJob  *job,
+                              const gchar *ext)
+{
+        gchar *abs_fn, *stem, *filename;
+
+        abs_fn = gl_file_util_make_absolute (job->output);
+
+        if ( !g_str_has_suffix (abs_fn, ".pdf") && !g_str_has_suffix (abs_fn, ".PDF") )
+        {
+                return abs_fn;
+        }
+
+        stem = g_strndup (abs_fn, strlen (abs_fn) - strlen (".pdf"));
+        filename = g_strconcat (stem, ext, NULL);
+
+        g_free (stem);
+        g_free (abs_fn);
+
+        return filename;
+}
+
+
+/*****************************************************************************/
+/* Parse a range "N", "N-M" or "N-" (to the end, last set to 0).  Numbers    */
+/* are 1 based.  Returns FALSE if string is not a valid range.               */
+/*****************************************************************************/
+gboolean
+gl_batch_job_parse_range (const gchar *string,
+                          gint        *first,
+                          gint        *last)
+{
+        gchar  *end;
+        gint64  n1, n2;
+
+        n1 = g_ascii_strtoll (string, &end, 10);
+        if ( (end == string) || (n1 < 1) || (n1 > G_MAXINT) )
+        {
+                return FALSE;
+        }
+
+        if ( *end == '\0' )
+        {
+                n2 = n1;
+        }
+        else if ( *end == '-' )
+        {
+                string = end + 1;
+                if ( *string == '\0' )
+                {
+                        n2 = 0;
+                }
+                else
+                {
+                        n2 = g_ascii_strtoll (string, &end, 10);
+                        if ( (end == string) || (*end != '\0') || (n2 < n1) || (n2 > G_MAXINT) )
+                        {
+                                return FALSE;
+                        }
+                }
+        }
+        else
+        {
+                return FALSE;
+        }
+
+        *first = n1;
+        *last  = n2;
+
+        return TRUE;
+}
+
+
+/*****************************************************************************/
+/* Construct filename of n'th of a series, e.g. "output-0003.pdf".           */
+/*****************************************************************************/
+gchar *
+gl_batch_job_numbered_filename (const gchar *abs_fn,
+                                gint         n)
+{
+        gchar *basename, *dirname, *ext, *stem;
+        gchar *numbered_basename, *numbered_fn;
+
+        dirname  = g_path_get_dirname (abs_fn);
+        basename = g_path_get_basename (abs_fn);
+
+        ext = strrchr (basename, '.');
+        if ( (ext != NULL) && (ext != basename) )
+        {
+                stem = g_strndup (basename, ext - basename);
+                numbered_basename = g_strdup_printf ("%s-%04d%s", stem, n, ext);
+                g_free (stem);
+        }
+        else
+        {
+                numbered_basename = g_strdup_printf ("%s-%04d", basename, n);
+        }
+
+        numbered_fn = g_build_filename (dirname, numbered_basename, NULL);
+
+        g_free (numbered_basename);
+        g_free (basename);
+        g_free (dirname);
+
+        return numbered_fn;
+}
+
+
+/*****************************************************************************/
+/* Get description of job status.                                            */
+/*****************************************************************************/
+const gchar *
+gl_batch_job_status_message (glBatchJobStatus status)
+{
+        switch (status)
+        {
+        case BATCH_JOB_OK:
+                return _("OK");
+        case BATCH_JOB_ERROR_OPEN_LABEL:
+                return _("cannot open glabels file");
+        case BATCH_JOB_ERROR_WRITE:
+                return _("cannot write output");
+        default:
+                return _("unknown error");
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Print a run of sheets to given file.                            */
+/*---------------------------------------------------------------------------*/
+static gboolean
+print_sheets (glBatchJob  *job,
+              glLabel     *label,
+              const gchar *filename,
+              gint         start_sheet,
+              gint         n_sheets_op)
+{
+        const lglTemplate       *template;
+        lglTemplateFrame        *frame;
+        glPrintOp               *print_op;
+        GtkPrintOperationResult  result;
+        GError                  *error = NULL;
+        glMerge                 *merge;
+
+        template = gl_label_get_template (label);
+        frame = (lglTemplateFrame *)template->frames->data;
+
+        print_op = gl_print_op_new (label);
+        gl_print_op_set_filename        (print_op, (gchar *)filename);
+        gl_print_op_set_n_copies        (print_op, job->n_copies);
+        gl_print_op_set_first           (print_op, job->first);
+        gl_print_op_set_outline_flag    (print_op, job->outline_flag);
+        gl_print_op_set_reverse_flag    (print_op, job->reverse_flag);
+        gl_print_op_set_crop_marks_flag (print_op, job->crop_marks_flag);
+        gl_print_op_set_start_sheet     (print_op, start_sheet);
+        gl_print_op_set_n_sheets        (print_op, n_sheets_op);
+        merge = gl_label_get_merge (label);
+        if (!merge)
+        {
+                gl_print_op_set_last    (print_op,
+                                         lgl_template_frame_get_n_labels (frame));
+        }
+        else
+        {
+                g_object_unref (merge);
+        }
+
+        result = gtk_print_operation_run (GTK_PRINT_OPERATION (print_op),
+                                          GTK_PRINT_OPERATION_ACTION_EXPORT,
+                                          NULL,
+                                          &error);
+
+        g_object_unref (print_op);
+
+        if (result == GTK_PRINT_OPERATION_RESULT_ERROR)
+        {
+                fprintf ( stderr, _("cannot write %s: %s\n"),
+                          filename, error ? error->message : "" );
+                if (error)
+                {
+                        g_error_free (error);
+                }
+                return FALSE;
+        }
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Print job as a series of shards, checkpointing after each.      */
+/*                                                                           */
+/* Each shard of "checkpoint" sheets is written to its own output file, so   */
+/* that every completed shard is a valid document even if the job dies.      */
+/* After a shard is written, the next sheet (and its first record) is saved  */
+/* to a state file next to the output; --resume picks up from there.         */
+/*---------------------------------------------------------------------------*/
+static gboolean
+print_checkpointed (glBatchJob  *job,
+                    glLabel     *label,
+                    const gchar *abs_fn,
+                    gint         n_sheets_total)
+{
+        gchar        *state_fn;
+        gchar        *shard_fn;
+        gint          start_sheet = 0;
+        gint          i_shard     = 0;
+        gint          next_record = -1;
+        gint          n;
+        gboolean      merge_flag;
+        glMerge      *merge;
+        glPrintState  state;
+
+        merge = gl_label_get_merge (label);
+        merge_flag = (merge != NULL);
+        if (merge)
+        {
+                g_object_unref (merge);
+        }
+
+        gl_print_state_init (&state);
+        state_fn = g_strdup_printf ("%s.checkpoint", abs_fn);
+
+        if (job->resume_flag)
+        {
+                if ( checkpoint_read (job, state_fn, n_sheets_total,
+                                      &start_sheet, &i_shard) )
+                {
+                        fprintf ( stderr, _("resuming %s at sheet %d of %d\n"),
+                                  job->label_filename, start_sheet+1, n_sheets_total );
+                }
+                else
+                {
+                        fprintf ( stderr, _("no usable checkpoint for %s, printing from first sheet\n"),
+                                  job->label_filename );
+                }
+        }
+
+        while (start_sheet < n_sheets_total)
+        {
+                n = MIN (job->checkpoint, n_sheets_total - start_sheet);
+
+                shard_fn = gl_batch_job_numbered_filename (abs_fn, i_shard);
+                if ( !print_sheets (job, label, shard_fn, start_sheet, n) )
+                {
+                        /* Leave checkpoint at last good shard. */
+                        g_free (shard_fn);
+                        g_free (state_fn);
+                        gl_print_state_clear (&state);
+                        return FALSE;
+                }
+                g_free (shard_fn);
+
+                start_sheet += n;
+                i_shard++;
+
+                if (merge_flag)
+                {
+                        next_record = gl_print_state_seek_sheet (label, &state, start_sheet,
+                                                                 job->n_copies, job->first, FALSE);
+                }
+
+                checkpoint_write (job, state_fn, n_sheets_total,
+                                  start_sheet, next_record, i_shard);
+        }
+
+        /* Job complete, nothing left to resume. */
+        g_unlink (state_fn);
+        g_free (state_fn);
+        gl_print_state_clear (&state);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Read checkpoint state file.                                     */
+/*---------------------------------------------------------------------------*/
+static gboolean
+checkpoint_read (glBatchJob  *job,
+                 const gchar *state_fn,
+                 gint         n_sheets_total,
+                 gint        *next_sheet,
+                 gint        *next_shard)
+{
+        GKeyFile *key_file;
+        gchar    *saved_label, *saved_input;
+        gboolean  ok;
+
+        key_file = g_key_file_new ();
+
+        if ( !g_key_file_load_from_file (key_file, state_fn, G_KEY_FILE_NONE, NULL) )
+        {
+                g_key_file_free (key_file);
+                return FALSE;
+        }
+
+        /* Only resume the same job: same label, merge source and layout. */
+        saved_label = g_key_file_get_string (key_file, CHECKPOINT_GROUP, "label", NULL);
+        saved_input = g_key_file_get_string (key_file, CHECKPOINT_GROUP, "input", NULL);
+        ok = ( (g_strcmp0 (saved_label, job->label_filename) == 0)
+               && (g_strcmp0 (saved_input, job->input ? job->input : "") == 0)
+               && (g_key_file_get_integer (key_file, CHECKPOINT_GROUP, "sheets", NULL) == n_sheets_total)
+               && (g_key_file_get_integer (key_file, CHECKPOINT_GROUP, "shard-sheets", NULL) == job->checkpoint)
+               && (g_key_file_get_integer (key_file, CHECKPOINT_GROUP, "copies", NULL) == job->n_copies)
+               && (g_key_file_get_integer (key_file, CHECKPOINT_GROUP, "first", NULL) == job->first) );
+
+        if (ok)
+        {
+                *next_sheet = g_key_file_get_integer (key_file, CHECKPOINT_GROUP, "next-sheet", NULL);
+                *next_shard = g_key_file_get_integer (key_file, CHECKPOINT_GROUP, "next-shard", NULL);
+                ok = (*next_sheet >= 0) && (*next_shard >= 0);
+        }
+
+        if (!ok)
+        {
+                *next_sheet = 0;
+                *next_shard = 0;
+        }
+
+        g_free (saved_label);
+        g_free (saved_input);
+        g_key_file_free (key_file);
+
+        return ok;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Write checkpoint state file.                                    */
+/*---------------------------------------------------------------------------*/
+static void
+checkpoint_write (glBatchJob  *job,
+                  const gchar *state_fn,
+                  gint         n_sheets_total,
+                  gint         next_sheet,
+                  gint         next_record,
+                  gint         next_shard)
+{
+        GKeyFile *key_file;
+        gchar    *data;
+        gsize     length;
+        GError   *error = NULL;
+
+        key_file = g_key_file_new ();
+
+        g_key_file_set_string  (key_file, CHECKPOINT_GROUP, "label",        job->label_filename);
+        g_key_file_set_string  (key_file, CHECKPOINT_GROUP, "input",        job->input ? job->input : "");
+        g_key_file_set_integer (key_file, CHECKPOINT_GROUP, "sheets",       n_sheets_total);
+        g_key_file_set_integer (key_file, CHECKPOINT_GROUP, "shard-sheets", job->checkpoint);
+        g_key_file_set_integer (key_file, CHECKPOINT_GROUP, "copies",       job->n_copies);
+        g_key_file_set_integer (key_file, CHECKPOINT_GROUP, "first",        job->first);
+        g_key_file_set_integer (key_file, CHECKPOINT_GROUP, "next-sheet",   next_sheet);
+        g_key_file_set_integer (key_file, CHECKPOINT_GROUP, "next-record",  next_record);
+        g_key_file_set_integer (key_file, CHECKPOINT_GROUP, "next-shard",   next_shard);
+
+        data = g_key_file_to_data (key_file, &length, NULL);
+
+        /* g_file_set_contents() replaces the file atomically, so an
+         * interrupted write never leaves a truncated checkpoint. */
+        if ( !g_file_set_contents (state_fn, data, length, &error) )
+        {
+                fprintf ( stderr, _("cannot write checkpoint %s: %s\n"),
+                          state_fn, error->message );
+                g_error_free (error);
+        }
+
+        g_free (data);
+        g_key_file_free (key_file);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Count labels printed on n_sheets sheets, from start_sheet.      */
+/*---------------------------------------------------------------------------*/
+static gint
+count_labels (glBatchJob *job,
+              glLabel    *label,
+              gint        start_sheet,
+              gint        n_sheets)
+{
+        const lglTemplate *template;
+        lglTemplateFrame  *frame;
+        glMerge           *merge;
+        gint               n_per_sheet, begin, end;
+
+        template    = gl_label_get_template (label);
+        frame       = (lglTemplateFrame *)template->frames->data;
+        n_per_sheet = lgl_template_frame_get_n_labels (frame);
+
+        merge = gl_label_get_merge (label);
+        if ( merge == NULL )
+        {
+                return n_sheets * (n_per_sheet - (job->first - 1));
+        }
+
+        /* Label positions, counting the unused ones before first. */
+        begin = MAX (job->first - 1, start_sheet * n_per_sheet);
+        end   = MIN (job->first - 1 + job->n_copies * gl_merge_get_record_count (merge),
+                     (start_sheet + n_sheets) * n_per_sheet);
+
+        g_object_unref (merge);
+
+        return MAX (0, end - begin);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Compute content hash of job.                                    */
+/*                                                                           */
+/* Covers the print options, the label file (including its embedded         */
+/* images), the fonts it uses as resolved on this system, the merge records  */
+/* that are printed and any image files named by merge fields.  Returns NULL */
+/* if the label file cannot be read.                                         */
+/*---------------------------------------------------------------------------*/
+static gchar *
+compute_hash (glBatchJob *job,
+              glLabel    *label)
+{
+        GChecksum     *checksum;
+        GHashTable    *fonts, *files;
+        gchar         *options;
+        const GList   *p_obj, *p_record;
+        GList         *p, *p_field;
+        GList         *image_nodes = NULL;
+        glLabelObject *object;
+        glTextNode    *node;
+        glMerge       *merge;
+        glMergeRecord *record;
+        glMergeField  *field;
+        gchar         *family, *src, *filename;
+        gchar         *hash = NULL;
+
+        checksum = g_checksum_new (G_CHECKSUM_SHA256);
+        fonts    = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        files    = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+        options = g_strdup_printf ("glabels %s copies=%d sheets=%d first=%d outline=%d reverse=%d cropmarks=%d checkpoint=%d pages=%d-%d records=%d-%d",
+                                   VERSION, job->n_copies, job->n_sheets, job->first,
+                                   job->outline_flag, job->reverse_flag, job->crop_marks_flag,
+                                   job->checkpoint, job->first_page, job->last_page,
+                                   job->first_record, job->last_record);
+        hash_string (checksum, options);
+        g_free (options);
+
+        if ( !hash_file (checksum, job->label_filename) )
+        {
+                goto done;
+        }
+
+        for ( p_obj = gl_label_get_object_list (label); p_obj != NULL; p_obj = p_obj->next )
+        {
+                object = GL_LABEL_OBJECT (p_obj->data);
+
+                family = gl_label_object_get_font_family (object);
+                if ( (family != NULL) && !g_hash_table_lookup (fonts, family) )
+                {
+                        hash_font (checksum, family);
+                        g_hash_table_insert (fonts, family, family);
+                }
+                else
+                {
+                        g_free (family);
+                }
+
+                if ( GL_IS_LABEL_IMAGE (object) )
+                {
+                        node = gl_label_image_get_filename (GL_LABEL_IMAGE (object));
+                        if ( node->field_flag )
+                        {
+                                image_nodes = g_list_append (image_nodes, node);
+                        }
+                        else
+                        {
+                                gl_text_node_free (&node);
+                        }
+                }
+        }
+
+        merge = gl_label_get_merge (label);
+        if ( merge != NULL )
+        {
+                src = gl_merge_get_src (merge);
+                if ( (job->input != NULL) && (g_strcmp0 (src, job->input) != 0) )
+                {
+                        gl_merge_set_src (merge, job->input);
+                }
+                g_free (src);
+
+                for ( p_record = gl_merge_get_record_list (merge); p_record != NULL; p_record = p_record->next )
+                {
+                        record = (glMergeRecord *)p_record->data;
+                        if ( !record->select_flag )
+                        {
+                                continue;
+                        }
+
+                        hash_string (checksum, "record");
+                        for ( p_field = record->field_list; p_field != NULL; p_field = p_field->next )
+                        {
+                                field = (glMergeField *)p_field->data;
+                                hash_string (checksum, field->key);
+                                hash_string (checksum, field->value);
+                        }
+
+                        for ( p = image_nodes; p != NULL; p = p->next )
+                        {
+                                filename = gl_text_node_expand ((glTextNode *)p->data, record);
+                                if ( (filename != NULL) && !g_hash_table_lookup (files, filename) )
+                                {
+                                        hash_string (checksum, filename);
+                                        hash_file (checksum, filename);
+                                        g_hash_table_insert (files, filename, filename);
+                                }
+                                else
+                                {
+                                        g_free (filename);
+                                }
+                        }
+                }
+
+                g_object_unref (merge);
+        }
+
+        hash = g_strdup (g_checksum_get_string (checksum));
+
+done:
+        for ( p = image_nodes; p != NULL; p = p->next )
+        {
+                node = (glTextNode *)p->data;
+                gl_text_node_free (&node);
+        }
+        g_list_free (image_nodes);
+        g_hash_table_destroy (files);
+        g_hash_table_destroy (fonts);
+        g_checksum_free (checksum);
+
+        return hash;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add string to hash, length prefixed so that strings can't run   */
+/* into each other.                                                          */
+/*---------------------------------------------------------------------------*/
+static void
+hash_string (GChecksum   *checksum,
+             const gchar *string)
+{
+        gchar *prefix;
+
+        if ( string == NULL )
+        {
+                g_checksum_update (checksum, (const guchar *)"-", 1);
+                return;
+        }
+
+        prefix = g_strdup_printf ("%" G_GSIZE_FORMAT ":", strlen (string));
+        g_checksum_update (checksum, (const guchar *)prefix, -1);
+        g_checksum_update (checksum, (const guchar *)string, -1);
+        g_free (prefix);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add contents of file to hash.  A missing file is hashed too, so */
+/* that it is noticed when it appears.                                       */
+/*---------------------------------------------------------------------------*/
+static gboolean
+hash_file (GChecksum   *checksum,
+           const gchar *filename)
+{
+        gchar *contents, *prefix;
+        gsize  length;
+
+        if ( !g_file_get_contents (filename, &contents, &length, NULL) )
+        {
+                hash_string (checksum, NULL);
+                return FALSE;
+        }
+
+        prefix = g_strdup_printf ("%" G_GSIZE_FORMAT ":", length);
+        g_checksum_update (checksum, (const guchar *)prefix, -1);
+        g_checksum_update (checksum, (const guchar *)contents, length);
+        g_free (prefix);
+        g_free (contents);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add font family to hash, with the font it resolves to.          */
+/*---------------------------------------------------------------------------*/
+static void
+hash_font (GChecksum   *checksum,
+           const gchar *family)
+{
+        PangoFontMap         *font_map;
+        PangoContext         *context;
+        PangoFontDescription *desc, *actual_desc;
+        PangoFont            *font;
+        gchar                *actual = NULL;
+
+        font_map = pango_cairo_font_map_get_default ();
+        context  = pango_font_map_create_context (font_map);
+
+        desc = pango_font_description_new ();
+        pango_font_description_set_family (desc, family);
+
+        font = pango_font_map_load_font (font_map, context, desc);
+        if ( font != NULL )
+        {
+                actual_desc = pango_font_describe (font);
+                actual = pango_font_description_to_string (actual_desc);
+                pango_font_description_free (actual_desc);
+                g_object_unref (font);
+        }
+
+        hash_string (checksum, family);
+        hash_string (checksum, actual);
+
+        g_free (actual);
+        pango_font_description_free (desc);
+        g_object_unref (context);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get string member of JSON object (newly allocated).             */
+/*---------------------------------------------------------------------------*/
+static gchar *
+get_string_member (JsonObject  *object,
+                   const gchar *name,
+                   const gchar *default_value)
+{
+        JsonNode *node;
+
+        node = json_object_get_member (object, name);
+        if ( node == NULL )
+        {
+                return g_strdup (default_value);
+        }
+        if ( JSON_NODE_HOLDS_VALUE (node) && (json_node_get_value_type (node) == G_TYPE_STRING) )
+        {
+                return json_node_dup_string (node);
+        }
+
+        return NULL;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get integer member of JSON object.                              */
+/*---------------------------------------------------------------------------*/
+static gint
+get_int_member (JsonObject  *object,
+                const gchar *name,
+                gint         default_value)
+{
+        JsonNode *node;
+
+        node = json_object_get_member (object, name);
+        if ( (node == NULL) || !JSON_NODE_HOLDS_VALUE (node) )
+        {
+                return default_value;
+        }
+
+        return json_node_get_int (node);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get boolean member of JSON object.                              */
+/*---------------------------------------------------------------------------*/
+static gboolean
+get_boolean_member (JsonObject  *object,
+                    const gchar *name,
+                    gboolean     default_value)
+{
+        JsonNode *node;
+
+        node = json_object_get_member (object, name);
+        if ( (node == NULL) || !JSON_NODE_HOLDS_VALUE (node) )
+        {
+                return default_value;
+        }
+
+        return json_node_get_boolean (node);
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -0,0 +1,141 @@
+/*
+ *  batch-job.h
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BATCH_JOB_H__
+#define __BATCH_JOB_H__
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+#include "label.h"
+
+G_BEGIN_DECLS
+
+
+typedef enum {
+	BATCH_JOB_OK,
+	BATCH_JOB_ERROR_OPEN_LABEL,
+	BATCH_JOB_ERROR_WRITE,
+} glBatchJobStatus;
+
+
+typedef struct {
+
+        gchar            *label_filename;
+        gchar            *input;
+        gchar            *output;
+
+        gint              n_copies;
+        gint              n_sheets;
+        gint              first;
+        gboolean          outline_flag;
+        gboolean          reverse_flag;
+        gboolean          crop_marks_flag;
+
+        gint              checkpoint;
+        gboolean          resume_flag;
+
+        gboolean          incremental_flag;
+
+        /* Sheet and merge record ranges (1 based, inclusive), 0 if unset. */
+        gint              first_page;
+        gint              last_page;
+        gint              first_record;
+        gint              last_record;
+
+        /* Content hash, set by gl_batch_job_is_up_to_date(). */
+        gchar            *hash;
+
+} glBatchJob;
+
+
+typedef struct {
+
+        glBatchJobStatus  status;
+
+        gint              n_sheets;
+        gint              n_labels;
+        gboolean          up_to_date;
+
+        /* Elapsed times, in seconds. */
+        gdouble           load_time;
+        gdouble           render_time;
+
+} glBatchJobResult;
+
+
+glBatchJob       *gl_batch_job_new                 (void);
+
+glBatchJob       *gl_batch_job_new_from_json       (JsonObject        *object,
+                                                    gchar            **error_message);
+
+void              gl_batch_job_free                (glBatchJob        *job);
+
+glLabel          *gl_batch_job_open_label          (glBatchJob        *job,
+                                                    glBatchJobResult  *result);
+
+gint              gl_batch_job_get_n_sheets        (glBatchJob        *job,
+                                                    glLabel           *label);
+
+void              gl_batch_job_apply_input         (glBatchJob        *job,
+                                                    glLabel           *label);
+
+gboolean          gl_batch_job_is_up_to_date       (glBatchJob        *job,
+                                                    glLabel           *label);
+
+gboolean          gl_batch_job_print               (glBatchJob        *job,
+                                                    glLabel           *label,
+                                                    glBatchJobResult  *result);
+
+gboolean          gl_batch_job_run                 (glBatchJob        *job,
+                                                    glBatchJobResult  *result);
+
+gboolean          gl_batch_job_print_zpl           (glBatchJob        *job,
+                                                    glLabel           *label,
+                                                    gdouble            dpi,
+                                                    glBatchJobResult  *result);
+
+gchar            *gl_batch_job_output_filename     (glBatchJob        *job,
+                                                    const gchar       *ext);
+
+gboolean          gl_batch_job_parse_range         (const gchar       *string,
+                                                    gint              *first,
+                                                    gint              *last);
+
+gchar            *gl_batch_job_numbered_filename   (const gchar       *abs_fn,
+                                                    gint               n);
+
+const gchar      *gl_batch_job_status_message      (glBatchJobStatus   status);
+
+
+G_END_DECLS
+
+#endif /* __BATCH_JOB_H__ */
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
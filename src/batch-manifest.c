@@ -0,0 +1,303 @@
+/*
+ *  batch-manifest.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A manifest is a JSON file holding an array of jobs, or an object with a
+ * "jobs" array.  Each job is an object as read by gl_batch_job_new_from_json();
+ * relative paths are taken relative to the manifest's own directory.  All
+ * jobs are run by the batch worker pool (see batch-pool.c).  Incremental jobs
+ * whose output is up to date are skipped before a worker is started.
+ */
+
+#include <config.h>
+
+#include "batch-manifest.h"
+
+#include <glib/gi18n.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <json-glib/json-glib.h>
+
+#include "batch-job.h"
+#include "batch-pool.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        gchar      *output;
+        gboolean    incremental_flag;
+} ManifestWorker;
+
+typedef struct {
+        GHashTable *pid_index;    /* pid -> ManifestWorker */
+        gint        n_ok;
+        gint        n_failed;
+        gint        n_up_to_date;
+        gboolean    incremental_flag; /* Set for any job. */
+} ManifestRun;
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void      job_done_cb           (pid_t        pid,
+                                        gboolean     success,
+                                        gpointer     user_data);
+
+static void      manifest_worker_free  (ManifestWorker *worker);
+
+static void      resolve_path          (gchar      **path,
+                                        const gchar *dirname);
+
+
+/*****************************************************************************/
+/* Run all jobs of manifest.                                                 */
+/*****************************************************************************/
+gboolean
+gl_batch_manifest_run (const gchar *manifest_filename,
+                       gint         n_workers,
+                       gboolean     incremental_flag)
+{
+        JsonParser       *parser;
+        JsonNode         *root, *node;
+        JsonArray        *array = NULL;
+        gchar            *dirname;
+        guint             i, n_entries;
+        glBatchJob       *job;
+        glLabel          *label;
+        glBatchJobResult  result;
+        gchar            *error_message = NULL;
+        GError           *error = NULL;
+        ManifestRun       run;
+        ManifestWorker   *worker;
+        pid_t             pid;
+
+        parser = json_parser_new ();
+        if ( !json_parser_load_from_file (parser, manifest_filename, &error) )
+        {
+                fprintf ( stderr, _("cannot read manifest %s: %s\n"),
+                          manifest_filename, error->message );
+                g_error_free (error);
+                g_object_unref (parser);
+                return FALSE;
+        }
+
+        root = json_parser_get_root (parser);
+        if ( root && JSON_NODE_HOLDS_ARRAY (root) )
+        {
+                array = json_node_get_array (root);
+        }
+        else if ( root && JSON_NODE_HOLDS_OBJECT (root) )
+        {
+                node = json_object_get_member (json_node_get_object (root), "jobs");
+                if ( node && JSON_NODE_HOLDS_ARRAY (node) )
+                {
+                        array = json_node_get_array (node);
+                }
+        }
+        if ( array == NULL )
+        {
+                fprintf ( stderr, _("manifest %s does not contain a list of jobs\n"),
+                          manifest_filename );
+                g_object_unref (parser);
+                return FALSE;
+        }
+
+        dirname = g_path_get_dirname (manifest_filename);
+
+        run.pid_index        = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                      NULL, (GDestroyNotify)manifest_worker_free);
+        run.n_ok             = 0;
+        run.n_failed         = 0;
+        run.n_up_to_date     = 0;
+        run.incremental_flag = incremental_flag;
+
+        gl_batch_pool_init (n_workers, job_done_cb, &run);
+
+        n_entries = json_array_get_length (array);
+        for ( i = 0; i < n_entries; i++ )
+        {
+                node = json_array_get_element (array, i);
+                if ( !JSON_NODE_HOLDS_OBJECT (node) )
+                {
+                        fprintf ( stderr, _("manifest job %d: not a JSON object\n"), i+1 );
+                        run.n_failed++;
+                        continue;
+                }
+
+                if ( !json_object_has_member (json_node_get_object (node), "output") )
+                {
+                        fprintf ( stderr, _("manifest job %d: missing \"output\"\n"), i+1 );
+                        run.n_failed++;
+                        continue;
+                }
+
+                job = gl_batch_job_new_from_json (json_node_get_object (node), &error_message);
+                if ( job == NULL )
+                {
+                        fprintf ( stderr, _("manifest job %d: %s\n"), i+1, error_message );
+                        g_free (error_message);
+                        error_message = NULL;
+                        run.n_failed++;
+                        continue;
+                }
+
+                resolve_path (&job->label_filename, dirname);
+                resolve_path (&job->input,          dirname);
+                resolve_path (&job->output,         dirname);
+
+                job->incremental_flag = job->incremental_flag || incremental_flag;
+                run.incremental_flag  = run.incremental_flag || job->incremental_flag;
+
+                label = gl_batch_pool_get_label (job, &result);
+                if ( label == NULL )
+                {
+                        run.n_failed++;
+                        gl_batch_job_free (job);
+                        continue;
+                }
+
+                if ( job->incremental_flag && gl_batch_job_is_up_to_date (job, label) )
+                {
+                        run.n_up_to_date++;
+                        gl_batch_job_free (job);
+                        continue;
+                }
+
+                pid = gl_batch_pool_fork ();
+                if ( pid == 0 )
+                {
+                        /* Worker. */
+                        gl_batch_pool_exit ( gl_batch_job_print (job, label, &result) ? 0 : 1 );
+                }
+                else if ( pid < 0 )
+                {
+                        fprintf ( stderr, _("manifest job %d: cannot start worker\n"), i+1 );
+                        run.n_failed++;
+                }
+                else
+                {
+                        worker = g_new0 (ManifestWorker, 1);
+                        worker->output           = g_strdup (job->output);
+                        worker->incremental_flag = job->incremental_flag;
+                        g_hash_table_insert (run.pid_index, GINT_TO_POINTER (pid), worker);
+                }
+
+                gl_batch_job_free (job);
+        }
+
+        gl_batch_pool_shutdown ();
+
+        if ( run.incremental_flag )
+        {
+                fprintf ( stderr, _("%d jobs: %d rebuilt, %d up to date, %d failed\n"),
+                          n_entries, run.n_ok, run.n_up_to_date, run.n_failed );
+        }
+        else
+        {
+                fprintf ( stderr, _("%d jobs: %d succeeded, %d failed\n"),
+                          n_entries, run.n_ok, run.n_failed );
+        }
+
+        g_hash_table_destroy (run.pid_index);
+        g_free (dirname);
+        g_object_unref (parser);
+
+        return (run.n_failed == 0);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Worker finished callback.                                       */
+/*---------------------------------------------------------------------------*/
+static void
+job_done_cb (pid_t     pid,
+             gboolean  success,
+             gpointer  user_data)
+{
+        ManifestRun    *run = (ManifestRun *)user_data;
+        ManifestWorker *worker;
+
+        worker = g_hash_table_lookup (run->pid_index, GINT_TO_POINTER (pid));
+
+        if ( success )
+        {
+                if ( worker->incremental_flag )
+                {
+                        fprintf ( stderr, _("rebuilt %s\n"), worker->output );
+                }
+                run->n_ok++;
+        }
+        else
+        {
+                fprintf ( stderr, _("failed %s\n"), worker->output );
+                run->n_failed++;
+        }
+
+        g_hash_table_remove (run->pid_index, GINT_TO_POINTER (pid));
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free worker entry.                                              */
+/*---------------------------------------------------------------------------*/
+static void
+manifest_worker_free (ManifestWorker *worker)
+{
+        g_free (worker->output);
+        g_free (worker);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Make path relative to manifest's directory.                     */
+/*---------------------------------------------------------------------------*/
+static void
+resolve_path (gchar       **path,
+              const gchar  *dirname)
+{
+        gchar *abs_path;
+
+        if ( (*path != NULL) && !g_path_is_absolute (*path) )
+        {
+                abs_path = g_build_filename (dirname, *path, NULL);
+                g_free (*path);
+                *path = abs_path;
+        }
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
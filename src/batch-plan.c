@@ -0,0 +1,843 @@
+/*
+ *  batch-plan.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A plan is a dry run of a batch job: it lays out the sheet schedule (which
+ * record lands on which sheet and slot) and checks every barcode and merged
+ * image filename, without drawing anything.
+ *
+ * Checks that depend on merge data are split across forked workers (see
+ * batch-pool.c), each taking every n'th record and sending its problems back
+ * over a pipe.  Processes are used because the barcode backends are not
+ * known to be thread safe.
+ */
+
+#include <config.h>
+
+#include "batch-plan.h"
+
+#include <glib/gi18n.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <json-glib/json-glib.h>
+
+#include <libglabels.h>
+#include "label-barcode.h"
+#include "label-image.h"
+#include "text-node.h"
+#include "bc.h"
+#include "batch-pool.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+/* Don't fork a worker for less than this many records. */
+#define MIN_RECORDS_PER_WORKER  64
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        glLabelObject *object;
+        gint           i_object;      /* Position in label (1 based). */
+        gboolean       field_flag;    /* Depends on merge record. */
+} PlanCheck;
+
+typedef struct {
+        gint           i_record;      /* Position in merge source (1 based), 0 if none. */
+        gint           i_object;
+        gchar         *type;
+        gchar         *message;
+} PlanProblem;
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static GList       *collect_checks         (glLabel           *label);
+
+static void         check_object           (PlanCheck         *check,
+                                            glMergeRecord     *record,
+                                            gint               i_record,
+                                            GList            **problems);
+
+static void         check_records          (GList             *checks,
+                                            const GList       *record_list,
+                                            gint               i_first,
+                                            gint               i_worker,
+                                            gint               n_workers,
+                                            GList            **problems);
+
+static void         check_records_parallel (GList             *checks,
+                                            const GList       *record_list,
+                                            gint               i_first,
+                                            gint               n_workers,
+                                            GList            **problems);
+
+static PlanProblem *plan_problem_new       (gint               i_record,
+                                            gint               i_object,
+                                            const gchar       *type,
+                                            const gchar       *message);
+
+static void         plan_problem_free      (PlanProblem       *problem);
+
+static gint         plan_problem_compare   (gconstpointer      a,
+                                            gconstpointer      b);
+
+static void         problems_write         (gint               fd,
+                                            GList             *problems);
+
+static void         problems_read          (gint               fd,
+                                            GList            **problems);
+
+static void         write_json             (glBatchJob        *job,
+                                            FILE              *stream,
+                                            const GList       *record_list,
+                                            gint               n_sheets,
+                                            gint               n_labels,
+                                            GList             *problems,
+                                            gdouble            plan_time);
+
+static void         write_csv              (glBatchJob        *job,
+                                            FILE              *stream,
+                                            const GList       *record_list,
+                                            gint               n_labels,
+                                            GList             *problems);
+
+static void         write_csv_field        (FILE              *stream,
+                                            const gchar       *string);
+
+
+/*****************************************************************************/
+/* Parse plan format name.                                                   */
+/*****************************************************************************/
+gboolean
+gl_batch_plan_parse_format (const gchar       *string,
+                            glBatchPlanFormat *format)
+{
+        if ( g_ascii_strcasecmp (string, "json") == 0 )
+        {
+                *format = BATCH_PLAN_FORMAT_JSON;
+                return TRUE;
+        }
+        if ( g_ascii_strcasecmp (string, "csv") == 0 )
+        {
+                *format = BATCH_PLAN_FORMAT_CSV;
+                return TRUE;
+        }
+
+        return FALSE;
+}
+
+
+/*****************************************************************************/
+/* Plan job and write report to stream.                                      */
+/*                                                                           */
+/* Returns FALSE if any problems were found.                                 */
+/*****************************************************************************/
+gboolean
+gl_batch_plan_run (glBatchJob        *job,
+                   glLabel           *label,
+                   glBatchPlanFormat  format,
+                   gint               n_workers,
+                   FILE              *stream)
+{
+        GTimer            *timer;
+        const lglTemplate *template;
+        lglTemplateFrame  *frame;
+        glMerge           *merge;
+        const GList       *record_list = NULL;
+        GList             *checks, *p;
+        GList             *problems = NULL;
+        gint               n_sheets, n_labels, i_first;
+        gboolean           ok;
+
+        gl_debug (DEBUG_PRINT, "START");
+
+        timer = g_timer_new ();
+
+        gl_batch_job_apply_input (job, label);
+
+        template = gl_label_get_template (label);
+        frame    = (lglTemplateFrame *)template->frames->data;
+        n_labels = lgl_template_frame_get_n_labels (frame);
+        n_sheets = gl_batch_job_get_n_sheets (job, label);
+
+        merge = gl_label_get_merge (label);
+        if ( merge != NULL )
+        {
+                record_list = gl_merge_get_record_list (merge);
+        }
+
+        /* Number records as in the merge source, not within --records. */
+        i_first = MAX (job->first_record, 1);
+
+        checks = collect_checks (label);
+
+        /* Checks that don't depend on merge data, once. */
+        for ( p = checks; p != NULL; p = p->next )
+        {
+                if ( !((PlanCheck *)p->data)->field_flag )
+                {
+                        check_object ((PlanCheck *)p->data, NULL, 0, &problems);
+                }
+        }
+
+        /* Checks that do, once per selected record. */
+        if ( merge != NULL )
+        {
+                n_workers = MIN (n_workers,
+                                 gl_merge_get_record_count (merge) / MIN_RECORDS_PER_WORKER);
+
+                if ( n_workers > 1 )
+                {
+                        check_records_parallel (checks, record_list, i_first, n_workers, &problems);
+                }
+                else
+                {
+                        check_records (checks, record_list, i_first, 0, 1, &problems);
+                }
+        }
+
+        problems = g_list_sort (problems, plan_problem_compare);
+
+        switch (format)
+        {
+        case BATCH_PLAN_FORMAT_CSV:
+                write_csv (job, stream, record_list, n_labels, problems);
+                break;
+        default:
+                write_json (job, stream, record_list, n_sheets, n_labels, problems,
+                            g_timer_elapsed (timer, NULL));
+                break;
+        }
+
+        ok = (problems == NULL);
+
+        g_list_foreach (problems, (GFunc)plan_problem_free, NULL);
+        g_list_free (problems);
+        g_list_foreach (checks, (GFunc)g_free, NULL);
+        g_list_free (checks);
+        if ( merge != NULL )
+        {
+                g_object_unref (merge);
+        }
+        g_timer_destroy (timer);
+
+        gl_debug (DEBUG_PRINT, "END");
+
+        return ok;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Collect objects of label that can fail to render.               */
+/*---------------------------------------------------------------------------*/
+static GList *
+collect_checks (glLabel *label)
+{
+        const GList *p;
+        GList       *checks = NULL;
+        PlanCheck   *check;
+        glTextNode  *node;
+        gint         i_object;
+
+        for ( p = gl_label_get_object_list (label), i_object = 1; p != NULL; p = p->next, i_object++ )
+        {
+                if ( GL_IS_LABEL_BARCODE (p->data) )
+                {
+                        node = gl_label_barcode_get_data (GL_LABEL_BARCODE (p->data));
+                }
+                else if ( GL_IS_LABEL_IMAGE (p->data) )
+                {
+                        node = gl_label_image_get_filename (GL_LABEL_IMAGE (p->data));
+
+                        /* Fixed images are embedded in the label file. */
+                        if ( !node->field_flag )
+                        {
+                                gl_text_node_free (&node);
+                                continue;
+                        }
+                }
+                else
+                {
+                        continue;
+                }
+
+                check = g_new0 (PlanCheck, 1);
+                check->object     = GL_LABEL_OBJECT (p->data);
+                check->i_object   = i_object;
+                check->field_flag = node->field_flag;
+                checks = g_list_append (checks, check);
+
+                gl_text_node_free (&node);
+        }
+
+        return checks;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Check one object against one record.                            */
+/*---------------------------------------------------------------------------*/
+static void
+check_object (PlanCheck      *check,
+              glMergeRecord  *record,
+              gint            i_record,
+              GList         **problems)
+{
+        glTextNode  *node;
+        gchar       *id, *text, *message = NULL;
+        const gchar *type;
+        gboolean     text_flag, checksum_flag;
+        guint        format_digits;
+        gdouble      w, h;
+        glBarcode   *gbc;
+
+        if ( GL_IS_LABEL_BARCODE (check->object) )
+        {
+                type = "barcode";
+
+                node = gl_label_barcode_get_data (GL_LABEL_BARCODE (check->object));
+                gl_label_barcode_get_props (GL_LABEL_BARCODE (check->object),
+                                            &id, &text_flag, &checksum_flag, &format_digits);
+                gl_label_object_get_size (check->object, &w, &h);
+
+                text = gl_text_node_expand (node, record);
+                gbc  = gl_barcode_style_new (gl_label_barcode_get_style (GL_LABEL_BARCODE (check->object)),
+                                             text_flag, checksum_flag, w, h, text);
+                if ( gbc == NULL )
+                {
+                        if ( (text == NULL) || (*text == '\0') )
+                        {
+                                message = g_strdup (_("Barcode data empty"));
+                        }
+                        else
+                        {
+                                message = g_strdup_printf (_("Invalid barcode data: %s"), text);
+                        }
+                }
+
+                gl_barcode_free (&gbc);
+                g_free (text);
+                g_free (id);
+        }
+        else
+        {
+                type = "image";
+
+                node = gl_label_image_get_filename (GL_LABEL_IMAGE (check->object));
+
+                text = gl_text_node_expand (node, record);
+                if ( (text != NULL) && (*text != '\0')
+                     && !g_file_test (text, G_FILE_TEST_IS_REGULAR) )
+                {
+                        message = g_strdup_printf (_("Image file not found: %s"), text);
+                }
+
+                g_free (text);
+        }
+
+        if ( message != NULL )
+        {
+                *problems = g_list_prepend (*problems,
+                                            plan_problem_new (i_record, check->i_object, type, message));
+                g_free (message);
+        }
+
+        gl_text_node_free (&node);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Check every n'th selected record, starting with i'th.  The     */
+/* first record in record_list is numbered i_first.                          */
+/*---------------------------------------------------------------------------*/
+static void
+check_records (GList        *checks,
+               const GList  *record_list,
+               gint          i_first,
+               gint          i_worker,
+               gint          n_workers,
+               GList       **problems)
+{
+        const GList   *p_record;
+        GList         *p;
+        glMergeRecord *record;
+        gint           i_record;
+
+        for ( p_record = record_list, i_record = i_first; p_record != NULL; p_record = p_record->next, i_record++ )
+        {
+                record = (glMergeRecord *)p_record->data;
+
+                if ( !record->select_flag || ((i_record - i_first) % n_workers != i_worker) )
+                {
+                        continue;
+                }
+
+                for ( p = checks; p != NULL; p = p->next )
+                {
+                        if ( ((PlanCheck *)p->data)->field_flag )
+                        {
+                                check_object ((PlanCheck *)p->data, record, i_record, problems);
+                        }
+                }
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Check records in n forked workers.                              */
+/*---------------------------------------------------------------------------*/
+static void
+check_records_parallel (GList        *checks,
+                        const GList  *record_list,
+                        gint          i_first,
+                        gint          n_workers,
+                        GList       **problems)
+{
+        gint   *read_fds;
+        gint    fds[2];
+        gint    i_worker;
+        pid_t   pid;
+
+        read_fds = g_new (gint, n_workers);
+
+        gl_batch_pool_init (n_workers, NULL, NULL);
+
+        for ( i_worker = 0; i_worker < n_workers; i_worker++ )
+        {
+                read_fds[i_worker] = -1;
+
+                if ( pipe (fds) < 0 )
+                {
+                        /* Check this worker's share here instead. */
+                        check_records (checks, record_list, i_first, i_worker, n_workers, problems);
+                        continue;
+                }
+
+                pid = gl_batch_pool_fork ();
+                if ( pid == 0 )
+                {
+                        /* Worker. */
+                        GList *worker_problems = NULL;
+
+                        close (fds[0]);
+                        check_records (checks, record_list, i_first, i_worker, n_workers, &worker_problems);
+                        problems_write (fds[1], worker_problems);
+                        close (fds[1]);
+                        gl_batch_pool_exit (0);
+                }
+
+                close (fds[1]);
+
+                if ( pid < 0 )
+                {
+                        close (fds[0]);
+                        check_records (checks, record_list, i_first, i_worker, n_workers, problems);
+                }
+                else
+                {
+                        read_fds[i_worker] = fds[0];
+                }
+        }
+
+        for ( i_worker = 0; i_worker < n_workers; i_worker++ )
+        {
+                if ( read_fds[i_worker] >= 0 )
+                {
+                        problems_read (read_fds[i_worker], problems);
+                        close (read_fds[i_worker]);
+                }
+        }
+
+        gl_batch_pool_shutdown ();
+
+        g_free (read_fds);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Create problem.                                                 */
+/*---------------------------------------------------------------------------*/
+static PlanProblem *
+plan_problem_new (gint         i_record,
+                  gint         i_object,
+                  const gchar *type,
+                  const gchar *message)
+{
+        PlanProblem *problem;
+
+        problem = g_new0 (PlanProblem, 1);
+        problem->i_record = i_record;
+        problem->i_object = i_object;
+        problem->type     = g_strdup (type);
+        problem->message  = g_strdup (message);
+
+        return problem;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free problem.                                                   */
+/*---------------------------------------------------------------------------*/
+static void
+plan_problem_free (PlanProblem *problem)
+{
+        g_free (problem->type);
+        g_free (problem->message);
+        g_free (problem);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Order problems by record, then object.                          */
+/*---------------------------------------------------------------------------*/
+static gint
+plan_problem_compare (gconstpointer a,
+                      gconstpointer b)
+{
+        const PlanProblem *problem_a = a;
+        const PlanProblem *problem_b = b;
+
+        if ( problem_a->i_record != problem_b->i_record )
+        {
+                return problem_a->i_record - problem_b->i_record;
+        }
+        return problem_a->i_object - problem_b->i_object;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Send problems to parent, one tab separated line each.           */
+/*---------------------------------------------------------------------------*/
+static void
+problems_write (gint   fd,
+                GList *problems)
+{
+        FILE        *stream;
+        GList       *p;
+        PlanProblem *problem;
+        gchar       *message;
+
+        stream = fdopen (fd, "w");
+        if ( stream == NULL )
+        {
+                return;
+        }
+
+        for ( p = problems; p != NULL; p = p->next )
+        {
+                problem = (PlanProblem *)p->data;
+
+                message = g_strescape (problem->message, NULL);
+                fprintf (stream, "%d\t%d\t%s\t%s\n",
+                         problem->i_record, problem->i_object, problem->type, message);
+                g_free (message);
+        }
+
+        /* Flush, but leave fd for caller to close. */
+        fflush (stream);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Read problems sent by a worker.                                 */
+/*---------------------------------------------------------------------------*/
+static void
+problems_read (gint    fd,
+               GList **problems)
+{
+        GIOChannel  *channel;
+        gchar       *line, *message;
+        gchar      **fields;
+
+        channel = g_io_channel_unix_new (fd);
+        g_io_channel_set_encoding (channel, NULL, NULL);
+
+        while ( g_io_channel_read_line (channel, &line, NULL, NULL, NULL) == G_IO_STATUS_NORMAL )
+        {
+                fields = g_strsplit (g_strchomp (line), "\t", 4);
+
+                if ( g_strv_length (fields) == 4 )
+                {
+                        message = g_strcompress (fields[3]);
+                        *problems = g_list_prepend (*problems,
+                                                    plan_problem_new (atoi (fields[0]),
+                                                                      atoi (fields[1]),
+                                                                      fields[2],
+                                                                      message));
+                        g_free (message);
+                }
+
+                g_strfreev (fields);
+                g_free (line);
+        }
+
+        g_io_channel_unref (channel);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Write plan as JSON.                                             */
+/*                                                                           */
+/* Placements follow the uncollated schedule used by glabels-3-batch: all    */
+/* selected records, once per copy, starting at the job's first label.       */
+/*---------------------------------------------------------------------------*/
+static void
+write_json (glBatchJob   *job,
+            FILE         *stream,
+            const GList  *record_list,
+            gint          n_sheets,
+            gint          n_labels,
+            GList        *problems,
+            gdouble       plan_time)
+{
+        JsonBuilder   *builder;
+        JsonGenerator *generator;
+        JsonNode      *root;
+        const GList   *p_record;
+        GList         *p;
+        PlanProblem   *problem;
+        gint           i_copy, i_record, i_label, n_selected = 0;
+        gchar         *data;
+
+        builder = json_builder_new ();
+        json_builder_begin_object (builder);
+
+        json_builder_set_member_name (builder, "label");
+        json_builder_add_string_value (builder, job->label_filename);
+        if ( job->input != NULL )
+        {
+                json_builder_set_member_name (builder, "input");
+                json_builder_add_string_value (builder, job->input);
+        }
+        json_builder_set_member_name (builder, "sheets");
+        json_builder_add_int_value (builder, n_sheets);
+        json_builder_set_member_name (builder, "labels-per-sheet");
+        json_builder_add_int_value (builder, n_labels);
+
+        if ( record_list != NULL )
+        {
+                json_builder_set_member_name (builder, "placements");
+                json_builder_begin_array (builder);
+
+                i_label = job->first - 1;
+                for ( i_copy = 0; i_copy < job->n_copies; i_copy++ )
+                {
+                        for ( p_record = record_list, i_record = MAX (job->first_record, 1); p_record != NULL; p_record = p_record->next, i_record++ )
+                        {
+                                if ( !((glMergeRecord *)p_record->data)->select_flag )
+                                {
+                                        continue;
+                                }
+                                if ( i_copy == 0 )
+                                {
+                                        n_selected++;
+                                }
+
+                                json_builder_begin_object (builder);
+                                json_builder_set_member_name (builder, "record");
+                                json_builder_add_int_value (builder, i_record);
+                                json_builder_set_member_name (builder, "copy");
+                                json_builder_add_int_value (builder, i_copy + 1);
+                                json_builder_set_member_name (builder, "sheet");
+                                json_builder_add_int_value (builder, i_label / n_labels + 1);
+                                json_builder_set_member_name (builder, "slot");
+                                json_builder_add_int_value (builder, i_label % n_labels + 1);
+                                json_builder_end_object (builder);
+
+                                i_label++;
+                        }
+                }
+
+                json_builder_end_array (builder);
+
+                json_builder_set_member_name (builder, "records");
+                json_builder_add_int_value (builder, n_selected);
+        }
+
+        json_builder_set_member_name (builder, "problems");
+        json_builder_begin_array (builder);
+        for ( p = problems; p != NULL; p = p->next )
+        {
+                problem = (PlanProblem *)p->data;
+
+                json_builder_begin_object (builder);
+                if ( problem->i_record > 0 )
+                {
+                        json_builder_set_member_name (builder, "record");
+                        json_builder_add_int_value (builder, problem->i_record);
+                }
+                json_builder_set_member_name (builder, "object");
+                json_builder_add_int_value (builder, problem->i_object);
+                json_builder_set_member_name (builder, "type");
+                json_builder_add_string_value (builder, problem->type);
+                json_builder_set_member_name (builder, "message");
+                json_builder_add_string_value (builder, problem->message);
+                json_builder_end_object (builder);
+        }
+        json_builder_end_array (builder);
+
+        json_builder_set_member_name (builder, "plan-time");
+        json_builder_add_double_value (builder, plan_time);
+
+        json_builder_end_object (builder);
+
+        root = json_builder_get_root (builder);
+        generator = json_generator_new ();
+        g_object_set (generator, "pretty", TRUE, NULL);
+        json_generator_set_root (generator, root);
+        data = json_generator_to_data (generator, NULL);
+
+        fprintf (stream, "%s\n", data);
+
+        g_free (data);
+        json_node_free (root);
+        g_object_unref (generator);
+        g_object_unref (builder);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Write plan as CSV, one row per placement.                       */
+/*                                                                           */
+/* Problems are listed with each placement of their record; problems that    */
+/* don't depend on a record get rows of their own, with no placement.        */
+/*---------------------------------------------------------------------------*/
+static void
+write_csv (glBatchJob   *job,
+           FILE         *stream,
+           const GList  *record_list,
+           gint          n_labels,
+           GList        *problems)
+{
+        GHashTable    *record_problems;
+        GString       *messages;
+        const GList   *p_record;
+        GList         *p;
+        PlanProblem   *problem;
+        gint           i_copy, i_record, i_label;
+
+        fprintf (stream, "record,copy,sheet,slot,problems\n");
+
+        record_problems = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                 NULL, (GDestroyNotify)g_free);
+
+        for ( p = problems; p != NULL; p = p->next )
+        {
+                problem = (PlanProblem *)p->data;
+
+                if ( problem->i_record == 0 )
+                {
+                        fprintf (stream, ",,,,");
+                        write_csv_field (stream, problem->message);
+                        fprintf (stream, "\n");
+                        continue;
+                }
+
+                messages = g_string_new (g_hash_table_lookup (record_problems,
+                                                              GINT_TO_POINTER (problem->i_record)));
+                if ( messages->len > 0 )
+                {
+                        g_string_append (messages, "; ");
+                }
+                g_string_append (messages, problem->message);
+                g_hash_table_insert (record_problems, GINT_TO_POINTER (problem->i_record),
+                                     g_string_free (messages, FALSE));
+        }
+
+        i_label = job->first - 1;
+        for ( i_copy = 0; (record_list != NULL) && (i_copy < job->n_copies); i_copy++ )
+        {
+                for ( p_record = record_list, i_record = MAX (job->first_record, 1); p_record != NULL; p_record = p_record->next, i_record++ )
+                {
+                        if ( !((glMergeRecord *)p_record->data)->select_flag )
+                        {
+                                continue;
+                        }
+
+                        fprintf (stream, "%d,%d,%d,%d,",
+                                 i_record, i_copy + 1, i_label / n_labels + 1, i_label % n_labels + 1);
+                        write_csv_field (stream, g_hash_table_lookup (record_problems,
+                                                                      GINT_TO_POINTER (i_record)));
+                        fprintf (stream, "\n");
+
+                        i_label++;
+                }
+        }
+
+        g_hash_table_destroy (record_problems);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Write CSV field, quoted if needed.                              */
+/*---------------------------------------------------------------------------*/
+static void
+write_csv_field (FILE        *stream,
+                 const gchar *string)
+{
+        const gchar *p;
+
+        if ( string == NULL )
+        {
+                return;
+        }
+
+        if ( strpbrk (string, ",\"\r\n") == NULL )
+        {
+                fputs (string, stream);
+                return;
+        }
+
+        fputc ('"', stream);
+        for ( p = string; *p != '\0'; p++ )
+        {
+                if ( *p == '"' )
+                {
+                        fputc ('"', stream);
+                }
+                fputc (*p, stream);
+        }
+        fputc ('"', stream);
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -0,0 +1,61 @@
+/*
+ *  batch-plan.h
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BATCH_PLAN_H__
+#define __BATCH_PLAN_H__
+
+#include <glib.h>
+#include <stdio.h>
+
+#include "batch-job.h"
+
+G_BEGIN_DECLS
+
+
+typedef enum {
+	BATCH_PLAN_FORMAT_JSON,
+	BATCH_PLAN_FORMAT_CSV,
+} glBatchPlanFormat;
+
+
+gboolean            gl_batch_plan_parse_format         (const gchar       *string,
+                                                        glBatchPlanFormat *format);
+
+gboolean            gl_batch_plan_run                  (glBatchJob        *job,
+                                                        glLabel           *label,
+                                                        glBatchPlanFormat  format,
+                                                        gint               n_workers,
+                                                        FILE              *stream);
+
+
+G_END_DECLS
+
+#endif /* __BATCH_PLAN_H__ */
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -0,0 +1,393 @@
+/*
+ *  batch-pool.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Worker pool for running many batch jobs in one glabels-3-batch process.
+ *
+ * Fonts are loaded and labels are parsed once, in the parent process, and
+ * kept in a small cache.  Each job is then printed in a forked worker, which
+ * inherits all of this warm state (including each label's image caches).
+ * Processes are used rather than threads because the GTK+ print machinery
+ * is not thread safe.  The number of concurrent workers is bounded.
+ *
+ * While statistics are being collected, each worker gets a pipe back to the
+ * parent, on which it reports its own counts when it exits; the parent adds
+ * them in when it collects the worker.
+ */
+
+#include <config.h>
+
+#include "batch-pool.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <pango/pangocairo.h>
+
+#include "stats.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define LABEL_CACHE_SIZE   32
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        gchar    *filename;
+        time_t    mtime;
+        glLabel  *label;
+} LabelCacheEntry;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static gint                 max_workers = 1;
+static gint                 n_running   = 0;
+
+static glBatchPoolDoneFunc  done_func      = NULL;
+static gpointer             done_user_data = NULL;
+
+static GHashTable          *label_cache_index = NULL;
+static GQueue              *label_cache_lru   = NULL;
+
+static GHashTable          *stats_fds = NULL;         /* pid -> read end. */
+static gint                 worker_stats_fd = -1;     /* In worker. */
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void      warm_fonts             (void);
+
+static void      label_cache_entry_free (LabelCacheEntry *entry);
+
+static void      collect_stats          (pid_t            pid);
+
+
+/*****************************************************************************/
+/* Initialize worker pool.                                                   */
+/*****************************************************************************/
+void
+gl_batch_pool_init (gint                 n_workers,
+                    glBatchPoolDoneFunc  func,
+                    gpointer             user_data)
+{
+        max_workers    = MAX (1, n_workers);
+        n_running      = 0;
+        done_func      = func;
+        done_user_data = user_data;
+
+        label_cache_index = g_hash_table_new (g_str_hash, g_str_equal);
+        label_cache_lru   = g_queue_new ();
+
+        stats_fds = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+        warm_fonts ();
+}
+
+
+/*****************************************************************************/
+/* Wait for all workers, then free cached labels.                            */
+/*****************************************************************************/
+void
+gl_batch_pool_shutdown (void)
+{
+        gl_batch_pool_wait_all ();
+
+        g_queue_foreach (label_cache_lru, (GFunc)label_cache_entry_free, NULL);
+        g_queue_free (label_cache_lru);
+        g_hash_table_destroy (label_cache_index);
+        g_hash_table_destroy (stats_fds);
+
+        label_cache_lru   = NULL;
+        label_cache_index = NULL;
+        stats_fds         = NULL;
+}
+
+
+/*****************************************************************************/
+/* Get parsed label of job, from cache if still current.                     */
+/*                                                                           */
+/* The label is owned by the cache; it remains valid in a worker forked      */
+/* after this call, whatever the parent does with the cache later.           */
+/*****************************************************************************/
+glLabel *
+gl_batch_pool_get_label (glBatchJob       *job,
+                         glBatchJobResult *result)
+{
+        struct stat      st;
+        time_t           mtime = 0;
+        GList           *link;
+        LabelCacheEntry *entry;
+        glLabel         *label;
+
+        if ( g_stat (job->label_filename, &st) == 0 )
+        {
+                mtime = st.st_mtime;
+        }
+
+        link = g_hash_table_lookup (label_cache_index, job->label_filename);
+        if ( link != NULL )
+        {
+                entry = (LabelCacheEntry *)link->data;
+
+                if ( entry->mtime == mtime )
+                {
+                        g_queue_unlink (label_cache_lru, link);
+                        g_queue_push_head_link (label_cache_lru, link);
+
+                        result->status    = BATCH_JOB_OK;
+                        result->load_time = 0.0;
+                        return entry->label;
+                }
+
+                /* File has changed. */
+                g_queue_delete_link (label_cache_lru, link);
+                g_hash_table_remove (label_cache_index, entry->filename);
+                label_cache_entry_free (entry);
+        }
+
+        label = gl_batch_job_open_label (job, result);
+        if ( label == NULL )
+        {
+                return NULL;
+        }
+
+        if ( g_queue_get_length (label_cache_lru) >= LABEL_CACHE_SIZE )
+        {
+                entry = (LabelCacheEntry *)g_queue_pop_tail (label_cache_lru);
+                g_hash_table_remove (label_cache_index, entry->filename);
+                label_cache_entry_free (entry);
+        }
+
+        entry = g_new0 (LabelCacheEntry, 1);
+        entry->filename = g_strdup (job->label_filename);
+        entry->mtime    = mtime;
+        entry->label    = label;
+
+        g_queue_push_head (label_cache_lru, entry);
+        g_hash_table_insert (label_cache_index, entry->filename, label_cache_lru->head);
+
+        return label;
+}
+
+
+/*****************************************************************************/
+/* Start a worker, waiting for a free slot first.                            */
+/*                                                                           */
+/* Like fork(), returns 0 in the worker, the worker's pid in the parent, or  */
+/* -1 on failure.  A worker must finish with gl_batch_pool_exit().           */
+/*****************************************************************************/
+pid_t
+gl_batch_pool_fork (void)
+{
+        pid_t pid;
+        gint  fds[2] = { -1, -1 };
+
+        while ( n_running >= max_workers )
+        {
+                gl_batch_pool_reap (TRUE);
+        }
+
+        if ( gl_stats_enabled () && (pipe (fds) < 0) )
+        {
+                /* Go without this worker's counts. */
+                fds[0] = fds[1] = -1;
+        }
+
+        /* Don't let the worker re-emit buffered output. */
+        fflush (stdout);
+        fflush (stderr);
+
+        pid = fork ();
+        if ( pid == 0 )
+        {
+                if ( fds[0] >= 0 )
+                {
+                        close (fds[0]);
+                        worker_stats_fd = fds[1];
+                        gl_stats_reset ();
+                }
+        }
+        else
+        {
+                if ( fds[0] >= 0 )
+                {
+                        close (fds[1]);
+                        if ( pid > 0 )
+                        {
+                                g_hash_table_insert (stats_fds, GINT_TO_POINTER (pid),
+                                                     GINT_TO_POINTER (fds[0]));
+                        }
+                        else
+                        {
+                                close (fds[0]);
+                        }
+                }
+
+                if ( pid > 0 )
+                {
+                        n_running++;
+                }
+        }
+
+        return pid;
+}
+
+
+/*****************************************************************************/
+/* Finish worker, status 0 on success, reporting its statistics if needed.   */
+/*****************************************************************************/
+void
+gl_batch_pool_exit (gint status)
+{
+        if ( worker_stats_fd >= 0 )
+        {
+                gl_stats_write (worker_stats_fd);
+                close (worker_stats_fd);
+        }
+
+        _exit (status);
+}
+
+
+/*****************************************************************************/
+/* Collect finished workers, optionally waiting for at least one.            */
+/*****************************************************************************/
+void
+gl_batch_pool_reap (gboolean block)
+{
+        pid_t pid;
+        int   status;
+
+        while ( n_running > 0 )
+        {
+                pid = waitpid (-1, &status, block ? 0 : WNOHANG);
+
+                if ( pid > 0 )
+                {
+                        n_running--;
+                        block = FALSE;
+
+                        collect_stats (pid);
+
+                        if ( done_func != NULL )
+                        {
+                                done_func (pid,
+                                           WIFEXITED (status) && (WEXITSTATUS (status) == 0),
+                                           done_user_data);
+                        }
+                }
+                else if ( (pid < 0) && (errno == EINTR) )
+                {
+                        continue;
+                }
+                else
+                {
+                        break;
+                }
+        }
+}
+
+
+/*****************************************************************************/
+/* Wait for all workers to finish.                                           */
+/*****************************************************************************/
+void
+gl_batch_pool_wait_all (void)
+{
+        while ( n_running > 0 )
+        {
+                gl_batch_pool_reap (TRUE);
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Load font configuration before any worker is started.           */
+/*---------------------------------------------------------------------------*/
+static void
+warm_fonts (void)
+{
+        PangoFontMap     *font_map;
+        PangoFontFamily **families;
+        gint              n_families;
+
+        font_map = pango_cairo_font_map_get_default ();
+        pango_font_map_list_families (font_map, &families, &n_families);
+        g_free (families);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free label cache entry.                                         */
+/*---------------------------------------------------------------------------*/
+static void
+label_cache_entry_free (LabelCacheEntry *entry)
+{
+        g_object_unref (entry->label);
+        g_free (entry->filename);
+        g_free (entry);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add in statistics reported by finished worker.                  */
+/*---------------------------------------------------------------------------*/
+static void
+collect_stats (pid_t pid)
+{
+        gpointer fd;
+
+        if ( g_hash_table_lookup_extended (stats_fds, GINT_TO_POINTER (pid), NULL, &fd) )
+        {
+                gl_stats_read (GPOINTER_TO_INT (fd));
+                close (GPOINTER_TO_INT (fd));
+                g_hash_table_remove (stats_fds, GINT_TO_POINTER (pid));
+        }
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -0,0 +1,68 @@
+/*
+ *  batch-pool.h
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BATCH_POOL_H__
+#define __BATCH_POOL_H__
+
+#include <glib.h>
+#include <sys/types.h>
+
+#include "batch-job.h"
+
+G_BEGIN_DECLS
+
+
+typedef void (*glBatchPoolDoneFunc) (pid_t     pid,
+                                     gboolean  success,
+                                     gpointer  user_data);
+
+
+void                gl_batch_pool_init                 (gint                 n_workers,
+                                                        glBatchPoolDoneFunc  done_func,
+                                                        gpointer             user_data);
+
+void                gl_batch_pool_shutdown             (void);
+
+glLabel            *gl_batch_pool_get_label            (glBatchJob          *job,
+                                                        glBatchJobResult    *result);
+
+pid_t               gl_batch_pool_fork                 (void);
+
+void                gl_batch_pool_exit                 (gint                 status);
+
+void                gl_batch_pool_reap                 (gboolean             block);
+
+void                gl_batch_pool_wait_all             (void);
+
+
+G_END_DECLS
+
+#endif /* __BATCH_POOL_H__ */
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
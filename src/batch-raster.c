@@ -0,0 +1,578 @@
+/*
+ *  batch-raster.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Raster output: each sheet (or each label) of a job is drawn onto a cairo
+ * image surface and written as a numbered PNG or TIFF file.
+ *
+ * The images are split into contiguous ranges, one per forked worker (see
+ * batch-pool.c), so that each worker can carry its print state from one
+ * sheet to the next.  Within a worker, images are encoded on a separate
+ * thread while the next one is drawn.  Only encoding is threaded: the
+ * label objects themselves are not safe to draw from several threads.
+ */
+
+#include <config.h>
+
+#include "batch-raster.h"
+
+#include <glib/gi18n.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <libglabels.h>
+#include "print.h"
+#include "batch-pool.h"
+#include "stats.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+/* Drawn images waiting to be encoded, per worker. */
+#define MAX_PENDING  4
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        cairo_surface_t     *surface;     /* NULL marks end of images. */
+        gchar               *filename;
+} RasterImage;
+
+typedef struct {
+        glBatchRasterFormat  format;
+        GAsyncQueue         *pending;
+        GAsyncQueue         *done;
+        gint                 n_in_flight;
+        gint                 n_errors;    /* Owned by encoder thread, if any. */
+        GThread             *thread;
+} RasterEncoder;
+
+typedef struct {
+        glBatchJob          *job;
+        glLabel             *label;
+        glBatchRasterFormat  format;
+        gboolean             per_label_flag;
+        gboolean             merge_flag;
+        GPtrArray           *records;     /* Selected records, per label only. */
+        gchar               *abs_fn;
+        gdouble              scale;       /* Pixels per point. */
+        gdouble              width;       /* Size of each image, in points. */
+        gdouble              height;
+        gint                 n_labels;
+        gint                 n_images;
+} RasterJob;
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static gboolean   render_range      (RasterJob       *rj,
+                                     gint             first_image,
+                                     gint             end_image);
+
+static void       encoder_start     (RasterEncoder   *encoder,
+                                     glBatchRasterFormat format);
+
+static void       encoder_push      (RasterEncoder   *encoder,
+                                     cairo_surface_t *surface,
+                                     gchar           *filename);
+
+static gboolean   encoder_finish    (RasterEncoder   *encoder);
+
+static gpointer   encoder_thread    (gpointer         data);
+
+static gboolean   encode_image      (glBatchRasterFormat format,
+                                     cairo_surface_t *surface,
+                                     const gchar     *filename);
+
+static GdkPixbuf *surface_to_pixbuf (cairo_surface_t *surface);
+
+static void       worker_done_cb    (pid_t            pid,
+                                     gboolean         success,
+                                     gpointer         user_data);
+
+
+/*****************************************************************************/
+/* Parse raster format name.                                                 */
+/*****************************************************************************/
+gboolean
+gl_batch_raster_parse_format (const gchar         *string,
+                              glBatchRasterFormat *format)
+{
+        if ( g_ascii_strcasecmp (string, "png") == 0 )
+        {
+                *format = BATCH_RASTER_FORMAT_PNG;
+                return TRUE;
+        }
+        if ( (g_ascii_strcasecmp (string, "tiff") == 0) || (g_ascii_strcasecmp (string, "tif") == 0) )
+        {
+                *format = BATCH_RASTER_FORMAT_TIFF;
+                return TRUE;
+        }
+
+        return FALSE;
+}
+
+
+/*****************************************************************************/
+/* Render job as a series of raster files.                                   */
+/*                                                                           */
+/* Files are named after the job's output, numbered from 1 (e.g.             */
+/* "output-0001.png").  Without merge data every label is the same, so per   */
+/* label output is a single file.                                            */
+/*****************************************************************************/
+gboolean
+gl_batch_raster_run (glBatchJob          *job,
+                     glLabel             *label,
+                     glBatchRasterFormat  format,
+                     gdouble              dpi,
+                     gboolean             per_label_flag,
+                     gint                 n_workers,
+                     glBatchJobResult    *result)
+{
+        GTimer            *timer;
+        const lglTemplate *template;
+        lglTemplateFrame  *frame;
+        glMerge           *merge;
+        const GList       *p;
+        RasterJob          rj;
+        gint               i_worker, n_failed = 0;
+        pid_t              pid;
+        glStatsMark        mark;
+        gboolean           ok;
+
+        gl_debug (DEBUG_PRINT, "START");
+
+        timer = g_timer_new ();
+
+        gl_batch_job_apply_input (job, label);
+
+        gl_stats_mark (&mark);
+
+        template = gl_label_get_template (label);
+        frame    = (lglTemplateFrame *)template->frames->data;
+        merge    = gl_label_get_merge (label);
+
+        rj.job            = job;
+        rj.label          = label;
+        rj.format         = format;
+        rj.per_label_flag = per_label_flag;
+        rj.merge_flag     = (merge != NULL);
+        rj.records        = NULL;
+        rj.abs_fn         = gl_batch_job_output_filename (job,
+                                                          (format == BATCH_RASTER_FORMAT_TIFF) ? ".tif" : ".png");
+        rj.scale          = dpi / 72.0;
+        rj.n_labels       = lgl_template_frame_get_n_labels (frame);
+
+        if ( per_label_flag )
+        {
+                lgl_template_frame_get_size (frame, &rj.width, &rj.height);
+
+                if ( merge != NULL )
+                {
+                        rj.records = g_ptr_array_new ();
+                        for ( p = gl_merge_get_record_list (merge); p != NULL; p = p->next )
+                        {
+                                if ( ((glMergeRecord *)p->data)->select_flag )
+                                {
+                                        g_ptr_array_add (rj.records, p->data);
+                                }
+                        }
+                        rj.n_images = rj.records->len * job->n_copies;
+                }
+                else
+                {
+                        rj.n_images = 1;
+                }
+        }
+        else
+        {
+                rj.width    = template->page_width;
+                rj.height   = template->page_height;
+                rj.n_images = gl_batch_job_get_n_sheets (job, label);
+        }
+
+        n_workers = CLAMP (n_workers, 1, MAX (rj.n_images, 1));
+
+        if ( n_workers == 1 )
+        {
+                ok = render_range (&rj, 0, rj.n_images);
+        }
+        else
+        {
+                gl_batch_pool_init (n_workers, worker_done_cb, &n_failed);
+
+                for ( i_worker = 0; i_worker < n_workers; i_worker++ )
+                {
+                        pid = gl_batch_pool_fork ();
+                        if ( pid == 0 )
+                        {
+                                /* Worker. */
+                                gl_batch_pool_exit ( render_range (&rj,
+                                                                   i_worker * rj.n_images / n_workers,
+                                                                   (i_worker + 1) * rj.n_images / n_workers) ? 0 : 1 );
+                        }
+                        else if ( pid < 0 )
+                        {
+                                fprintf ( stderr, _("cannot start worker\n") );
+                                n_failed++;
+                        }
+                }
+
+                gl_batch_pool_shutdown ();
+
+                ok = (n_failed == 0);
+        }
+
+        gl_stats_add_phase (GL_STATS_PHASE_OUTPUT, &mark);
+
+        result->status      = ok ? BATCH_JOB_OK : BATCH_JOB_ERROR_WRITE;
+        result->n_sheets    = rj.n_images;
+        result->n_labels    = per_label_flag ? rj.n_images : rj.n_images * rj.n_labels;
+        result->render_time = g_timer_elapsed (timer, NULL);
+
+        gl_stats_add_output (result->n_sheets, result->n_labels);
+
+        if ( rj.records != NULL )
+        {
+                g_ptr_array_free (rj.records, TRUE);
+        }
+        if ( merge != NULL )
+        {
+                g_object_unref (merge);
+        }
+        g_free (rj.abs_fn);
+        g_timer_destroy (timer);
+
+        gl_debug (DEBUG_PRINT, "END");
+
+        return ok;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw and encode images first_image up to (not including)        */
+/* end_image.                                                                */
+/*---------------------------------------------------------------------------*/
+static gboolean
+render_range (RasterJob *rj,
+              gint       first_image,
+              gint       end_image)
+{
+        glBatchJob      *job = rj->job;
+        RasterEncoder    encoder;
+        glPrintState     state;
+        cairo_surface_t *surface;
+        cairo_t         *cr;
+        glMergeRecord   *record;
+        gint             i;
+
+        encoder_start (&encoder, rj->format);
+        gl_print_state_init (&state);
+
+        if ( rj->merge_flag && !rj->per_label_flag && (first_image > 0) )
+        {
+                gl_print_state_seek_sheet (rj->label, &state, first_image,
+                                           job->n_copies, job->first, FALSE);
+        }
+
+        for ( i = first_image; i < end_image; i++ )
+        {
+                surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+                                                      ceil (rj->width * rj->scale),
+                                                      ceil (rj->height * rj->scale));
+                cr = cairo_create (surface);
+
+                cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+                cairo_paint (cr);
+                cairo_scale (cr, rj->scale, rj->scale);
+
+                if ( rj->per_label_flag )
+                {
+                        record = NULL;
+                        if ( rj->records != NULL )
+                        {
+                                record = g_ptr_array_index (rj->records, i % rj->records->len);
+                        }
+                        gl_print_label (rj->label, cr, record,
+                                        job->outline_flag, job->reverse_flag, &state);
+                }
+                else if ( rj->merge_flag )
+                {
+                        gl_print_uncollated_merge_sheet (rj->label, cr, i,
+                                                         job->n_copies, job->first,
+                                                         job->outline_flag, job->reverse_flag,
+                                                         job->crop_marks_flag, &state);
+                }
+                else
+                {
+                        gl_print_simple_sheet (rj->label, cr, i, rj->n_images,
+                                               job->first, rj->n_labels,
+                                               job->outline_flag, job->reverse_flag,
+                                               job->crop_marks_flag, &state);
+                }
+
+                cairo_destroy (cr);
+
+                encoder_push (&encoder, surface,
+                              gl_batch_job_numbered_filename (rj->abs_fn, i + 1));
+        }
+
+        gl_print_state_clear (&state);
+
+        return encoder_finish (&encoder);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Start encoder thread.                                           */
+/*---------------------------------------------------------------------------*/
+static void
+encoder_start (RasterEncoder       *encoder,
+               glBatchRasterFormat  format)
+{
+        encoder->format      = format;
+        encoder->pending     = g_async_queue_new ();
+        encoder->done        = g_async_queue_new ();
+        encoder->n_in_flight = 0;
+        encoder->n_errors    = 0;
+
+        encoder->thread = g_thread_create (encoder_thread, encoder, TRUE, NULL);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Queue image for encoding, waiting if too many are queued.       */
+/* Takes ownership of surface and filename.                                  */
+/*---------------------------------------------------------------------------*/
+static void
+encoder_push (RasterEncoder   *encoder,
+              cairo_surface_t *surface,
+              gchar           *filename)
+{
+        RasterImage *image;
+
+        if ( encoder->thread == NULL )
+        {
+                /* No thread, encode here. */
+                if ( !encode_image (encoder->format, surface, filename) )
+                {
+                        encoder->n_errors++;
+                }
+                cairo_surface_destroy (surface);
+                g_free (filename);
+                return;
+        }
+
+        while ( encoder->n_in_flight >= MAX_PENDING )
+        {
+                g_async_queue_pop (encoder->done);
+                encoder->n_in_flight--;
+        }
+
+        image = g_new0 (RasterImage, 1);
+        image->surface  = surface;
+        image->filename = filename;
+
+        encoder->n_in_flight++;
+        g_async_queue_push (encoder->pending, image);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Wait for all queued images to be encoded and stop encoder.      */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encoder_finish (RasterEncoder *encoder)
+{
+        if ( encoder->thread != NULL )
+        {
+                g_async_queue_push (encoder->pending, g_new0 (RasterImage, 1));
+                g_thread_join (encoder->thread);
+        }
+
+        g_async_queue_unref (encoder->pending);
+        g_async_queue_unref (encoder->done);
+
+        return (encoder->n_errors == 0);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Encoder thread.                                                 */
+/*---------------------------------------------------------------------------*/
+static gpointer
+encoder_thread (gpointer data)
+{
+        RasterEncoder *encoder = (RasterEncoder *)data;
+        RasterImage   *image;
+
+        for (;;)
+        {
+                image = (RasterImage *)g_async_queue_pop (encoder->pending);
+
+                if ( image->surface == NULL )
+                {
+                        g_free (image);
+                        break;
+                }
+
+                if ( !encode_image (encoder->format, image->surface, image->filename) )
+                {
+                        encoder->n_errors++;
+                }
+
+                cairo_surface_destroy (image->surface);
+                g_free (image->filename);
+                g_free (image);
+
+                g_async_queue_push (encoder->done, GINT_TO_POINTER (1));
+        }
+
+        return NULL;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Write image surface to file.                                    */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_image (glBatchRasterFormat  format,
+              cairo_surface_t     *surface,
+              const gchar         *filename)
+{
+        GdkPixbuf      *pixbuf;
+        cairo_status_t  status;
+        GError         *error = NULL;
+        gboolean        ok;
+
+        switch (format)
+        {
+
+        case BATCH_RASTER_FORMAT_TIFF:
+                pixbuf = surface_to_pixbuf (surface);
+                ok = gdk_pixbuf_save (pixbuf, filename, "tiff", &error, NULL);
+                if ( !ok )
+                {
+                        fprintf ( stderr, _("cannot write %s: %s\n"),
+                                  filename, error ? error->message : "" );
+                        if ( error )
+                        {
+                                g_error_free (error);
+                        }
+                }
+                g_object_unref (pixbuf);
+                return ok;
+
+        default:
+                status = cairo_surface_write_to_png (surface, filename);
+                if ( status != CAIRO_STATUS_SUCCESS )
+                {
+                        fprintf ( stderr, _("cannot write %s: %s\n"),
+                                  filename, cairo_status_to_string (status) );
+                        return FALSE;
+                }
+                return TRUE;
+
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Copy RGB24 image surface to a new pixbuf.                       */
+/*---------------------------------------------------------------------------*/
+static GdkPixbuf *
+surface_to_pixbuf (cairo_surface_t *surface)
+{
+        GdkPixbuf *pixbuf;
+        gint       width, height, src_stride, dst_stride;
+        guchar    *src, *dst;
+        guint32   *src_row;
+        guchar    *dst_row;
+        gint       x, y;
+
+        cairo_surface_flush (surface);
+
+        width      = cairo_image_surface_get_width (surface);
+        height     = cairo_image_surface_get_height (surface);
+        src_stride = cairo_image_surface_get_stride (surface);
+        src        = cairo_image_surface_get_data (surface);
+
+        pixbuf     = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+        dst_stride = gdk_pixbuf_get_rowstride (pixbuf);
+        dst        = gdk_pixbuf_get_pixels (pixbuf);
+
+        for ( y = 0; y < height; y++ )
+        {
+                src_row = (guint32 *)(src + y * src_stride);
+                dst_row = dst + y * dst_stride;
+
+                for ( x = 0; x < width; x++ )
+                {
+                        dst_row[3*x]     = (src_row[x] >> 16) & 0xff;
+                        dst_row[3*x + 1] = (src_row[x] >> 8)  & 0xff;
+                        dst_row[3*x + 2] =  src_row[x]        & 0xff;
+                }
+        }
+
+        return pixbuf;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Worker finished callback.                                       */
+/*---------------------------------------------------------------------------*/
+static void
+worker_done_cb (pid_t     pid,
+                gboolean  success,
+                gpointer  user_data)
+{
+        gint *n_failed = (gint *)user_data;
+
+        if ( !success )
+        {
+                (*n_failed)++;
+        }
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
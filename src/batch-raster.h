@@ -0,0 +1,62 @@
+/*
+ *  batch-raster.h
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BATCH_RASTER_H__
+#define __BATCH_RASTER_H__
+
+#include <glib.h>
+
+#include "batch-job.h"
+
+G_BEGIN_DECLS
+
+
+typedef enum {
+	BATCH_RASTER_FORMAT_PNG,
+	BATCH_RASTER_FORMAT_TIFF,
+} glBatchRasterFormat;
+
+
+gboolean            gl_batch_raster_parse_format       (const gchar         *string,
+                                                        glBatchRasterFormat *format);
+
+gboolean            gl_batch_raster_run                (glBatchJob          *job,
+                                                        glLabel             *label,
+                                                        glBatchRasterFormat  format,
+                                                        gdouble              dpi,
+                                                        gboolean             per_label_flag,
+                                                        gint                 n_workers,
+                                                        glBatchJobResult    *result);
+
+
+G_END_DECLS
+
+#endif /* __BATCH_RASTER_H__ */
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
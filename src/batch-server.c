@@ -0,0 +1,610 @@
+/*
+ *  batch-server.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The render server accepts one job per connection on a Unix domain socket.
+ * A job is a single line of JSON (see gl_batch_job_new_from_json()); the
+ * reply is a single line of JSON with the job status and timings.  Jobs are
+ * run by the batch worker pool (see batch-pool.c).
+ *
+ * Requests are read from all open connections at once, so that a slow
+ * client does not hold up the others.  The label of each job is still
+ * loaded in the server process, where it stays cached for later jobs.
+ */
+
+#include <config.h>
+
+#include "batch-server.h"
+
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <json-glib/json-glib.h>
+
+#include "batch-job.h"
+#include "batch-pool.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define MAX_REQUEST_SIZE   65536
+#define REQUEST_TIMEOUT    10    /* seconds */
+#define POLL_INTERVAL      1000  /* milliseconds */
+#define MAX_CONNECTIONS    64    /* being read at once */
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef enum {
+        READ_MORE,
+        READ_DONE,
+        READ_FAILED
+} ReadStatus;
+
+typedef struct {
+        gint              fd;
+        GString          *request;
+        GTimer           *timer;
+} Connection;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static volatile sig_atomic_t  quit_flag = 0;
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void      quit_handler          (int               sig);
+
+static gint      open_socket           (const gchar      *socket_path);
+
+static Connection *connection_new      (gint              fd);
+
+static void      connection_free       (Connection       *conn);
+
+static void      handle_connection     (gint              listen_fd,
+                                        GList            *connections,
+                                        Connection       *conn);
+
+static ReadStatus read_request         (Connection       *conn);
+
+static void      send_response         (gint              fd,
+                                        JsonNode         *id,
+                                        const gchar      *error_message,
+                                        glBatchJobResult *result,
+                                        gdouble           queue_time,
+                                        gdouble           total_time);
+
+static void      refresh_merge_src     (glBatchJob       *job,
+                                        glLabel          *label);
+
+
+/*****************************************************************************/
+/* Run render server on given socket until interrupted.                      */
+/*****************************************************************************/
+gboolean
+gl_batch_server_run (const gchar *socket_path,
+                     gint         n_workers)
+{
+        gint              listen_fd, client_fd;
+        struct pollfd     pfds[MAX_CONNECTIONS + 1];
+        gint              n_pfds, i;
+        GList            *connections = NULL;
+        GList            *p, *p_next;
+        Connection       *conn;
+        ReadStatus        status;
+        struct sigaction  action;
+
+        listen_fd = open_socket (socket_path);
+        if ( listen_fd < 0 )
+        {
+                return FALSE;
+        }
+
+        memset (&action, 0, sizeof (action));
+        action.sa_handler = quit_handler;
+        sigemptyset (&action.sa_mask);
+        sigaction (SIGINT,  &action, NULL);
+        sigaction (SIGTERM, &action, NULL);
+
+        /* A client hanging up early must not kill a worker. */
+        signal (SIGPIPE, SIG_IGN);
+
+        gl_batch_pool_init (n_workers, NULL, NULL);
+
+        fprintf ( stderr, _("serving on %s with %d workers\n"), socket_path, n_workers );
+
+        while ( !quit_flag )
+        {
+                gl_batch_pool_reap (FALSE);
+
+                /* Listening socket first, then connections, in list order. */
+                pfds[0].fd      = listen_fd;
+                pfds[0].events  = (g_list_length (connections) < MAX_CONNECTIONS) ? POLLIN : 0;
+                pfds[0].revents = 0;
+                n_pfds = 1;
+                for ( p = connections; p != NULL; p = p->next )
+                {
+                        pfds[n_pfds].fd      = ((Connection *)p->data)->fd;
+                        pfds[n_pfds].events  = POLLIN;
+                        pfds[n_pfds].revents = 0;
+                        n_pfds++;
+                }
+
+                if ( poll (pfds, n_pfds, POLL_INTERVAL) < 0 )
+                {
+                        /* Interrupted. */
+                        continue;
+                }
+
+                for ( p = connections, i = 1; p != NULL; p = p_next, i++ )
+                {
+                        p_next = p->next;
+                        conn   = (Connection *)p->data;
+
+                        if ( pfds[i].revents != 0 )
+                        {
+                                status = read_request (conn);
+                        }
+                        else if ( g_timer_elapsed (conn->timer, NULL) > REQUEST_TIMEOUT )
+                        {
+                                /* Don't let a stalled client hold a slot. */
+                                status = READ_FAILED;
+                        }
+                        else
+                        {
+                                continue;
+                        }
+
+                        if ( status == READ_MORE )
+                        {
+                                continue;
+                        }
+
+                        connections = g_list_delete_link (connections, p);
+                        if ( status == READ_DONE )
+                        {
+                                handle_connection (listen_fd, connections, conn);
+                        }
+                        connection_free (conn);
+                }
+
+                if ( pfds[0].revents & POLLIN )
+                {
+                        client_fd = accept (listen_fd, NULL, NULL);
+                        if ( client_fd >= 0 )
+                        {
+                                fcntl (client_fd, F_SETFL, fcntl (client_fd, F_GETFL) | O_NONBLOCK);
+                                connections = g_list_append (connections,
+                                                             connection_new (client_fd));
+                        }
+                }
+        }
+
+        g_list_foreach (connections, (GFunc)connection_free, NULL);
+        g_list_free (connections);
+
+        close (listen_fd);
+        g_unlink (socket_path);
+
+        gl_batch_pool_shutdown ();
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  SIGINT/SIGTERM handler.                                         */
+/*---------------------------------------------------------------------------*/
+static void
+quit_handler (int sig)
+{
+        quit_flag = 1;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Create listening socket.                                        */
+/*---------------------------------------------------------------------------*/
+static gint
+open_socket (const gchar *socket_path)
+{
+        gint                fd;
+        struct sockaddr_un  addr;
+        struct stat         st;
+        mode_t              old_mask;
+        gint                ret;
+
+        if ( strlen (socket_path) >= sizeof (addr.sun_path) )
+        {
+                fprintf ( stderr, _("socket path too long: %s\n"), socket_path );
+                return -1;
+        }
+
+        /* Remove stale socket from a previous server, but nothing else. */
+        if ( (g_lstat (socket_path, &st) == 0) && S_ISSOCK (st.st_mode) )
+        {
+                g_unlink (socket_path);
+        }
+
+        fd = socket (AF_UNIX, SOCK_STREAM, 0);
+        if ( fd < 0 )
+        {
+                fprintf ( stderr, _("cannot create socket: %s\n"), g_strerror (errno) );
+                return -1;
+        }
+
+        memset (&addr, 0, sizeof (addr));
+        addr.sun_family = AF_UNIX;
+        strcpy (addr.sun_path, socket_path);
+
+        /* Jobs read and write files as the server's user: keep others out. */
+        old_mask = umask (0077);
+        ret = bind (fd, (struct sockaddr *)&addr, sizeof (addr));
+        umask (old_mask);
+
+        if ( (ret < 0) ||
+             (g_chmod (socket_path, 0600) < 0) ||
+             (listen (fd, SOMAXCONN) < 0) )
+        {
+                fprintf ( stderr, _("cannot listen on %s: %s\n"), socket_path, g_strerror (errno) );
+                close (fd);
+                return -1;
+        }
+
+        return fd;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  New connection being read.                                      */
+/*---------------------------------------------------------------------------*/
+static Connection *
+connection_new (gint fd)
+{
+        Connection *conn;
+
+        conn = g_new0 (Connection, 1);
+        conn->fd      = fd;
+        conn->request = g_string_new ("");
+        conn->timer   = g_timer_new ();
+
+        return conn;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Close and free connection.                                      */
+/*---------------------------------------------------------------------------*/
+static void
+connection_free (Connection *conn)
+{
+        close (conn->fd);
+        g_string_free (conn->request, TRUE);
+        g_timer_destroy (conn->timer);
+        g_free (conn);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Hand job of complete request to a worker.                       */
+/*                                                                           */
+/* The other connections, still being read, are closed in the worker.        */
+/*---------------------------------------------------------------------------*/
+static void
+handle_connection (gint        listen_fd,
+                   GList      *connections,
+                   Connection *conn)
+{
+        gint              client_fd = conn->fd;
+        GTimer           *timer     = conn->timer;
+        GList            *p;
+        JsonParser       *parser;
+        JsonNode         *root, *id = NULL;
+        JsonObject       *object;
+        glBatchJob       *job = NULL;
+        glLabel          *label;
+        glBatchJobResult  result;
+        gdouble           queue_time;
+        gchar            *error_message = NULL;
+        GError           *error = NULL;
+        pid_t             pid;
+
+        memset (&result, 0, sizeof (result));
+
+        /* Replies are written in one go. */
+        fcntl (client_fd, F_SETFL, fcntl (client_fd, F_GETFL) & ~O_NONBLOCK);
+
+        parser = json_parser_new ();
+        if ( !json_parser_load_from_data (parser, conn->request->str, -1, &error) )
+        {
+                error_message = g_strdup (error->message);
+                g_error_free (error);
+                goto reply_error;
+        }
+
+        root = json_parser_get_root (parser);
+        if ( (root == NULL) || !JSON_NODE_HOLDS_OBJECT (root) )
+        {
+                error_message = g_strdup (_("request is not a JSON object"));
+                goto reply_error;
+        }
+        object = json_node_get_object (root);
+
+        if ( json_object_has_member (object, "id") )
+        {
+                id = json_node_copy (json_object_get_member (object, "id"));
+        }
+
+        if ( !json_object_has_member (object, "output") )
+        {
+                error_message = g_strdup (_("missing \"output\""));
+                goto reply_error;
+        }
+
+        job = gl_batch_job_new_from_json (object, &error_message);
+        if ( job == NULL )
+        {
+                goto reply_error;
+        }
+
+        label = gl_batch_pool_get_label (job, &result);
+        if ( label == NULL )
+        {
+                error_message = g_strdup (gl_batch_job_status_message (result.status));
+                goto reply_error;
+        }
+
+        pid = gl_batch_pool_fork ();
+        if ( pid == 0 )
+        {
+                /* Worker. */
+                close (listen_fd);
+                for ( p = connections; p != NULL; p = p->next )
+                {
+                        close (((Connection *)p->data)->fd);
+                }
+
+                queue_time = g_timer_elapsed (timer, NULL) - result.load_time;
+
+                refresh_merge_src (job, label);
+                gl_batch_job_print (job, label, &result);
+
+                send_response (client_fd, id,
+                               (result.status == BATCH_JOB_OK) ? NULL : gl_batch_job_status_message (result.status),
+                               &result, queue_time, g_timer_elapsed (timer, NULL));
+                close (client_fd);
+
+                gl_batch_pool_exit ( (result.status == BATCH_JOB_OK) ? 0 : 1 );
+        }
+        else if ( pid < 0 )
+        {
+                error_message = g_strdup_printf (_("cannot start worker: %s"), g_strerror (errno));
+                goto reply_error;
+        }
+
+        goto done;
+
+reply_error:
+        send_response (client_fd, id, error_message, &result, 0.0, g_timer_elapsed (timer, NULL));
+
+done:
+        if ( id != NULL )
+        {
+                json_node_free (id);
+        }
+        gl_batch_job_free (job);
+        g_free (error_message);
+        g_object_unref (parser);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Read what has arrived of one line request from client.          */
+/*                                                                           */
+/* Returns READ_DONE once the whole line is in conn->request (without the   */
+/* newline, which a client may also leave out by closing its end), and      */
+/* READ_FAILED if the client went away first or sent too much.              */
+/*---------------------------------------------------------------------------*/
+static ReadStatus
+read_request (Connection *conn)
+{
+        gchar           buf[4096];
+        gchar          *newline;
+        ssize_t         n;
+
+        while ( conn->request->len < MAX_REQUEST_SIZE )
+        {
+                n = read (conn->fd, buf, sizeof (buf));
+                if ( (n < 0) && (errno == EINTR) )
+                {
+                        continue;
+                }
+                if ( (n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)) )
+                {
+                        return READ_MORE;
+                }
+                if ( n < 0 )
+                {
+                        return READ_FAILED;
+                }
+                if ( n == 0 )
+                {
+                        /* Client closed its end without a newline. */
+                        return (conn->request->len > 0) ? READ_DONE : READ_FAILED;
+                }
+
+                g_string_append_len (conn->request, buf, n);
+
+                newline = strchr (conn->request->str, '\n');
+                if ( newline != NULL )
+                {
+                        g_string_truncate (conn->request, newline - conn->request->str);
+                        return READ_DONE;
+                }
+        }
+
+        return READ_FAILED;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Send one line response to client.                               */
+/*---------------------------------------------------------------------------*/
+static void
+send_response (gint              fd,
+               JsonNode         *id,
+               const gchar      *error_message,
+               glBatchJobResult *result,
+               gdouble           queue_time,
+               gdouble           total_time)
+{
+        JsonBuilder   *builder;
+        JsonGenerator *generator;
+        JsonNode      *root;
+        gchar         *data, *p;
+        gsize          length;
+        ssize_t        n;
+
+        builder = json_builder_new ();
+        json_builder_begin_object (builder);
+
+        if ( id != NULL )
+        {
+                json_builder_set_member_name (builder, "id");
+                json_builder_add_value (builder, json_node_copy (id));
+        }
+
+        json_builder_set_member_name (builder, "status");
+        json_builder_add_string_value (builder, error_message ? "error" : "ok");
+
+        if ( error_message != NULL )
+        {
+                json_builder_set_member_name (builder, "message");
+                json_builder_add_string_value (builder, error_message);
+        }
+        else
+        {
+                json_builder_set_member_name (builder, "sheets");
+                json_builder_add_int_value (builder, result->n_sheets);
+                json_builder_set_member_name (builder, "up-to-date");
+                json_builder_add_boolean_value (builder, result->up_to_date);
+        }
+
+        json_builder_set_member_name (builder, "load-time");
+        json_builder_add_double_value (builder, result->load_time);
+        json_builder_set_member_name (builder, "queue-time");
+        json_builder_add_double_value (builder, queue_time);
+        json_builder_set_member_name (builder, "render-time");
+        json_builder_add_double_value (builder, result->render_time);
+        json_builder_set_member_name (builder, "total-time");
+        json_builder_add_double_value (builder, total_time);
+
+        json_builder_end_object (builder);
+
+        root = json_builder_get_root (builder);
+        generator = json_generator_new ();
+        json_generator_set_root (generator, root);
+        data = json_generator_to_data (generator, &length);
+
+        data = g_realloc (data, length + 2);
+        data[length++] = '\n';
+        data[length]   = '\0';
+
+        for ( p = data; length > 0; )
+        {
+                n = write (fd, p, length);
+                if ( (n < 0) && (errno == EINTR) )
+                {
+                        continue;
+                }
+                if ( n <= 0 )
+                {
+                        break;
+                }
+                p      += n;
+                length -= n;
+        }
+
+        g_free (data);
+        json_node_free (root);
+        g_object_unref (generator);
+        g_object_unref (builder);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Re-read label's own merge source.                               */
+/*                                                                           */
+/* Records are read when a label is opened, so a cached label may hold stale */
+/* data.  Unless the job names its own merge source, merge from the label's. */
+/*---------------------------------------------------------------------------*/
+static void
+refresh_merge_src (glBatchJob *job,
+                   glLabel    *label)
+{
+        glMerge *merge;
+
+        if ( job->input != NULL )
+        {
+                return;
+        }
+
+        merge = gl_label_get_merge (label);
+        if ( merge != NULL )
+        {
+                job->input = gl_merge_get_src (merge);
+                g_object_unref (merge);
+        }
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
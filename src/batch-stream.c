@@ -0,0 +1,271 @@
+/*
+ *  batch-stream.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Streaming merge output, for merge data read from a pipe ("--input -").
+ * Records are read one at a time through the merge object's stream cursor
+ * and each sheet is written to the PDF as soon as it is full, so neither
+ * the merge data nor the record count is needed up front, and memory use
+ * does not grow with the number of records.
+ *
+ * Since the records can only be read once, copies are collated (each record
+ * is repeated n_copies times in a row), and only one job can be run.  There
+ * is no way back into the data, so the job's checkpoint, resume and
+ * incremental options are not used; glabels-batch rejects them.
+ */
+
+#include <config.h>
+
+#include "batch-stream.h"
+
+#include <glib/gi18n.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cairo.h>
+#include <cairo-pdf.h>
+
+#include <libglabels.h>
+#include "print.h"
+#include "file-util.h"
+#include "stats.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        glBatchJob          *job;
+        glLabel             *label;
+        cairo_t             *cr;
+        glPrintState         state;
+        GList               *slots;       /* Record of each label, in reverse. */
+        gint                 first;       /* First label of current sheet. */
+        gint                 n_slots;
+        gint                 n_sheets;
+        gint                 n_labels;
+} StreamJob;
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void       flush_sheet       (StreamJob       *sj);
+
+static void       free_records      (GList          **records,
+                                     glMergeRecord   *keep);
+
+
+/*****************************************************************************/
+/* Print merge job, streaming records from the job's input.                  */
+/*****************************************************************************/
+gboolean
+gl_batch_stream_run (glBatchJob          *job,
+                     glLabel             *label,
+                     glBatchJobResult    *result)
+{
+        GTimer            *timer;
+        glStatsMark        mark;
+        const lglTemplate *template;
+        lglTemplateFrame  *frame;
+        glMerge           *merge;
+        glMergeRecord     *record = NULL;
+        GList             *owned = NULL;
+        StreamJob          sj;
+        cairo_surface_t   *surface;
+        gchar             *abs_fn;
+        gint               n_per_sheet, i_record, copies_left = 0;
+        gboolean           ok;
+
+        gl_debug (DEBUG_PRINT, "START");
+
+        memset (result, 0, sizeof (glBatchJobResult));
+
+        merge = gl_label_get_merge (label);
+        if ( merge == NULL )
+        {
+                fprintf ( stderr,
+                          _("cannot perform document merge with glabels file %s\n"),
+                          job->label_filename );
+                result->status = BATCH_JOB_ERROR_OPEN_LABEL;
+                return FALSE;
+        }
+
+        timer = g_timer_new ();
+        gl_stats_mark (&mark);
+
+        template    = gl_label_get_template (label);
+        frame       = (lglTemplateFrame *)template->frames->data;
+        n_per_sheet = lgl_template_frame_get_n_labels (frame);
+
+        abs_fn  = gl_file_util_make_absolute (job->output);
+        surface = cairo_pdf_surface_create (abs_fn, template->page_width, template->page_height);
+
+        sj.job      = job;
+        sj.label    = label;
+        sj.cr       = cairo_create (surface);
+        sj.slots    = NULL;
+        sj.first    = CLAMP (job->first, 1, n_per_sheet);
+        sj.n_slots  = sj.first - 1;
+        sj.n_sheets = 0;
+        sj.n_labels = 0;
+        gl_print_state_init (&sj.state);
+
+        gl_merge_stream_open (merge, job->input);
+
+        for ( i_record = 1; ; )
+        {
+                if ( copies_left == 0 )
+                {
+                        if ( (job->last_record > 0) && (i_record > job->last_record) )
+                        {
+                                break;
+                        }
+
+                        record = gl_merge_stream_get_record (merge);
+                        if ( record == NULL )
+                        {
+                                break;
+                        }
+
+                        if ( (i_record++ < job->first_record) || !record->select_flag )
+                        {
+                                gl_merge_free_record (&record);
+                                continue;
+                        }
+
+                        owned       = g_list_prepend (owned, record);
+                        copies_left = MAX (job->n_copies, 1);
+                }
+
+                sj.slots = g_list_prepend (sj.slots, record);
+                sj.n_slots++;
+                copies_left--;
+
+                if ( sj.n_slots == n_per_sheet )
+                {
+                        flush_sheet (&sj);
+
+                        /* Keep current record if copies remain for next sheet. */
+                        free_records (&owned, (copies_left > 0) ? record : NULL);
+                }
+        }
+
+        if ( sj.slots != NULL )
+        {
+                flush_sheet (&sj);
+        }
+        free_records (&owned, NULL);
+
+        gl_merge_stream_close (merge);
+
+        cairo_destroy (sj.cr);
+        cairo_surface_finish (surface);
+        ok = (cairo_surface_status (surface) == CAIRO_STATUS_SUCCESS);
+        if ( !ok )
+        {
+                fprintf ( stderr, _("cannot write %s: %s\n"),
+                          abs_fn, cairo_status_to_string (cairo_surface_status (surface)) );
+        }
+        cairo_surface_destroy (surface);
+
+        gl_print_state_clear (&sj.state);
+        g_object_unref (merge);
+        g_free (abs_fn);
+
+        gl_stats_add_phase (GL_STATS_PHASE_OUTPUT, &mark);
+
+        result->status      = ok ? BATCH_JOB_OK : BATCH_JOB_ERROR_WRITE;
+        result->n_sheets    = sj.n_sheets;
+        result->n_labels    = sj.n_labels;
+        result->render_time = g_timer_elapsed (timer, NULL);
+        g_timer_destroy (timer);
+
+        gl_stats_add_output (result->n_sheets, result->n_labels);
+
+        gl_debug (DEBUG_PRINT, "END");
+
+        return ok;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Print labels collected for current sheet.                       */
+/*---------------------------------------------------------------------------*/
+static void
+flush_sheet (StreamJob *sj)
+{
+        glBatchJob *job = sj->job;
+
+        sj->slots = g_list_reverse (sj->slots);
+
+        gl_print_record_sheet (sj->label, sj->cr, sj->slots, sj->first,
+                               job->outline_flag, job->reverse_flag, job->crop_marks_flag,
+                               &sj->state);
+        cairo_show_page (sj->cr);
+
+        sj->n_sheets++;
+        sj->n_labels += g_list_length (sj->slots);
+
+        g_list_free (sj->slots);
+        sj->slots   = NULL;
+        sj->first   = 1;
+        sj->n_slots = 0;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free records that have been printed, except keep (if not NULL). */
+/*---------------------------------------------------------------------------*/
+static void
+free_records (GList         **records,
+              glMergeRecord  *keep)
+{
+        GList         *p;
+        glMergeRecord *record;
+
+        for ( p = *records; p != NULL; p = p->next )
+        {
+                record = (glMergeRecord *)p->data;
+                if ( record != keep )
+                {
+                        gl_merge_free_record (&record);
+                }
+        }
+        g_list_free (*records);
+
+        *records = (keep != NULL) ? g_list_prepend (NULL, keep) : NULL;
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
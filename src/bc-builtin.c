@@ -0,0 +1,1133 @@
+/*
+ *  bc-builtin.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This module implements the common linear symbologies (EAN-8, EAN-13,
+ * UPC-A, UPC-E, Code 39, Code 128 and Interleaved 2 of 5) directly from
+ * their pattern tables.  Each encoder builds a list of module widths, which
+ * is then laid out the same way as the GNU Barcode backend lays out its
+ * "partial" strings, without going through any intermediate text.
+ */
+
+#include <config.h>
+
+#include "bc-builtin.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+#define MARGIN        10	/* Quiet zone, in modules, as GNU Barcode */
+#define SHRINK_AMOUNT 0.15	/* shrink bars to account for ink spreading */
+#define FONT_SCALE    0.95	/* Shrink fonts just a hair */
+
+#define GUARD         0x80	/* Element flag: bar extends into text area */
+#define WIDTH_MASK    0x7f
+
+#define TEXT_SIZE     12.0	/* Font sizes, in modules */
+#define SMALL_SIZE    8.0
+#define PAIR_SIZE     9.0
+
+#define EAN_QUIET     9		/* Room left of bars for digit outside */
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        gdouble      x;          /* Modules from left of symbol. */
+        gdouble      size;       /* Font size in modules. */
+        gchar        c;
+} SymbolChar;
+
+/*
+ * Symbol under construction.  Elements alternate space, bar, space, ...
+ * starting with a leading space, so bars have odd indices.
+ */
+typedef struct {
+        guint8      *elements;
+        gint         n_elements;
+        gint         n_bars;
+        gint         n_modules;
+
+        SymbolChar  *chars;
+        gint         n_chars;
+} Symbol;
+
+typedef gboolean (*EncodeFunc) (Symbol      *sym,
+                                const gchar *data,
+                                gboolean     checksum_flag);
+
+typedef struct {
+        const gchar *id;
+        EncodeFunc   encode;
+} Encoder;
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static gboolean   encode_ean13    (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode_ean8     (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode_upca     (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode_upce     (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode_code39   (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode_code128  (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode_code128b (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode_code128c (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode_i25      (Symbol      *sym,
+                                   const gchar *data,
+                                   gboolean     checksum_flag);
+
+static gboolean   encode          (const gchar *id,
+                                   gboolean     checksum_flag,
+                                   const gchar *digits,
+                                   Symbol      *sym);
+
+static void       layout          (Symbol      *sym,
+                                   gboolean     text_flag,
+                                   gdouble      w,
+                                   gdouble      h,
+                                   gdouble     *scalef,
+                                   gdouble     *width,
+                                   gdouble     *height);
+
+static glBarcode *render          (Symbol      *sym,
+                                   gboolean     text_flag,
+                                   gdouble      w,
+                                   gdouble      h);
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static const Encoder encoders[] = {
+        { "EAN-8",    encode_ean8 },
+        { "EAN-13",   encode_ean13 },
+        { "UPC-A",    encode_upca },
+        { "UPC-E",    encode_upce },
+        { "Code39",   encode_code39 },
+        { "Code128",  encode_code128 },
+        { "Code128B", encode_code128b },
+        { "Code128C", encode_code128c },
+        { "I25",      encode_i25 },
+        { NULL,       NULL }
+};
+
+/* EAN/UPC digits, odd parity ("L" set): space, bar, space, bar. */
+static const gchar *ean_digits[] = {
+        "3211", "2221", "2122", "1411", "1132",
+        "1231", "1114", "1312", "1213", "3112"
+};
+
+/* EAN-13 parity of left half digits, by first digit (1 = even, "G" set). */
+static const gchar *ean13_parity[] = {
+        "000000", "001011", "001101", "001110", "010011",
+        "011001", "011100", "010101", "010110", "011010"
+};
+
+/* UPC-E parity, number system 0, by check digit (1 = even, "G" set). */
+static const gchar *upce_parity[] = {
+        "111000", "110100", "110010", "110001", "101100",
+        "100110", "100011", "101010", "101001", "100101"
+};
+
+/* Code 39: bar, space, ... bar; then a narrow inter-character gap. */
+static const gchar code39_alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-. $/+%";
+static const gchar *code39_patterns[] = {
+        "111221211", "211211112", "112211112", "212211111", "111221112",
+        "211221111", "112221111", "111211212", "211211211", "112211211",
+        "211112112", "112112112", "212112111", "111122112", "211122111",
+        "112122111", "111112212", "211112211", "112112211", "111122211",
+        "211111122", "112111122", "212111121", "111121122", "211121121",
+        "112121121", "111111222", "211111221", "112111221", "111121221",
+        "221111112", "122111112", "222111111", "121121112", "221121111",
+        "122121111", "121111212", "221111211", "122111211", "121212111",
+        "121211121", "121112121", "111212121"
+};
+static const gchar *code39_start_stop = "121121211";
+
+/* Code 128: bar, space, bar, space, bar, space; values 0-105, then stop. */
+static const gchar *code128_patterns[] = {
+        "212222", "222122", "222221", "121223", "121322", "131222", "122213",
+        "122312", "132212", "221213", "221312", "231212", "112232", "122132",
+        "122231", "113222", "123122", "123221", "223211", "221132", "221231",
+        "213212", "223112", "312131", "311222", "321122", "321221", "312212",
+        "322112", "322211", "212123", "212321", "232121", "111323", "131123",
+        "131321", "112313", "132113", "132311", "211313", "231113", "231311",
+        "112133", "112331", "132131", "113123", "113321", "133121", "313121",
+        "211331", "231131", "213113", "213311", "213131", "311123", "311321",
+        "331121", "312113", "312311", "332111", "314111", "221411", "431111",
+        "111224", "111422", "121124", "121421", "141122", "141221", "112214",
+        "112412", "122114", "122411", "142112", "142211", "241211", "221114",
+        "413111", "241112", "134111", "111242", "121142", "121241", "114212",
+        "124112", "124211", "411212", "421112", "421211", "212141", "214121",
+        "412121", "111143", "111341", "131141", "114113", "114311", "411113",
+        "411311", "113141", "114131", "311141", "411131", "211412", "211214",
+        "211232"
+};
+static const gchar *code128_stop = "2331112";
+
+#define CODE128_CODE_C   99
+#define CODE128_CODE_B  100
+#define CODE128_CODE_A  101
+#define CODE128_START_A 103
+#define CODE128_START_B 104
+#define CODE128_START_C 105
+
+/* Interleaved 2 of 5: widths of the five bars (or spaces) of a digit. */
+static const gchar *i25_patterns[] = {
+        "11331", "31113", "13113", "33111", "11313",
+        "31311", "13311", "11133", "31131", "13131"
+};
+static const gchar *i25_start = "1111";
+static const gchar *i25_stop  = "311";
+
+
+/*****************************************************************************/
+/* Generate intermediate representation of barcode.                          */
+/*****************************************************************************/
+glBarcode *
+gl_barcode_builtin_new (const gchar    *id,
+                        gboolean        text_flag,
+                        gboolean        checksum_flag,
+                        gdouble         w,
+                        gdouble         h,
+                        const gchar    *digits)
+{
+        Symbol     sym;
+        glBarcode *gbc = NULL;
+
+        if ( encode (id, checksum_flag, digits, &sym) )
+        {
+                gbc = render (&sym, text_flag, w, h);
+        }
+
+        g_free (sym.elements);
+        g_free (sym.chars);
+
+        return gbc;
+}
+
+
+/*****************************************************************************/
+/* Get size of barcode, without creating it.                                 */
+/*****************************************************************************/
+gboolean
+gl_barcode_builtin_measure (const gchar    *id,
+                            gboolean        text_flag,
+                            gboolean        checksum_flag,
+                            gdouble         w,
+                            gdouble         h,
+                            const gchar    *digits,
+                            gdouble        *width,
+                            gdouble        *height)
+{
+        Symbol   sym;
+        gboolean ok;
+        gdouble  scalef, area_w, area_h;
+
+        ok = encode (id, checksum_flag, digits, &sym);
+        if ( ok )
+        {
+                layout (&sym, text_flag, w, h, &scalef, &area_w, &area_h);
+
+                *width  = area_w + 2.0 * MARGIN;
+                *height = area_h + 2.0 * MARGIN;
+        }
+
+        g_free (sym.elements);
+        g_free (sym.chars);
+
+        return ok;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Encode digits as module widths and text.  Caller frees the      */
+/* symbol's arrays, also on failure.                                         */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode (const gchar *id,
+        gboolean     checksum_flag,
+        const gchar *digits,
+        Symbol      *sym)
+{
+        const Encoder *encoder;
+        gint           len;
+
+        sym->elements = NULL;
+        sym->chars    = NULL;
+
+        for ( encoder = encoders; encoder->id != NULL; encoder++ )
+        {
+                if ( g_ascii_strcasecmp (id, encoder->id) == 0 )
+                {
+                        break;
+                }
+        }
+        if ( encoder->id == NULL )
+        {
+                g_message ("Illegal barcode id %s", id);
+                return FALSE;
+        }
+
+        if ( (digits == NULL) || (*digits == '\0') )
+        {
+                return FALSE;
+        }
+
+        /* Worst case is Code 128 switching code set around every character. */
+        len = strlen (digits);
+        sym->elements   = g_new (guint8, 12*len + 32);
+        sym->n_elements = 0;
+        sym->n_bars     = 0;
+        sym->n_modules  = 0;
+        sym->chars      = g_new (SymbolChar, len + 4);
+        sym->n_chars    = 0;
+
+        return encoder->encode (sym, digits, checksum_flag);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Append element widths, continuing the space/bar alternation.    */
+/*---------------------------------------------------------------------------*/
+static void
+add_pattern (Symbol      *sym,
+             const gchar *pattern,
+             gboolean     guard_flag)
+{
+        const gchar *p;
+        guint8       width;
+
+        for ( p = pattern; *p != '\0'; p++ )
+        {
+                width = *p - '0';
+                sym->n_modules += width;
+
+                if ( sym->n_elements % 2 )
+                {
+                        sym->n_bars++;
+                        if ( guard_flag )
+                        {
+                                width |= GUARD;
+                        }
+                }
+
+                sym->elements[sym->n_elements++] = width;
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Append a single space (the symbol must currently end in a bar). */
+/*---------------------------------------------------------------------------*/
+static void
+add_space (Symbol *sym,
+           gint    width)
+{
+        g_assert (sym->n_elements % 2 == 0);
+
+        sym->elements[sym->n_elements++] = width;
+        sym->n_modules += width;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add human readable character.                                   */
+/*---------------------------------------------------------------------------*/
+static void
+add_char (Symbol  *sym,
+          gdouble  x,
+          gdouble  size,
+          gchar    c)
+{
+        sym->chars[sym->n_chars].x    = x;
+        sym->chars[sym->n_chars].size = size;
+        sym->chars[sym->n_chars].c    = c;
+        sym->n_chars++;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Append EAN/UPC digit in given set (L, G or R).                  */
+/*---------------------------------------------------------------------------*/
+static void
+add_ean_digit (Symbol  *sym,
+               gint     digit,
+               gboolean even_flag,
+               gboolean guard_flag)
+{
+        const gchar *p = ean_digits[digit];
+        gchar        reversed[5];
+
+        if ( even_flag )
+        {
+                reversed[0] = p[3];
+                reversed[1] = p[2];
+                reversed[2] = p[1];
+                reversed[3] = p[0];
+                reversed[4] = '\0';
+                p = reversed;
+        }
+
+        add_pattern (sym, p, guard_flag);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Copy between n1 and n2 digits, as values 0-9.                  */
+/*---------------------------------------------------------------------------*/
+static gint
+get_digits (const gchar *data,
+            gint         n1,
+            gint         n2,
+            gint        *d)
+{
+        const gchar *p;
+        gint         n = 0;
+
+        for ( p = data; *p != '\0'; p++ )
+        {
+                if ( !g_ascii_isdigit (*p) || (n == n2) )
+                {
+                        return 0;
+                }
+                d[n++] = *p - '0';
+        }
+
+        return (n >= n1) ? n : 0;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  EAN/UPC check digit of n digits.                                */
+/*---------------------------------------------------------------------------*/
+static gint
+ean_check_digit (const gint *d,
+                 gint        n)
+{
+        gint i, sum = 0;
+
+        /* Weights 3, 1, 3, ... from the rightmost digit. */
+        for ( i = 0; i < n; i++ )
+        {
+                sum += ((n - i) % 2) ? 3*d[i] : d[i];
+        }
+
+        return (10 - (sum % 10)) % 10;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Complete EAN/UPC digits with check digit, or verify it.         */
+/*---------------------------------------------------------------------------*/
+static gboolean
+ean_complete (gint *d,
+              gint  n,
+              gint  n_data)
+{
+        gint check = ean_check_digit (d, n_data);
+
+        if ( n == n_data )
+        {
+                d[n_data] = check;
+                return TRUE;
+        }
+
+        return (d[n_data] == check);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  EAN-13.                                                         */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_ean13 (Symbol      *sym,
+              const gchar *data,
+              gboolean     checksum_flag)
+{
+        gint d[13], n, i;
+
+        n = get_digits (data, 12, 13, d);
+        if ( !n || !ean_complete (d, n, 12) )
+        {
+                return FALSE;
+        }
+
+        add_space (sym, EAN_QUIET);
+        add_char (sym, 0, TEXT_SIZE, '0' + d[0]);
+
+        add_pattern (sym, "111", TRUE);
+        for ( i = 1; i <= 6; i++ )
+        {
+                add_char (sym, sym->n_modules + 0.5, TEXT_SIZE, '0' + d[i]);
+                add_ean_digit (sym, d[i], ean13_parity[d[0]][i-1] == '1', FALSE);
+        }
+        add_pattern (sym, "11111", TRUE);
+        for ( i = 7; i <= 12; i++ )
+        {
+                add_char (sym, sym->n_modules + 0.5, TEXT_SIZE, '0' + d[i]);
+                add_ean_digit (sym, d[i], FALSE, FALSE);
+        }
+        add_pattern (sym, "111", TRUE);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  EAN-8.                                                          */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_ean8 (Symbol      *sym,
+             const gchar *data,
+             gboolean     checksum_flag)
+{
+        gint d[8], n, i;
+
+        n = get_digits (data, 7, 8, d);
+        if ( !n || !ean_complete (d, n, 7) )
+        {
+                return FALSE;
+        }
+
+        add_space (sym, 0);
+
+        add_pattern (sym, "111", TRUE);
+        for ( i = 0; i < 4; i++ )
+        {
+                add_char (sym, sym->n_modules + 0.5, TEXT_SIZE, '0' + d[i]);
+                add_ean_digit (sym, d[i], FALSE, FALSE);
+        }
+        add_pattern (sym, "11111", TRUE);
+        for ( i = 4; i < 8; i++ )
+        {
+                add_char (sym, sym->n_modules + 0.5, TEXT_SIZE, '0' + d[i]);
+                add_ean_digit (sym, d[i], FALSE, FALSE);
+        }
+        add_pattern (sym, "111", TRUE);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  UPC-A.  First and last digits are printed outside, small.       */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_upca (Symbol      *sym,
+             const gchar *data,
+             gboolean     checksum_flag)
+{
+        gint d[12], n, i;
+
+        n = get_digits (data, 11, 12, d);
+        if ( !n || !ean_complete (d, n, 11) )
+        {
+                return FALSE;
+        }
+
+        add_space (sym, EAN_QUIET);
+        add_char (sym, 0, SMALL_SIZE, '0' + d[0]);
+
+        add_pattern (sym, "111", TRUE);
+        for ( i = 0; i < 6; i++ )
+        {
+                if ( i > 0 )
+                {
+                        add_char (sym, sym->n_modules + 0.5, TEXT_SIZE, '0' + d[i]);
+                }
+                add_ean_digit (sym, d[i], FALSE, (i == 0));
+        }
+        add_pattern (sym, "11111", TRUE);
+        for ( i = 6; i < 12; i++ )
+        {
+                if ( i < 11 )
+                {
+                        add_char (sym, sym->n_modules + 0.5, TEXT_SIZE, '0' + d[i]);
+                }
+                add_ean_digit (sym, d[i], FALSE, (i == 11));
+        }
+        add_pattern (sym, "111", TRUE);
+
+        add_char (sym, sym->n_modules + 2, SMALL_SIZE, '0' + d[11]);
+        add_space (sym, EAN_QUIET);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  UPC-E, from 6 digits (number system 0), or number system and 6  */
+/* digits, optionally followed by the check digit.                           */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_upce (Symbol      *sym,
+             const gchar *data,
+             gboolean     checksum_flag)
+{
+        gint         d[8], e[8], a[11], n, i, check;
+        const gchar *parity;
+
+        n = get_digits (data, 6, 8, d);
+        if ( !n )
+        {
+                return FALSE;
+        }
+
+        /* e = number system, 6 digits, check. */
+        if ( n == 6 )
+        {
+                e[0] = 0;
+                memcpy (&e[1], d, 6*sizeof(gint));
+        }
+        else
+        {
+                memcpy (e, d, n*sizeof(gint));
+        }
+        if ( e[0] > 1 )
+        {
+                return FALSE;
+        }
+
+        /* Check digit is that of the equivalent UPC-A number. */
+        memset (a, 0, sizeof(a));
+        a[0] = e[0];
+        switch (e[6])
+        {
+        case 0:
+        case 1:
+        case 2:
+                a[1] = e[1]; a[2] = e[2]; a[3] = e[6];
+                a[8] = e[3]; a[9] = e[4]; a[10] = e[5];
+                break;
+        case 3:
+                a[1] = e[1]; a[2] = e[2]; a[3] = e[3];
+                a[9] = e[4]; a[10] = e[5];
+                break;
+        case 4:
+                a[1] = e[1]; a[2] = e[2]; a[3] = e[3]; a[4] = e[4];
+                a[10] = e[5];
+                break;
+        default:
+                a[1] = e[1]; a[2] = e[2]; a[3] = e[3]; a[4] = e[4]; a[5] = e[5];
+                a[10] = e[6];
+                break;
+        }
+        check = ean_check_digit (a, 11);
+        if ( (n == 8) && (e[7] != check) )
+        {
+                return FALSE;
+        }
+        e[7] = check;
+
+        parity = upce_parity[e[7]];
+
+        add_space (sym, EAN_QUIET);
+        add_char (sym, 0, SMALL_SIZE, '0' + e[0]);
+
+        add_pattern (sym, "111", TRUE);
+        for ( i = 1; i <= 6; i++ )
+        {
+                add_char (sym, sym->n_modules + 0.5, TEXT_SIZE, '0' + e[i]);
+                /* Number system 1 uses the opposite parities. */
+                add_ean_digit (sym, e[i], (parity[i-1] == '1') != (e[0] == 1), FALSE);
+        }
+        add_pattern (sym, "111111", TRUE);
+
+        add_char (sym, sym->n_modules + 2, SMALL_SIZE, '0' + e[7]);
+        add_space (sym, EAN_QUIET);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Code 39, with optional modulo 43 check character.               */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_code39 (Symbol      *sym,
+               const gchar *data,
+               gboolean     checksum_flag)
+{
+        const gchar *p, *q;
+        gint         value, sum = 0;
+        gchar        c;
+
+        add_space (sym, 0);
+        add_pattern (sym, code39_start_stop, FALSE);
+        add_space (sym, 1);
+
+        for ( p = data; *p != '\0'; p++ )
+        {
+                c = g_ascii_toupper (*p);
+                q = strchr (code39_alphabet, c);
+                if ( q == NULL )
+                {
+                        return FALSE;
+                }
+                value = q - code39_alphabet;
+                sum  += value;
+
+                add_char (sym, sym->n_modules + 3, TEXT_SIZE, c);
+                add_pattern (sym, code39_patterns[value], FALSE);
+                add_space (sym, 1);
+        }
+
+        if ( checksum_flag )
+        {
+                add_pattern (sym, code39_patterns[sum % 43], FALSE);
+                add_space (sym, 1);
+        }
+
+        add_pattern (sym, code39_start_stop, FALSE);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Append Code 128 symbol character.                               */
+/*---------------------------------------------------------------------------*/
+static void
+add_code128_value (Symbol *sym,
+                   gint    value,
+                   gint   *sum,
+                   gint   *position)
+{
+        *sum += (*position > 0) ? (*position) * value : value;
+        (*position)++;
+
+        add_pattern (sym, code128_patterns[value], FALSE);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Append Code 128 check character and stop pattern.               */
+/*---------------------------------------------------------------------------*/
+static void
+add_code128_stop (Symbol *sym,
+                  gint    sum)
+{
+        add_pattern (sym, code128_patterns[sum % 103], FALSE);
+        add_pattern (sym, code128_stop, FALSE);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Count digits at start of string.                                */
+/*---------------------------------------------------------------------------*/
+static gint
+count_digits (const gchar *p)
+{
+        gint n = 0;
+
+        while ( g_ascii_isdigit (p[n]) )
+        {
+                n++;
+        }
+
+        return n;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Code 128, choosing code sets A, B and C as the data requires.   */
+/* Runs of four or more digits use code set C.                               */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_code128 (Symbol      *sym,
+                const gchar *data,
+                gboolean     checksum_flag)
+{
+        const guchar *p;
+        gint          set, sum = 0, position = 0, n_digits;
+        gdouble       x;
+
+        for ( p = (const guchar *)data; *p != '\0'; p++ )
+        {
+                if ( *p > 127 )
+                {
+                        return FALSE;
+                }
+        }
+
+        add_space (sym, 0);
+
+        p = (const guchar *)data;
+        n_digits = count_digits ((const gchar *)p);
+        if ( (n_digits >= 4) || ((n_digits >= 2) && (p[n_digits] == '\0') && !(n_digits % 2)) )
+        {
+                set = CODE128_START_C;
+        }
+        else
+        {
+                set = (*p < 32) ? CODE128_START_A : CODE128_START_B;
+        }
+        add_code128_value (sym, set, &sum, &position);
+
+        while ( *p != '\0' )
+        {
+                n_digits = count_digits ((const gchar *)p);
+
+                if ( set == CODE128_START_C )
+                {
+                        if ( n_digits >= 2 )
+                        {
+                                x = sym->n_modules;
+                                add_char (sym, x + 0.5, PAIR_SIZE, p[0]);
+                                add_char (sym, x + 5.5, PAIR_SIZE, p[1]);
+                                add_code128_value (sym, 10*(p[0]-'0') + (p[1]-'0'), &sum, &position);
+                                p += 2;
+                                continue;
+                        }
+
+                        set = (*p < 32) ? CODE128_START_A : CODE128_START_B;
+                        add_code128_value (sym, (set == CODE128_START_A) ? CODE128_CODE_A : CODE128_CODE_B,
+                                           &sum, &position);
+                }
+                else if ( (n_digits >= 4) && !(n_digits % 2) )
+                {
+                        set = CODE128_START_C;
+                        add_code128_value (sym, CODE128_CODE_C, &sum, &position);
+                        continue;
+                }
+                else if ( (set == CODE128_START_B) && (*p < 32) )
+                {
+                        set = CODE128_START_A;
+                        add_code128_value (sym, CODE128_CODE_A, &sum, &position);
+                }
+                else if ( (set == CODE128_START_A) && (*p >= 96) )
+                {
+                        set = CODE128_START_B;
+                        add_code128_value (sym, CODE128_CODE_B, &sum, &position);
+                }
+
+                /* An odd digit run of four or more is entered after one digit. */
+                if ( *p >= 32 )
+                {
+                        add_char (sym, sym->n_modules + 2, TEXT_SIZE, *p);
+                }
+                add_code128_value (sym, (*p < 32) ? (*p + 64) : (*p - 32), &sum, &position);
+                p++;
+        }
+
+        add_code128_stop (sym, sum);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Code 128, code set B only.                                      */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_code128b (Symbol      *sym,
+                 const gchar *data,
+                 gboolean     checksum_flag)
+{
+        const guchar *p;
+        gint          sum = 0, position = 0;
+
+        add_space (sym, 0);
+        add_code128_value (sym, CODE128_START_B, &sum, &position);
+
+        for ( p = (const guchar *)data; *p != '\0'; p++ )
+        {
+                if ( (*p < 32) || (*p > 127) )
+                {
+                        return FALSE;
+                }
+
+                add_char (sym, sym->n_modules + 2, TEXT_SIZE, *p);
+                add_code128_value (sym, *p - 32, &sum, &position);
+        }
+
+        add_code128_stop (sym, sum);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Code 128, code set C only (even number of digits).              */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_code128c (Symbol      *sym,
+                 const gchar *data,
+                 gboolean     checksum_flag)
+{
+        const gchar *p;
+        gint         n_digits, sum = 0, position = 0;
+        gdouble      x;
+
+        n_digits = count_digits (data);
+        if ( (data[n_digits] != '\0') || (n_digits % 2) )
+        {
+                return FALSE;
+        }
+
+        add_space (sym, 0);
+        add_code128_value (sym, CODE128_START_C, &sum, &position);
+
+        for ( p = data; *p != '\0'; p += 2 )
+        {
+                x = sym->n_modules;
+                add_char (sym, x + 0.5, PAIR_SIZE, p[0]);
+                add_char (sym, x + 5.5, PAIR_SIZE, p[1]);
+                add_code128_value (sym, 10*(p[0]-'0') + (p[1]-'0'), &sum, &position);
+        }
+
+        add_code128_stop (sym, sum);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Interleaved 2 of 5, with optional check digit.  A leading zero  */
+/* is added when needed to make an even number of digits.                    */
+/*---------------------------------------------------------------------------*/
+static gboolean
+encode_i25 (Symbol      *sym,
+            const gchar *data,
+            gboolean     checksum_flag)
+{
+        gint        *d;
+        gint         n_data, n, i, j, sum;
+        const gchar *bars, *spaces;
+        gchar        pair[11];
+
+        n_data = count_digits (data);
+        if ( (n_data == 0) || (data[n_data] != '\0') )
+        {
+                return FALSE;
+        }
+
+        /* Room for leading zero and check digit. */
+        d = g_new (gint, n_data + 2);
+
+        n = ((n_data + (checksum_flag ? 1 : 0)) % 2) ? 1 : 0;
+        d[0] = 0;
+        for ( i = 0; i < n_data; i++ )
+        {
+                d[n++] = data[i] - '0';
+        }
+
+        if ( checksum_flag )
+        {
+                /* Weights 3, 1, 3, ... from the rightmost digit. */
+                sum = 0;
+                for ( i = 0; i < n; i++ )
+                {
+                        sum += ((n - i) % 2) ? 3*d[i] : d[i];
+                }
+                d[n++] = (10 - (sum % 10)) % 10;
+        }
+
+        add_space (sym, 0);
+        add_pattern (sym, i25_start, FALSE);
+
+        pair[10] = '\0';
+        for ( i = 0; i < n; i += 2 )
+        {
+                add_char (sym, sym->n_modules + 0.5, TEXT_SIZE, '0' + d[i]);
+                add_char (sym, sym->n_modules + 9.5, TEXT_SIZE, '0' + d[i+1]);
+
+                /* First digit in the bars, second in the spaces. */
+                bars   = i25_patterns[d[i]];
+                spaces = i25_patterns[d[i+1]];
+                for ( j = 0; j < 5; j++ )
+                {
+                        pair[2*j]   = bars[j];
+                        pair[2*j+1] = spaces[j];
+                }
+                add_pattern (sym, pair, FALSE);
+        }
+
+        add_pattern (sym, i25_stop, FALSE);
+
+        g_free (d);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Scale symbol to fit w by h, giving scale factor and the size of */
+/* the area holding the bars and text (without the margin).                  */
+/*                                                                           */
+/* This follows the GNU Barcode backend's layout: a fixed margin, bars       */
+/* scaled by a uniform factor, and room for the text below the bars.         */
+/*---------------------------------------------------------------------------*/
+static void
+layout (Symbol   *sym,
+        gboolean  text_flag,
+        gdouble   w,
+        gdouble   h,
+        gdouble  *scalef_out,
+        gdouble  *width_out,
+        gdouble  *height_out)
+{
+        gdouble    width, height, scalef;
+        gint       min_height;
+
+        width  = w;
+        height = h;
+        if ( width > 2*MARGIN )
+        {
+                width -= 2*MARGIN;
+        }
+        if ( height > 2*MARGIN )
+        {
+                height -= 2*MARGIN;
+        }
+
+        /* The scale factor depends on bar length */
+        if ( width == 0 )
+        {
+                width = sym->n_modules;
+        }
+        scalef = width / sym->n_modules;
+        if ( scalef < 0.5 )
+        {
+                scalef = 0.5;
+        }
+
+        /* The width is then "just enough" */
+        width = sym->n_modules * scalef + 1;
+
+        /* The height defaults to 80 points, and leaves room for the text. */
+        if ( height == 0 )
+        {
+                height = 80 * scalef;
+        }
+        min_height = 5 + (text_flag ? 10 : 0);
+        if ( height < min_height * scalef )
+        {
+                height = min_height * scalef;
+        }
+
+        *scalef_out = scalef;
+        *width_out  = width;
+        *height_out = height;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Lay out symbol as glBarcode, scaled to fit w by h.  Bars stop   */
+/* above the text, except guard bars, which extend half way into it.         */
+/*---------------------------------------------------------------------------*/
+static glBarcode *
+render (Symbol   *sym,
+        gboolean  text_flag,
+        gdouble   w,
+        gdouble   h)
+{
+        glBarcode *gbc;
+        gdouble    width, height, scalef, x, bar_w, bar_h;
+        gint       i;
+
+        layout (sym, text_flag, w, h, &scalef, &width, &height);
+
+        gbc = g_new0 (glBarcode, 1);
+        gl_barcode_reserve (gbc, sym->n_bars, text_flag ? sym->n_chars : 0);
+        gbc->bar_shrink = SHRINK_AMOUNT;
+
+        x = MARGIN;
+        for ( i = 0; i < sym->n_elements; i++ )
+        {
+                bar_w = (sym->elements[i] & WIDTH_MASK) * scalef;
+
+                if ( i % 2 )
+                {
+                        bar_h = height;
+                        if ( text_flag )
+                        {
+                                bar_h -= ((sym->elements[i] & GUARD) ? 5 : 10) * scalef;
+                        }
+                        gl_barcode_add_line (gbc, x + bar_w/2, MARGIN, bar_h, bar_w - SHRINK_AMOUNT);
+                }
+
+                x += bar_w;
+        }
+
+        if ( text_flag )
+        {
+                for ( i = 0; i < sym->n_chars; i++ )
+                {
+                        gl_barcode_add_char (gbc,
+                                             sym->chars[i].x * scalef + MARGIN,
+                                             MARGIN + height - 8 * scalef,
+                                             sym->chars[i].size * FONT_SCALE * scalef,
+                                             sym->chars[i].c);
+                }
+        }
+
+        gbc->height = height + 2.0 * MARGIN;
+        gbc->width  = width  + 2.0 * MARGIN;
+
+        return gbc;
+}
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
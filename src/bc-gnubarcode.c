@@ -39,9 +39,70 @@
 #define FONT_SCALE    0.95	/* Shrink fonts just a hair */
 
 
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+/*
+ * Symbology of each id.  Data is pre-filtered by length for subtypes:  n1 to
+ * n2 digits (if n2 > 0), and an add-on of m1 to m2 digits (if m2 > 0).
+ */
+typedef struct {
+	gchar            *id;
+	gint              flags;
+	gint              n1, n2;
+	gint              m1, m2;
+} Symbology;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static const Symbology symbologies[] = {
+
+	{ "EAN",       BARCODE_EAN,    0,  0, 0, 0 },
+	{ "EAN-8",     BARCODE_EAN,    7,  8, 0, 0 },
+	{ "EAN-8+2",   BARCODE_EAN,    7,  8, 2, 2 },
+	{ "EAN-8+5",   BARCODE_EAN,    7,  8, 5, 5 },
+	{ "EAN-13",    BARCODE_EAN,   12, 13, 0, 0 },
+	{ "EAN-13+2",  BARCODE_EAN,   12, 13, 2, 2 },
+	{ "EAN-13+5",  BARCODE_EAN,   12, 13, 5, 5 },
+	{ "UPC",       BARCODE_UPC,    0,  0, 0, 0 },
+	{ "UPC-A",     BARCODE_UPC,   11, 12, 0, 0 },
+	{ "UPC-A+2",   BARCODE_UPC,   11, 12, 2, 2 },
+	{ "UPC-A+5",   BARCODE_UPC,   11, 12, 5, 5 },
+	{ "UPC-E",     BARCODE_UPC,    6,  8, 0, 0 },
+	{ "UPC-E+2",   BARCODE_UPC,    6,  8, 2, 2 },
+	{ "UPC-E+5",   BARCODE_UPC,    6,  8, 5, 5 },
+	{ "ISBN",      BARCODE_ISBN,   9, 10, 0, 0 },
+	{ "ISBN+5",    BARCODE_ISBN,   9, 10, 5, 5 },
+	{ "Code39",    BARCODE_39,     0,  0, 0, 0 },
+	{ "Code128",   BARCODE_128,    0,  0, 0, 0 },
+	{ "Code128C",  BARCODE_128C,   0,  0, 0, 0 },
+	{ "Code128B",  BARCODE_128B,   0,  0, 0, 0 },
+	{ "I25",       BARCODE_I25,    0,  0, 0, 0 },
+	{ "CBR",       BARCODE_CBR,    0,  0, 0, 0 },
+	{ "MSI",       BARCODE_MSI,    0,  0, 0, 0 },
+	{ "PLS",       BARCODE_PLS,    0,  0, 0, 0 },
+	{ "Code93",    BARCODE_93,     0,  0, 0, 0 },
+
+	{ NULL, 0, 0, 0, 0, 0 }
+
+};
+
+/* Canonical id (lower case) -> entry of above table, built on first use. */
+static GOnce       symbology_once  = G_ONCE_INIT;
+static GHashTable *symbology_index = NULL;
+
+
 /*===========================================*/
 /* Local function prototypes                 */
 /*===========================================*/
+static const Symbology *lookup_symbology (const gchar *id);
+
+static gpointer   symbology_init   (gpointer             data);
+
 static glBarcode *render_pass1     (struct Barcode_Item *bci,
 				    gint                 flags);
 
@@ -71,104 +132,28 @@ gl_barcode_gnubarcode_new (const gchar    *id,
 {
 	glBarcode           *gbc;
 	struct Barcode_Item *bci;
+	const Symbology     *symbology;
 	gint                 flags;
 
 	/* Assign type flag.  Pre-filter by length for subtypes. */
-	if (g_ascii_strcasecmp (id, "EAN") == 0) {
-		flags = BARCODE_EAN;
-	} else if (g_ascii_strcasecmp (id, "EAN-8") == 0) {
-		if (!is_length_valid (digits, 7, 8)) {
-			return NULL;
-		}
-		flags = BARCODE_EAN;
-	} else if (g_ascii_strcasecmp (id, "EAN-8+2") == 0) {
-		if (!is_length1_valid (digits, 7, 8) || !is_length2_valid (digits, 2, 2)) {
-			return NULL;
-		}
-		flags = BARCODE_EAN;
-	} else if (g_ascii_strcasecmp (id, "EAN-8+5") == 0) {
-		if (!is_length1_valid (digits, 7, 8) || !is_length2_valid (digits, 5, 5)) {
-			return NULL;
-		}
-		flags = BARCODE_EAN;
-	} else if (g_ascii_strcasecmp (id, "EAN-13") == 0) {
-		if (!is_length_valid (digits, 12, 13)) {
-			return NULL;
-		}
-		flags = BARCODE_EAN;
-	} else if (g_ascii_strcasecmp (id, "EAN-13+2") == 0) {
-		if (!is_length1_valid (digits, 12,13) || !is_length2_valid (digits, 2,2)) {
-			return NULL;
-		}
-		flags = BARCODE_EAN;
-	} else if (g_ascii_strcasecmp (id, "EAN-13+5") == 0) {
-		if (!is_length1_valid (digits, 12,13) || !is_length2_valid (digits, 5,5)) {
-			return NULL;
-		}
-		flags = BARCODE_EAN;
-	} else if (g_ascii_strcasecmp (id, "UPC") == 0) {
-		flags = BARCODE_UPC;
-	} else if (g_ascii_strcasecmp (id, "UPC-A") == 0) {
-		if (!is_length_valid (digits, 11, 12)) {
-			return NULL;
-		}
-		flags = BARCODE_UPC;
-	} else if (g_ascii_strcasecmp (id, "UPC-A+2") == 0) {
-		if (!is_length1_valid (digits, 11,12) || !is_length2_valid (digits, 2,2)) {
-			return NULL;
-		}
-		flags = BARCODE_UPC;
-	} else if (g_ascii_strcasecmp (id, "UPC-A+5") == 0) {
-		if (!is_length1_valid (digits, 11,12) || !is_length2_valid (digits, 5,5)) {
-			return NULL;
-		}
-		flags = BARCODE_UPC;
-	} else if (g_ascii_strcasecmp (id, "UPC-E") == 0) {
-		if (!is_length_valid (digits, 6, 8)) {
-			return NULL;
-		}
-		flags = BARCODE_UPC;
-	} else if (g_ascii_strcasecmp (id, "UPC-E+2") == 0) {
-		if (!is_length1_valid (digits, 6, 8) || !is_length2_valid (digits, 2,2)) {
-			return NULL;
-		}
-		flags = BARCODE_UPC;
-	} else if (g_ascii_strcasecmp (id, "UPC-E+5") == 0) {
-		if (!is_length1_valid (digits, 6, 8) || !is_length2_valid (digits, 5,5)) {
-			return NULL;
-		}
-		flags = BARCODE_UPC;
-	} else if (g_ascii_strcasecmp (id, "ISBN") == 0) {
-		if (!is_length_valid (digits, 9, 10)) {
-			return NULL;
-		}
-		flags = BARCODE_ISBN;
-	} else if (g_ascii_strcasecmp (id, "ISBN+5") == 0) {
-		if (!is_length1_valid (digits, 9, 10) || !is_length2_valid (digits, 5,5)) {
-			return NULL;
-		}
-		flags = BARCODE_ISBN;
-	} else if (g_ascii_strcasecmp (id, "Code39") == 0) {
-		flags = BARCODE_39;
-	} else if (g_ascii_strcasecmp (id, "Code128") == 0) {
-		flags = BARCODE_128;
-	} else if (g_ascii_strcasecmp (id, "Code128C") == 0) {
-		flags = BARCODE_128C;
-	} else if (g_ascii_strcasecmp (id, "Code128B") == 0) {
-		flags = BARCODE_128B;
-	} else if (g_ascii_strcasecmp (id, "I25") == 0) {
-		flags = BARCODE_I25;
-	} else if (g_ascii_strcasecmp (id, "CBR") == 0) {
-		flags = BARCODE_CBR;
-	} else if (g_ascii_strcasecmp (id, "MSI") == 0) {
-		flags = BARCODE_MSI;
-	} else if (g_ascii_strcasecmp (id, "PLS") == 0) {
-		flags = BARCODE_PLS;
-	} else if (g_ascii_strcasecmp (id, "Code93") == 0) {
-		flags = BARCODE_93;
-	} else {
+	symbology = lookup_symbology (id);
+	if (symbology == NULL) {
 		g_message( "Illegal barcode id %s", id );
 		flags = BARCODE_ANY;
+	} else {
+		if (symbology->n2 > 0) {
+			if (symbology->m2 == 0) {
+				if (!is_length_valid (digits, symbology->n1, symbology->n2)) {
+					return NULL;
+				}
+			} else {
+				if (!is_length1_valid (digits, symbology->n1, symbology->n2) ||
+				    !is_length2_valid (digits, symbology->m1, symbology->m2)) {
+					return NULL;
+				}
+			}
+		}
+		flags = symbology->flags;
 	}
 
 
@@ -201,6 +186,45 @@ gl_barcode_gnubarcode_new (const gchar    *id,
 }
 
 
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Look up symbology of id, NULL if unknown.                      */
+/*--------------------------------------------------------------------------*/
+static const Symbology *
+lookup_symbology (const gchar *id)
+{
+	const Symbology *symbology;
+	gchar           *key;
+
+	g_once (&symbology_once, symbology_init, NULL);
+
+	key = g_ascii_strdown (id, -1);
+	symbology = g_hash_table_lookup (symbology_index, key);
+	g_free (key);
+
+	return symbology;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Build index of symbologies table.                              */
+/*--------------------------------------------------------------------------*/
+static gpointer
+symbology_init (gpointer data)
+{
+	gint i;
+
+	symbology_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (i=0; symbologies[i].id != NULL; i++) {
+		g_hash_table_insert (symbology_index,
+				     g_ascii_strdown (symbologies[i].id, -1),
+				     (gpointer)&symbologies[i]);
+	}
+
+	return NULL;
+}
+
+
 /*--------------------------------------------------------------------------
  * PRIVATE.  Render to glBarcode intermediate representation of barcode.
  *
@@ -217,8 +241,6 @@ render_pass1 (struct Barcode_Item *bci,
 {
 	gint                 validbits = BARCODE_NO_ASCII;
 	glBarcode           *gbc;
-	glBarcodeShapeLine  *line;
-	glBarcodeShapeAlpha *bchar;
 	gdouble              scalef = 1.0;
 	gdouble              x;
 	gint                 i, j, barlen;
@@ -285,6 +307,7 @@ render_pass1 (struct Barcode_Item *bci,
 	}
 
 	gbc = g_new0 (glBarcode, 1);
+	gbc->bar_shrink = SHRINK_AMOUNT;
 
 	/* Now traverse the code string and create a list of lines */
 	x = bci->margin + (bci->partial[0] - '0') * scalef;
@@ -315,12 +338,8 @@ render_pass1 (struct Barcode_Item *bci,
 					yr -= (isdigit (*p) ? 20 : 10) * scalef;
 				}
 			}
-                        line = gl_barcode_shape_line_new ();
-			line->x = x0;
-			line->y = y0;
-			line->length = yr;
-			line->width = (j * scalef) - SHRINK_AMOUNT;
-                        gl_barcode_add_shape (gbc, (glBarcodeShape *)line);
+                        gl_barcode_add_line (gbc, x0, y0, yr,
+                                             (j * scalef) - SHRINK_AMOUNT);
 		}
 		x += j * scalef;
 
@@ -342,17 +361,14 @@ render_pass1 (struct Barcode_Item *bci,
 				g_message ("impossible data: %s", p);
 				continue;
 			}
-                        bchar = gl_barcode_shape_alpha_new ();
-			bchar->x = f1 * scalef + bci->margin;
 			if (mode == '-') {
-				bchar->y =
-				    bci->margin + bci->height - 8 * scalef;
+				y0 = bci->margin + bci->height - 8 * scalef;
 			} else {
-				bchar->y = bci->margin;
+				y0 = bci->margin;
 			}
-			bchar->fsize = f2 * FONT_SCALE * scalef;
-			bchar->c = c;
-                        gl_barcode_add_shape (gbc, (glBarcodeShape *)bchar);
+                        gl_barcode_add_char (gbc,
+                                             f1 * scalef + bci->margin, y0,
+                                             f2 * FONT_SCALE * scalef, c);
 		}
 	}
 
@@ -96,7 +96,6 @@ render_iec16022 (const gchar *grid,
                  gdouble      h)
 {
         glBarcode          *gbc;
-        glBarcodeShapeLine *line;
         gint                x, y;
         gdouble             aspect_ratio, pixel_size;
 
@@ -117,8 +116,9 @@ render_iec16022 (const gchar *grid,
         }
 
         gbc = g_new0 (glBarcode, 1);
+        gl_barcode_set_matrix (gbc, i_width, i_height, pixel_size);
 
-        /* Now traverse the code string and create a list of boxes */
+        /* Now traverse the code string and mark the dark modules */
         for ( y = i_height-1; y >= 0; y-- )
         {
 
@@ -127,12 +127,7 @@ render_iec16022 (const gchar *grid,
 
                         if (*grid++)
                         {
-                                line = gl_barcode_shape_line_new ();
-                                line->x      = x*pixel_size + pixel_size/2.0;
-                                line->y      = y*pixel_size;
-                                line->length = pixel_size;
-                                line->width  = pixel_size;
-                                gl_barcode_add_shape (gbc, (glBarcodeShape *)line);
+                                gl_barcode_set_module (gbc, x, y);
                         }
 
                 }
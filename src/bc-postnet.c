@@ -29,6 +29,7 @@
 
 #include <glib.h>
 #include <ctype.h>
+#include <string.h>
 
 #include "debug.h"
 
@@ -68,6 +69,9 @@ static gchar *frame_symbol = "1";
 /*===========================================*/
 static gchar    *postnet_code    (const gchar *digits);
 
+static gboolean  is_valid        (const gchar *id,
+				  const gchar *digits);
+
 static gboolean  is_length_valid (const gchar *digits,
 				  gint         n);
 
@@ -85,36 +89,10 @@ gl_barcode_postnet_new (const gchar    *id,
 {
         gchar              *code, *p;
         glBarcode          *gbc;
-        glBarcodeShapeLine *line;
-        gdouble             x;
+        gdouble             x, y, length;
 
-	/* Validate code length for all subtypes. */
-	if ( (g_ascii_strcasecmp (id, "POSTNET") == 0) ) {
-		if (!is_length_valid (digits, 5) &&
-		    !is_length_valid (digits, 9) &&
-		    !is_length_valid (digits, 11)) {
-			return NULL;
-		}
-	}
-	if ( (g_ascii_strcasecmp (id, "POSTNET-5") == 0) ) {
-		if (!is_length_valid (digits, 5)) {
-			return NULL;
-		}
-	}
-	if ( (g_ascii_strcasecmp (id, "POSTNET-9") == 0) ) {
-		if (!is_length_valid (digits, 9)) {
-			return NULL;
-		}
-	}
-	if ( (g_ascii_strcasecmp (id, "POSTNET-11") == 0) ) {
-		if (!is_length_valid (digits, 11)) {
-			return NULL;
-		}
-	}
-	if ( (g_ascii_strcasecmp (id, "CEPNET") == 0) ) {
-		if (!is_length_valid (digits, 8)) {
-			return NULL;
-		}
+	if (!is_valid (id, digits)) {
+		return NULL;
 	}
 
 	/* First get code string */
@@ -124,23 +102,20 @@ gl_barcode_postnet_new (const gchar    *id,
 	}
 
 	gbc = g_new0 (glBarcode, 1);
+	gl_barcode_reserve (gbc, strlen (code), 0);
 
 	/* Now traverse the code string and create a list of lines */
 	x = POSTNET_HORIZ_MARGIN;
 	for (p = code; *p != 0; p++) {
-                line = gl_barcode_shape_line_new ();
-		line->x = x;
-		line->y = POSTNET_VERT_MARGIN;
+		y = POSTNET_VERT_MARGIN;
 		if (*p == '0') {
-			line->y +=
-			    POSTNET_FULLBAR_HEIGHT - POSTNET_HALFBAR_HEIGHT;
-			line->length = POSTNET_HALFBAR_HEIGHT;
+			y += POSTNET_FULLBAR_HEIGHT - POSTNET_HALFBAR_HEIGHT;
+			length = POSTNET_HALFBAR_HEIGHT;
 		} else {
-			line->length = POSTNET_FULLBAR_HEIGHT;
+			length = POSTNET_FULLBAR_HEIGHT;
 		}
-		line->width = POSTNET_BAR_WIDTH;
 
-                gl_barcode_add_shape (gbc, (glBarcodeShape *)line);
+                gl_barcode_add_line (gbc, x, y, length, POSTNET_BAR_WIDTH);
 
 		x += POSTNET_BAR_PITCH;
 	}
@@ -154,6 +129,41 @@ gl_barcode_postnet_new (const gchar    *id,
 }
 
 
+/****************************************************************************/
+/* Get size of barcode for the given digits, without creating it.           */
+/****************************************************************************/
+gboolean
+gl_barcode_postnet_measure (const gchar    *id,
+			    gboolean        text_flag,
+			    gboolean        checksum_flag,
+			    gdouble         w,
+			    gdouble         h,
+			    const gchar    *digits,
+			    gdouble        *width,
+			    gdouble        *height)
+{
+	const gchar *p;
+	gint         n_digits, n_bars;
+
+	if (!is_valid (id, digits)) {
+		return FALSE;
+	}
+
+	/* Same digits as postnet_code(): at most 11, plus correction. */
+	for (p = digits, n_digits = 0; (*p != 0) && (n_digits < 11); p++) {
+		if (g_ascii_isdigit (*p)) {
+			n_digits++;
+		}
+	}
+	n_bars = strlen (frame_symbol) * 2 + 5 * (n_digits + 1);
+
+	*width  = 2 * POSTNET_HORIZ_MARGIN + n_bars * POSTNET_BAR_PITCH;
+	*height = POSTNET_FULLBAR_HEIGHT + 2 * POSTNET_VERT_MARGIN;
+
+	return TRUE;
+}
+
+
 /*--------------------------------------------------------------------------*/
 /* PRIVATE.  Generate string of symbols, representing barcode.              */
 /*--------------------------------------------------------------------------*/
@@ -194,6 +204,45 @@ postnet_code (const gchar *digits)
 }
 
 
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Validate code length for all subtypes.                         */
+/*--------------------------------------------------------------------------*/
+static gboolean
+is_valid (const gchar *id,
+	  const gchar *digits)
+{
+	if ( (g_ascii_strcasecmp (id, "POSTNET") == 0) ) {
+		if (!is_length_valid (digits, 5) &&
+		    !is_length_valid (digits, 9) &&
+		    !is_length_valid (digits, 11)) {
+			return FALSE;
+		}
+	}
+	if ( (g_ascii_strcasecmp (id, "POSTNET-5") == 0) ) {
+		if (!is_length_valid (digits, 5)) {
+			return FALSE;
+		}
+	}
+	if ( (g_ascii_strcasecmp (id, "POSTNET-9") == 0) ) {
+		if (!is_length_valid (digits, 9)) {
+			return FALSE;
+		}
+	}
+	if ( (g_ascii_strcasecmp (id, "POSTNET-11") == 0) ) {
+		if (!is_length_valid (digits, 11)) {
+			return FALSE;
+		}
+	}
+	if ( (g_ascii_strcasecmp (id, "CEPNET") == 0) ) {
+		if (!is_length_valid (digits, 8)) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
 /*--------------------------------------------------------------------------*/
 /* Validate specific length of string (for subtypes).                       */
 /*--------------------------------------------------------------------------*/
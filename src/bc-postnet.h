@@ -32,6 +32,15 @@ glBarcode *gl_barcode_postnet_new (const gchar    *id,
 				   gdouble         h,
 				   const gchar    *digits);
 
+gboolean   gl_barcode_postnet_measure (const gchar    *id,
+				       gboolean        text_flag,
+				       gboolean        checksum_flag,
+				       gdouble         w,
+				       gdouble         h,
+				       const gchar    *digits,
+				       gdouble        *width,
+				       gdouble        *height);
+
 G_END_DECLS
 
 #endif /* __BC_POSTNET_H__ */
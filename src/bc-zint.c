@@ -39,9 +39,105 @@
 #define DEFAULT_H  72
 
 
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+	gchar            *id;
+	gint              code;
+} Symbology;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static const Symbology symbologies[] = {
+
+	{ "AUSP",     BARCODE_AUSPOST },
+	{ "AUSRP",    BARCODE_AUSREPLY },
+	{ "AUSRT",    BARCODE_AUSROUTE },
+	{ "AUSRD",    BARCODE_AUSREDIRECT },
+	{ "AZTEC",    BARCODE_AZTEC },
+	{ "AZRUN",    BARCODE_AZRUNE },
+	{ "CBR",      BARCODE_CODABAR },
+	{ "Code1",    BARCODE_CODEONE },
+	{ "Code11",   BARCODE_CODE11 },
+	{ "C16K",     BARCODE_CODE16K },
+	{ "C25M",     BARCODE_C25MATRIX },
+	{ "C25I",     BARCODE_C25IATA },
+	{ "C25DL",    BARCODE_C25LOGIC },
+	{ "Code32",   BARCODE_CODE32 },
+	{ "Code39",   BARCODE_CODE39 },
+	{ "Code39E",  BARCODE_EXCODE39 },
+	{ "Code49",   BARCODE_CODE49 },
+	{ "Code93",   BARCODE_CODE93 },
+	{ "Code128",  BARCODE_CODE128 },
+	{ "Code128B", BARCODE_CODE128B },
+	{ "DAFT",     BARCODE_DAFT },
+	{ "DMTX",     BARCODE_DATAMATRIX },
+	{ "DPL",      BARCODE_DPLEIT },
+	{ "DPI",      BARCODE_DPIDENT },
+	{ "KIX",      BARCODE_KIX },
+	{ "EAN",      BARCODE_EANX },
+	{ "HIBC128",  BARCODE_HIBC_128 },
+	{ "HIBC39",   BARCODE_HIBC_39 },
+	{ "HIBCDM",   BARCODE_HIBC_DM },
+	{ "HIBCQR",   BARCODE_HIBC_QR },
+	{ "HIBCPDF",  BARCODE_HIBC_MICPDF },
+	{ "HIBCMPDF", BARCODE_HIBC_AZTEC },
+	{ "HIBCAZ",   BARCODE_C25INTER },
+	{ "I25",      BARCODE_C25INTER },
+	{ "ISBN",     BARCODE_ISBNX },
+	{ "ITF14",    BARCODE_ITF14 },
+	{ "GMTX",     BARCODE_GRIDMATRIX },
+	{ "GS1-128",  BARCODE_EAN128 },
+	{ "LOGM",     BARCODE_LOGMARS },
+	{ "RSS14",    BARCODE_RSS14 },
+	{ "RSSLTD",   BARCODE_RSS_LTD },
+	{ "RSSEXP",   BARCODE_RSS_EXP },
+	{ "RSSS",     BARCODE_RSS14STACK },
+	{ "RSSSO",    BARCODE_RSS14STACK_OMNI },
+	{ "RSSSE",    BARCODE_RSS_EXPSTACK },
+	{ "PHARMA",   BARCODE_PHARMA },
+	{ "PHARMA2",  BARCODE_PHARMA_TWO },
+	{ "PZN",      BARCODE_PZN },
+	{ "TELE",     BARCODE_TELEPEN },
+	{ "TELEX",    BARCODE_TELEPEN_NUM },
+	{ "JAPAN",    BARCODE_JAPANPOST },
+	{ "KOREA",    BARCODE_KOREAPOST },
+	{ "MPDF",     BARCODE_MICROPDF417 },
+	{ "MSI",      BARCODE_MSI_PLESSEY },
+	{ "MQR",      BARCODE_MICROQR },
+	{ "NVE",      BARCODE_NVE18 },
+	{ "PLAN",     BARCODE_PLANET },
+	{ "POSTNET",  BARCODE_POSTNET },
+	{ "PDF",      BARCODE_PDF417 },
+	{ "PDFT",     BARCODE_PDF417TRUNC },
+	{ "QR",       BARCODE_QRCODE },
+	{ "RM4",      BARCODE_RM4SCC },
+	{ "UPC-A",    BARCODE_UPCA },
+	{ "UPC-E",    BARCODE_UPCE },
+	{ "USPS",     BARCODE_ONECODE },
+	{ "PLS",      BARCODE_PLESSEY },
+
+	{ NULL, 0 }
+
+};
+
+/* Canonical id (lower case) -> entry of above table, built on first use. */
+static GOnce       symbology_once  = G_ONCE_INIT;
+static GHashTable *symbology_index = NULL;
+
+
 /*===========================================*/
 /* Local function prototypes                 */
 /*===========================================*/
+static const Symbology *lookup_symbology (const gchar *id);
+
+static gpointer   symbology_init  (gpointer data);
+
 static glBarcode *render_zint     (struct zint_symbol *symbol, gboolean text_flag);
 
 
@@ -59,6 +155,7 @@ gl_barcode_zint_new (const gchar          *id,
 {
 	glBarcode           *gbc;
 	struct zint_symbol  *symbol;
+	const Symbology     *symbology;
 	gint                 type;
 	gint		     result;
 
@@ -71,73 +168,11 @@ gl_barcode_zint_new (const gchar          *id,
                 h = DEFAULT_H;
         }
 
-	/* Assign type flag.  Pre-filter by length for subtypes. */
-	if (g_ascii_strcasecmp (id, "AUSP") == 0) { symbol->symbology = BARCODE_AUSPOST; }
-	if (g_ascii_strcasecmp (id, "AUSRP") == 0) { symbol->symbology = BARCODE_AUSREPLY; }
-	if (g_ascii_strcasecmp (id, "AUSRT") == 0) { symbol->symbology = BARCODE_AUSROUTE; }
-	if (g_ascii_strcasecmp (id, "AUSRD") == 0) { symbol->symbology = BARCODE_AUSREDIRECT; }
-	if (g_ascii_strcasecmp (id, "AZTEC") == 0) { symbol->symbology = BARCODE_AZTEC; }
-	if (g_ascii_strcasecmp (id, "AZRUN") == 0) { symbol->symbology = BARCODE_AZRUNE; }
-	if (g_ascii_strcasecmp (id, "CBR") == 0) { symbol->symbology = BARCODE_CODABAR; }
-	if (g_ascii_strcasecmp (id, "Code1") == 0) { symbol->symbology = BARCODE_CODEONE; }
-	if (g_ascii_strcasecmp (id, "Code11") == 0) { symbol->symbology = BARCODE_CODE11; }
-	if (g_ascii_strcasecmp (id, "C16K") == 0) { symbol->symbology = BARCODE_CODE16K; }
-	if (g_ascii_strcasecmp (id, "C25M") == 0) { symbol->symbology = BARCODE_C25MATRIX; }
-	if (g_ascii_strcasecmp (id, "C25I") == 0) { symbol->symbology = BARCODE_C25IATA; }
-	if (g_ascii_strcasecmp (id, "C25DL") == 0) { symbol->symbology = BARCODE_C25LOGIC; }
-	if (g_ascii_strcasecmp (id, "Code32") == 0) { symbol->symbology = BARCODE_CODE32; }
-	if (g_ascii_strcasecmp (id, "Code39") == 0) { symbol->symbology = BARCODE_CODE39; }
-	if (g_ascii_strcasecmp (id, "Code39E") == 0) { symbol->symbology = BARCODE_EXCODE39; }
-	if (g_ascii_strcasecmp (id, "Code49") == 0) { symbol->symbology = BARCODE_CODE49; }
-	if (g_ascii_strcasecmp (id, "Code93") == 0) { symbol->symbology = BARCODE_CODE93; }
-	if (g_ascii_strcasecmp (id, "Code128") == 0) { symbol->symbology = BARCODE_CODE128; }
-	if (g_ascii_strcasecmp (id, "Code128B") == 0) { symbol->symbology = BARCODE_CODE128B; }
-	if (g_ascii_strcasecmp (id, "DAFT") == 0) { symbol->symbology = BARCODE_DAFT; }
-	if (g_ascii_strcasecmp (id, "DMTX") == 0) { symbol->symbology = BARCODE_DATAMATRIX; }
-	if (g_ascii_strcasecmp (id, "DPL") == 0) { symbol->symbology = BARCODE_DPLEIT; }
-	if (g_ascii_strcasecmp (id, "DPI") == 0) { symbol->symbology = BARCODE_DPIDENT; }
-	if (g_ascii_strcasecmp (id, "KIX") == 0) { symbol->symbology = BARCODE_KIX; }
-	if (g_ascii_strcasecmp (id, "EAN") == 0) { symbol->symbology = BARCODE_EANX; }
-	if (g_ascii_strcasecmp (id, "HIBC128") == 0) { symbol->symbology = BARCODE_HIBC_128; }
-	if (g_ascii_strcasecmp (id, "HIBC39") == 0) { symbol->symbology = BARCODE_HIBC_39; }
-	if (g_ascii_strcasecmp (id, "HIBCDM") == 0) { symbol->symbology = BARCODE_HIBC_DM; }
-	if (g_ascii_strcasecmp (id, "HIBCQR") == 0) { symbol->symbology = BARCODE_HIBC_QR; }
-	if (g_ascii_strcasecmp (id, "HIBCPDF") == 0) { symbol->symbology = BARCODE_HIBC_MICPDF; }
-	if (g_ascii_strcasecmp (id, "HIBCMPDF") == 0) { symbol->symbology = BARCODE_HIBC_AZTEC; }
-	if (g_ascii_strcasecmp (id, "HIBCAZ") == 0) { symbol->symbology = BARCODE_C25INTER; }
-	if (g_ascii_strcasecmp (id, "I25") == 0) { symbol->symbology = BARCODE_C25INTER; }
-	if (g_ascii_strcasecmp (id, "ISBN") == 0) { symbol->symbology = BARCODE_ISBNX; }
-	if (g_ascii_strcasecmp (id, "ITF14") == 0) { symbol->symbology = BARCODE_ITF14; }
-	if (g_ascii_strcasecmp (id, "GMTX") == 0) { symbol->symbology = BARCODE_GRIDMATRIX; }
-	if (g_ascii_strcasecmp (id, "GS1-128") == 0) { symbol->symbology = BARCODE_EAN128; }
-	if (g_ascii_strcasecmp (id, "LOGM") == 0) { symbol->symbology = BARCODE_LOGMARS; }
-	if (g_ascii_strcasecmp (id, "RSS14") == 0) { symbol->symbology = BARCODE_RSS14; }
-	if (g_ascii_strcasecmp (id, "RSSLTD") == 0) { symbol->symbology = BARCODE_RSS_LTD; }
-	if (g_ascii_strcasecmp (id, "RSSEXP") == 0) { symbol->symbology = BARCODE_RSS_EXP; }
-	if (g_ascii_strcasecmp (id, "RSSS") == 0) { symbol->symbology = BARCODE_RSS14STACK; }
-	if (g_ascii_strcasecmp (id, "RSSSO") == 0) { symbol->symbology = BARCODE_RSS14STACK_OMNI; }
-	if (g_ascii_strcasecmp (id, "RSSSE") == 0) { symbol->symbology = BARCODE_RSS_EXPSTACK; }
-	if (g_ascii_strcasecmp (id, "PHARMA") == 0) { symbol->symbology = BARCODE_PHARMA; }
-	if (g_ascii_strcasecmp (id, "PHARMA2") == 0) { symbol->symbology = BARCODE_PHARMA_TWO; }
-	if (g_ascii_strcasecmp (id, "PZN") == 0) { symbol->symbology = BARCODE_PZN; }
-	if (g_ascii_strcasecmp (id, "TELE") == 0) { symbol->symbology = BARCODE_TELEPEN; }
-	if (g_ascii_strcasecmp (id, "TELEX") == 0) { symbol->symbology = BARCODE_TELEPEN_NUM; }
-	if (g_ascii_strcasecmp (id, "JAPAN") == 0) { symbol->symbology = BARCODE_JAPANPOST; }
-	if (g_ascii_strcasecmp (id, "KOREA") == 0) { symbol->symbology = BARCODE_KOREAPOST; }
-	if (g_ascii_strcasecmp (id, "MPDF") == 0) { symbol->symbology = BARCODE_MICROPDF417; }
-	if (g_ascii_strcasecmp (id, "MSI") == 0) { symbol->symbology = BARCODE_MSI_PLESSEY; }
-	if (g_ascii_strcasecmp (id, "MQR") == 0) { symbol->symbology = BARCODE_MICROQR; }
-	if (g_ascii_strcasecmp (id, "NVE") == 0) { symbol->symbology = BARCODE_NVE18; }
-	if (g_ascii_strcasecmp (id, "PLAN") == 0) { symbol->symbology = BARCODE_PLANET; }
-	if (g_ascii_strcasecmp (id, "POSTNET") == 0) { symbol->symbology = BARCODE_POSTNET; }
-	if (g_ascii_strcasecmp (id, "PDF") == 0) { symbol->symbology = BARCODE_PDF417; }
-	if (g_ascii_strcasecmp (id, "PDFT") == 0) { symbol->symbology = BARCODE_PDF417TRUNC; }
-	if (g_ascii_strcasecmp (id, "QR") == 0) { symbol->symbology = BARCODE_QRCODE; }
-	if (g_ascii_strcasecmp (id, "RM4") == 0) { symbol->symbology = BARCODE_RM4SCC; }
-	if (g_ascii_strcasecmp (id, "UPC-A") == 0) { symbol->symbology = BARCODE_UPCA; }
-	if (g_ascii_strcasecmp (id, "UPC-E") == 0) { symbol->symbology = BARCODE_UPCE; }
-	if (g_ascii_strcasecmp (id, "USPS") == 0) { symbol->symbology = BARCODE_ONECODE; }
-	if (g_ascii_strcasecmp (id, "PLS") == 0) { symbol->symbology = BARCODE_PLESSEY; }
+	/* Assign symbology, else leave Zint's default. */
+	symbology = lookup_symbology (id);
+	if (symbology != NULL) {
+		symbol->symbology = symbology->code;
+	}
 
 
 	/* Checksum not supported yet!! 
@@ -172,6 +207,45 @@ gl_barcode_zint_new (const gchar          *id,
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Look up Zint symbology of id, NULL if unknown.                  */
+/*---------------------------------------------------------------------------*/
+static const Symbology *
+lookup_symbology (const gchar *id)
+{
+	const Symbology *symbology;
+	gchar           *key;
+
+	g_once (&symbology_once, symbology_init, NULL);
+
+	key = g_ascii_strdown (id, -1);
+	symbology = g_hash_table_lookup (symbology_index, key);
+	g_free (key);
+
+	return symbology;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Build index of symbologies table.                               */
+/*---------------------------------------------------------------------------*/
+static gpointer
+symbology_init (gpointer data)
+{
+	gint i;
+
+	symbology_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (i=0; symbologies[i].id != NULL; i++) {
+		g_hash_table_insert (symbology_index,
+				     g_ascii_strdown (symbologies[i].id, -1),
+				     (gpointer)&symbologies[i]);
+	}
+
+	return NULL;
+}
+
+
 /*--------------------------------------------------------------------------
  * PRIVATE. Render to glBarcode the provided Zint symbol.
  *
@@ -185,8 +259,6 @@ static glBarcode *render_zint(struct zint_symbol *symbol, gboolean text_flag) {
 	double string_offset, x;
 
         glBarcode           *gbc;
-        glBarcodeShapeLine  *line;
-        glBarcodeShapeAlpha *bchar;
 	
 	struct zint_render      *render;
 	struct zint_render_line *zline;
@@ -196,18 +268,16 @@ static glBarcode *render_zint(struct zint_symbol *symbol, gboolean text_flag) {
 
 	render = symbol->rendered;
 	gbc = g_new0(glBarcode, 1);
+	gbc->bar_shrink = bleed_extra * 2;
 	
 	
 	for ( zline = render->lines; zline != NULL; zline = zline->next ) {
-		line = gl_barcode_shape_line_new ();
-
-		line->width = (double) zline->width - (bleed_extra * 2);
-		line->length = (double) zline->length;
-		/* glBarcodeLine centers based on width, counter-act!!! */
-		line->x = (double) (zline->x + (zline->width / 2.0)); // - bleed_extra;
-		line->y = (double) zline->y;
-
-		gl_barcode_add_shape (gbc, (glBarcodeShape *)line);
+		/* glBarcode lines are centered based on width, counter-act!!! */
+		gl_barcode_add_line (gbc,
+				     (double) (zline->x + (zline->width / 2.0)), // - bleed_extra;
+				     (double) zline->y,
+				     (double) zline->length,
+				     (double) zline->width - (bleed_extra * 2));
 	}
 
 	/*
@@ -220,12 +290,11 @@ static glBarcode *render_zint(struct zint_symbol *symbol, gboolean text_flag) {
         x = 0.0;
         // Poor man's kerning
         if (zstring->text[i] == '(') { x = 0.18; }
-				bchar = gl_barcode_shape_alpha_new();
-				bchar->x = (double) string_offset + ((((6.0 / 9.0) * i) + x) * zstring->fsize);
-				bchar->y = (double) zstring->y;
-				bchar->fsize = (double) zstring->fsize;
-				bchar->c = (char) zstring->text[i];
-				gl_barcode_add_shape (gbc, (glBarcodeShape *)bchar);
+				gl_barcode_add_char (gbc,
+						     (double) string_offset + ((((6.0 / 9.0) * i) + x) * zstring->fsize),
+						     (double) zstring->y,
+						     (double) zstring->fsize,
+						     (char) zstring->text[i]);
 			}
 		}
 	}
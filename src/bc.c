@@ -24,8 +24,10 @@
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <string.h>
 
 #include "bc-postnet.h"
+#include "bc-builtin.h"
 #include "bc-gnubarcode.h"
 #include "bc-zint.h"
 #include "bc-iec16022.h"
@@ -38,12 +40,22 @@
 /* Private macros and constants.                          */
 /*========================================================*/
 
+#define CACHE_SIZE     256
+
+#define MIN_BLOCK_SIZE 32
+
 
 /*========================================================*/
 /* Private types.                                         */
 /*========================================================*/
 
-typedef struct {
+/*
+ * Backend entry.  This is the glBarcodeStyle handed out by
+ * gl_barcode_style_lookup().
+ */
+typedef struct _glBarcodeStyle Backend;
+
+struct _glBarcodeStyle {
 	gchar            *id;
 	gchar            *name;
 	glBarcodeNewFunc  new;
@@ -54,7 +66,17 @@ typedef struct {
 	gchar            *default_digits;
 	gboolean          can_freeform;
 	guint             prefered_n;
-} Backend;
+	glBarcodeMeasureFunc measure;	/* Optional, else size by encoding. */
+	gboolean          thread_safe;	/* Backend may encode on any thread. */
+};
+
+/*
+ * Encode cache entry.  A NULL barcode records that the data is invalid.
+ */
+typedef struct {
+	gchar            *key;
+	glBarcode        *gbc;
+} CacheEntry;
 
 
 /*========================================================*/
@@ -64,27 +86,33 @@ typedef struct {
 static const Backend backends[] = {
 
 	{ "POSTNET", N_("POSTNET (any)"), gl_barcode_postnet_new,
-	  FALSE, FALSE, TRUE, FALSE, "12345-6789-12", FALSE, 11},
+	  FALSE, FALSE, TRUE, FALSE, "12345-6789-12", FALSE, 11,
+	  gl_barcode_postnet_measure, TRUE},
 
 	{ "POSTNET-5", N_("POSTNET-5 (ZIP only)"), gl_barcode_postnet_new,
-	  FALSE, FALSE, TRUE, FALSE, "12345", FALSE, 5},
+	  FALSE, FALSE, TRUE, FALSE, "12345", FALSE, 5,
+	  gl_barcode_postnet_measure, TRUE},
 
 	{ "POSTNET-9", N_("POSTNET-9 (ZIP+4)"), gl_barcode_postnet_new,
-	  FALSE, FALSE, TRUE, FALSE, "12345-6789", FALSE, 9},
+	  FALSE, FALSE, TRUE, FALSE, "12345-6789", FALSE, 9,
+	  gl_barcode_postnet_measure, TRUE},
 
 	{ "POSTNET-11", N_("POSTNET-11 (DPBC)"), gl_barcode_postnet_new,
-	  FALSE, FALSE, TRUE, FALSE, "12345-6789-12", FALSE, 11},
+	  FALSE, FALSE, TRUE, FALSE, "12345-6789-12", FALSE, 11,
+	  gl_barcode_postnet_measure, TRUE},
 
 #ifdef HAVE_LIBBARCODE
 
 	{ "CEPNET", N_("CEPNET"), gl_barcode_postnet_new,
-	  FALSE, FALSE, TRUE, FALSE, "12345-678", FALSE, 8},
+	  FALSE, FALSE, TRUE, FALSE, "12345-678", FALSE, 8,
+	  gl_barcode_postnet_measure, TRUE},
 
 	{ "EAN", N_("EAN (any)"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, FALSE, "000000000000 00000", FALSE, 17},
 
-	{ "EAN-8", N_("EAN-8"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, FALSE, "0000000", FALSE, 7},
+	{ "EAN-8", N_("EAN-8"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, FALSE, "0000000", FALSE, 7,
+	  gl_barcode_builtin_measure, TRUE},
 
 	{ "EAN-8+2", N_("EAN-8 +2"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000 00", FALSE, 9},
@@ -92,8 +120,9 @@ static const Backend backends[] = {
 	{ "EAN-8+5", N_("EAN-8 +5"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000 00000", FALSE, 12},
 
-	{ "EAN-13", N_("EAN-13"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, FALSE, "000000000000", FALSE, 12},
+	{ "EAN-13", N_("EAN-13"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, FALSE, "000000000000", FALSE, 12,
+	  gl_barcode_builtin_measure, TRUE},
 
 	{ "EAN-13+2", N_("EAN-13 +2"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, FALSE, "000000000000 00", FALSE, 14},
@@ -104,8 +133,9 @@ static const Backend backends[] = {
 	{ "UPC", N_("UPC (UPC-A or UPC-E)"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, FALSE, "00000000000 00000", FALSE, 16},
 
-	{ "UPC-A", N_("UPC-A"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, FALSE, "00000000000", FALSE, 11},
+	{ "UPC-A", N_("UPC-A"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, FALSE, "00000000000", FALSE, 11,
+	  gl_barcode_builtin_measure, TRUE},
 
 	{ "UPC-A+2", N_("UPC-A +2"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, FALSE, "00000000000 00", FALSE, 13},
@@ -113,8 +143,9 @@ static const Backend backends[] = {
 	{ "UPC-A+5", N_("UPC-A +5"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, FALSE, "00000000000 00000", FALSE, 16},
 
-	{ "UPC-E", N_("UPC-E"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, FALSE, "000000", FALSE, 6},
+	{ "UPC-E", N_("UPC-E"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, FALSE, "000000", FALSE, 6,
+	  gl_barcode_builtin_measure, TRUE},
 
 	{ "UPC-E+2", N_("UPC-E +2"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, FALSE, "000000 00", FALSE, 8},
@@ -128,20 +159,25 @@ static const Backend backends[] = {
 	{ "ISBN+5", N_("ISBN +5"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, TRUE, "0-00000-000-0 00000", FALSE, 15},
 
-	{ "Code39", N_("Code 39"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10},
+	{ "Code39", N_("Code 39"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10,
+	  gl_barcode_builtin_measure, TRUE},
 
-	{ "Code128", N_("Code 128"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10},
+	{ "Code128", N_("Code 128"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10,
+	  gl_barcode_builtin_measure, TRUE},
 
-	{ "Code128C", N_("Code 128C"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
+	{ "Code128C", N_("Code 128C"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10,
+	  gl_barcode_builtin_measure, TRUE},
 
-	{ "Code128B", N_("Code 128B"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10},
+	{ "Code128B", N_("Code 128B"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10,
+	  gl_barcode_builtin_measure, TRUE},
 
-	{ "I25", N_("Interleaved 2 of 5"), gl_barcode_gnubarcode_new,
-	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10},
+	{ "I25", N_("Interleaved 2 of 5"), gl_barcode_builtin_new,
+	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10,
+	  gl_barcode_builtin_measure, TRUE},
 
 	{ "CBR", N_("Codabar"), gl_barcode_gnubarcode_new,
 	  TRUE, TRUE, TRUE, TRUE, "0000000000", TRUE, 10},
@@ -201,8 +237,10 @@ static const Backend backends[] = {
 	{ "Code32", N_("Code 32 (Italian Pharmacode)"),  gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
 
+#ifndef HAVE_LIBBARCODE /* Else built in, see above. */
 	{ "Code39", N_("Code 39"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
+#endif
 	  
 	{ "Code39E", N_("Code 39 Extended"),  gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
@@ -213,11 +251,13 @@ static const Backend backends[] = {
 	{ "Code93", N_("Code 93"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
 
+#ifndef HAVE_LIBBARCODE /* Else built in, see above. */
 	{ "Code128", N_("Code 128"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
 	  
 	{ "Code128B", N_("Code 128 (Mode C supression)"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
+#endif
 	  
 	{ "DAFT", N_("DAFT Code"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
@@ -282,8 +322,10 @@ static const Backend backends[] = {
 	{ "HIBCAZ", N_("HIBC Aztec Code"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
 
+#ifndef HAVE_LIBBARCODE /* Else built in, see above. */
 	{ "I25", N_("Interleaved 2 of 5"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
+#endif
 
 	{ "ISBN", N_("ISBN"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
@@ -345,11 +387,13 @@ static const Backend backends[] = {
 	{ "TELEX", N_("Telepen Numeric"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
 
+#ifndef HAVE_LIBBARCODE /* Else built in, see above. */
 	{ "UPC-A", N_("UPC-A"),  gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "00000000000", FALSE, 11},
 	  
 	{ "UPC-E", N_("UPC-E"),  gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "000000", FALSE, 6},
+#endif
 	  
 	{ "USPS", N_("USPS One Code"), gl_barcode_zint_new,
 	  TRUE, TRUE, TRUE, FALSE, "0000000000", TRUE, 10},
@@ -378,83 +422,142 @@ static const Backend backends[] = {
 };
 
 
+/*
+ * Registry of above table, built on first use:  canonical id (lower case)
+ * and translated name -> backend entry.
+ */
+static GOnce       registry_once = G_ONCE_INIT;
+static GHashTable *id_index      = NULL;
+static GHashTable *name_index    = NULL;
+
+/*
+ * Recently encoded barcodes, most recent first.  Cached barcodes are shared
+ * (reference counted) and must not be modified by callers.
+ */
+G_LOCK_DEFINE_STATIC (cache);
+static GHashTable *cache_index = NULL;   /* key -> link in cache_lru */
+static GQueue     *cache_lru   = NULL;
+static guint       cache_hits   = 0;
+static guint       cache_misses = 0;
+static gboolean    cache_enabled = TRUE;
+
+
 /*========================================================*/
 /* Private function prototypes.                           */
 /*========================================================*/
 
+static gpointer   registry_init    (gpointer      data);
+
+static gboolean   cache_lookup     (const gchar  *key,
+                                    glBarcode   **gbc);
+
+static glBarcode *cache_insert     (gchar        *key,
+                                    glBarcode    *gbc);
+
+static void       cache_entry_free (CacheEntry   *entry);
+
+static void       grow_lines       (glBarcode    *bc,
+                                    guint         size);
+
+static void       grow_chars       (glBarcode    *bc,
+                                    guint         size);
+
 
 /*---------------------------------------------------------------------------*/
-/* Convert id to index into above table.                                     */
+/* Convert id to entry of above table.                                       */
 /*---------------------------------------------------------------------------*/
-static gint
-id_to_index (const gchar *id)
+static const Backend *
+id_to_backend (const gchar *id)
 {
-	gint i;
+	const Backend *backend;
+	gchar         *key;
 
 	if (id == 0) {
-		return 0; /* NULL request default. I.e., the first element. */
+		return &backends[0]; /* NULL request default. I.e., the first element. */
 	}
 
-	for (i=0; backends[i].id != NULL; i++) {
-		if (g_ascii_strcasecmp (id, backends[i].id) == 0) {
-			return i;
-		}
+	g_once (&registry_once, registry_init, NULL);
+
+	key = g_ascii_strdown (id, -1);
+	backend = g_hash_table_lookup (id_index, key);
+	g_free (key);
+
+	if (backend == NULL) {
+		g_message( "Unknown barcode id \"%s\"", id );
+		return &backends[0];
 	}
 
-	g_message( "Unknown barcode id \"%s\"", id );
-	return 0;
+	return backend;
 }
 
 
 /*---------------------------------------------------------------------------*/
-/* Convert name to index into above table.                                   */
+/* Convert name to entry of above table.                                     */
 /*---------------------------------------------------------------------------*/
-static gint
-name_to_index (const gchar *name)
+static const Backend *
+name_to_backend (const gchar *name)
 {
-	gint i;
+	const Backend *backend;
 
-	g_return_val_if_fail (name!=NULL, 0);
+	g_return_val_if_fail (name!=NULL, &backends[0]);
 
-	for (i=0; backends[i].id != NULL; i++) {
-		if (strcmp (name, gettext (backends[i].name)) == 0) {
-			return i;
-		}
+	g_once (&registry_once, registry_init, NULL);
+
+	backend = g_hash_table_lookup (name_index, name);
+
+	if (backend == NULL) {
+		g_message( "Unknown barcode name \"%s\"", name );
+		return &backends[0];
 	}
 
-	g_message( "Unknown barcode name \"%s\"", name );
-	return 0;
+	return backend;
 }
 
 
 /*****************************************************************************/
-/* Allocate new Line shape.                                                  */
+/* Look up barcode style by id.                                              */
+/*                                                                           */
+/* The returned style is static.  Callers that encode the same style often   */
+/* (e.g. a barcode object, for every record) resolve it once and then use    */
+/* gl_barcode_style_new() and gl_barcode_style_measure().  Unknown ids give  */
+/* the default style, as gl_barcode_new() does.                              */
 /*****************************************************************************/
-glBarcodeShapeLine *
-gl_barcode_shape_line_new (void)
+const glBarcodeStyle *
+gl_barcode_style_lookup (const gchar    *id)
 {
-        glBarcodeShapeLine *line_shape = g_new0 (glBarcodeShapeLine, 1);
-        line_shape->type = GL_BARCODE_SHAPE_LINE;
-
-        return line_shape;
+	return id_to_backend (id);
 }
 
 
 /*****************************************************************************/
-/* Allocate new Alpha shape.                                                 */
+/* Get canonical id of barcode style.                                        */
 /*****************************************************************************/
-glBarcodeShapeAlpha *
-gl_barcode_shape_alpha_new (void)
+const gchar *
+gl_barcode_style_get_id (const glBarcodeStyle *style)
 {
-        glBarcodeShapeAlpha *alpha_shape = g_new0 (glBarcodeShapeAlpha, 1);
-        alpha_shape->type = GL_BARCODE_SHAPE_ALPHA;
+	return style->id;
+}
+
 
-        return alpha_shape;
+/*****************************************************************************/
+/* Can barcodes of style be encoded on several threads at once?  Only our    */
+/* own backends are known to be reentrant; the libraries behind the others   */
+/* (GNU Barcode in particular) keep encoder state in static buffers.         */
+/*****************************************************************************/
+gboolean
+gl_barcode_style_is_thread_safe (const glBarcodeStyle *style)
+{
+	return style->thread_safe;
 }
 
 
 /*****************************************************************************/
 /* Call appropriate barcode backend to create barcode in intermediate format.*/
+/*                                                                           */
+/* Results are cached by all parameters, so repeated values (across records, */
+/* or when measuring and then drawing) are only encoded once.  The returned  */
+/* barcode may be shared and must not be modified; free it as usual with     */
+/* gl_barcode_free().                                                        */
 /*****************************************************************************/
 glBarcode *
 gl_barcode_new (const gchar    *id,
@@ -463,21 +566,144 @@ gl_barcode_new (const gchar    *id,
 		gdouble         w,
 		gdouble         h,
 		const gchar    *digits)
+{
+	return gl_barcode_style_new (id_to_backend (id),
+				     text_flag, checksum_flag, w, h, digits);
+}
+
+
+/*****************************************************************************/
+/* Create barcode of already resolved style, see gl_barcode_new().           */
+/*****************************************************************************/
+glBarcode *
+gl_barcode_style_new (const glBarcodeStyle *style,
+		      gboolean              text_flag,
+		      gboolean              checksum_flag,
+		      gdouble               w,
+		      gdouble               h,
+		      const gchar          *digits)
 {
 	glBarcode *gbc;
-	gint       i;
+	gchar     *key;
 
+	g_return_val_if_fail (style!=NULL, NULL);
 	g_return_val_if_fail (digits!=NULL, NULL);
 
-	i = id_to_index (id);
-	gbc = backends[i].new (backends[i].id,
-			       text_flag,
-			       checksum_flag,
-			       w,
-			       h,
-			       digits);
+	if ( !cache_enabled ) {
+		return style->new (style->id,
+				   text_flag,
+				   checksum_flag,
+				   w,
+				   h,
+				   digits);
+	}
 
-	return gbc;
+	key = g_strdup_printf ("%s:%d:%d:%.17g:%.17g:%s", style->id,
+			       text_flag ? 1 : 0, checksum_flag ? 1 : 0, w, h, digits);
+
+	if ( cache_lookup (key, &gbc) ) {
+		g_free (key);
+		return gbc;
+	}
+
+	gbc = style->new (style->id,
+			  text_flag,
+			  checksum_flag,
+			  w,
+			  h,
+			  digits);
+
+	return cache_insert (key, gbc);
+}
+
+
+/*****************************************************************************/
+/* Get size barcode would have, without necessarily creating it.  Returns    */
+/* FALSE if the data is invalid for the style.                               */
+/*****************************************************************************/
+gboolean
+gl_barcode_measure (const gchar    *id,
+		    gboolean        text_flag,
+		    gboolean        checksum_flag,
+		    gdouble         w,
+		    gdouble         h,
+		    const gchar    *digits,
+		    gdouble        *width,
+		    gdouble        *height)
+{
+	return gl_barcode_style_measure (id_to_backend (id),
+					 text_flag, checksum_flag, w, h, digits,
+					 width, height);
+}
+
+
+/*****************************************************************************/
+/* Get size of barcode of already resolved style, see gl_barcode_measure().  */
+/*****************************************************************************/
+gboolean
+gl_barcode_style_measure (const glBarcodeStyle *style,
+			  gboolean              text_flag,
+			  gboolean              checksum_flag,
+			  gdouble               w,
+			  gdouble               h,
+			  const gchar          *digits,
+			  gdouble              *width,
+			  gdouble              *height)
+{
+	glBarcode *gbc;
+
+	g_return_val_if_fail (style!=NULL, FALSE);
+	g_return_val_if_fail (digits!=NULL, FALSE);
+
+	if (style->measure != NULL) {
+		return style->measure (style->id,
+				       text_flag,
+				       checksum_flag,
+				       w,
+				       h,
+				       digits,
+				       width,
+				       height);
+	}
+
+	/* No shortcut: encode, through the cache, so drawing it costs nothing. */
+	gbc = gl_barcode_style_new (style, text_flag, checksum_flag, w, h, digits);
+	if (gbc == NULL) {
+		return FALSE;
+	}
+
+	*width  = gbc->width;
+	*height = gbc->height;
+
+	gl_barcode_free (&gbc);
+
+	return TRUE;
+}
+
+
+/*****************************************************************************/
+/* Get number of gl_barcode_new() calls answered from the cache, and not.    */
+/*****************************************************************************/
+void
+gl_barcode_cache_get_stats (guint *hits,
+                            guint *misses)
+{
+	G_LOCK (cache);
+	*hits   = cache_hits;
+	*misses = cache_misses;
+	G_UNLOCK (cache);
+}
+
+
+/*****************************************************************************/
+/* Enable or disable the encode cache.  Only meant for measuring the         */
+/* backends themselves, from a single thread.  While disabled, every         */
+/* gl_barcode_new() encodes and returns an unshared barcode.                 */
+/*****************************************************************************/
+void
+gl_barcode_cache_set_enabled (gboolean enabled)
+{
+	cache_enabled = enabled;
 }
 
 
@@ -487,16 +713,19 @@ gl_barcode_new (const gchar    *id,
 void
 gl_barcode_free (glBarcode **gbc)
 {
-	GList *p;
-
 	if (*gbc != NULL) {
 
-		for (p = (*gbc)->shapes; p != NULL; p = p->next) {
-			g_free (p->data);
-			p->data = NULL;
+		/* Shared: only free when the last reference goes. */
+		if ( ((*gbc)->ref_count > 0) &&
+		     !g_atomic_int_dec_and_test (&(*gbc)->ref_count) ) {
+			*gbc = NULL;
+			return;
 		}
-		g_list_free ((*gbc)->shapes);
-		(*gbc)->shapes = NULL;
+
+		/* Each block starts with its x array. */
+		g_free ((*gbc)->lines.x);
+		g_free ((*gbc)->chars.x);
+		g_free ((*gbc)->matrix);
 
 		g_free (*gbc);
 		*gbc = NULL;
@@ -505,16 +734,123 @@ gl_barcode_free (glBarcode **gbc)
 
 
 /*****************************************************************************/
-/* Add shape to barcode.                                                     */
+/* Make room for at least n_lines lines and n_chars chars in barcode.        */
+/*****************************************************************************/
+void
+gl_barcode_reserve (glBarcode *bc,
+                    guint      n_lines,
+                    guint      n_chars)
+{
+	g_return_if_fail (bc);
+
+	if (n_lines > bc->lines_size) {
+		grow_lines (bc, n_lines);
+	}
+	if (n_chars > bc->chars_size) {
+		grow_chars (bc, n_chars);
+	}
+}
+
+
+/*****************************************************************************/
+/* Add line (bar or module) to barcode.                                      */
 /*****************************************************************************/
 void
-gl_barcode_add_shape (glBarcode      *bc,
-                      glBarcodeShape *shape)
+gl_barcode_add_line (glBarcode *bc,
+                     gdouble    x,
+                     gdouble    y,
+                     gdouble    length,
+                     gdouble    width)
 {
+	guint i;
+
 	g_return_if_fail (bc);
-	g_return_if_fail (shape);
 
-        bc->shapes = g_list_prepend (bc->shapes, shape);
+	if (bc->lines.n == bc->lines_size) {
+		grow_lines (bc, MAX (MIN_BLOCK_SIZE, 2*bc->lines_size));
+	}
+
+	i = bc->lines.n++;
+	bc->lines.x[i]      = x;
+	bc->lines.y[i]      = y;
+	bc->lines.length[i] = length;
+	bc->lines.width[i]  = width;
+}
+
+
+/*****************************************************************************/
+/* Add human readable character to barcode.                                  */
+/*****************************************************************************/
+void
+gl_barcode_add_char (glBarcode *bc,
+                     gdouble    x,
+                     gdouble    y,
+                     gdouble    fsize,
+                     gchar      c)
+{
+	guint i;
+
+	g_return_if_fail (bc);
+
+	if (bc->chars.n == bc->chars_size) {
+		grow_chars (bc, MAX (MIN_BLOCK_SIZE, 2*bc->chars_size));
+	}
+
+	i = bc->chars.n++;
+	bc->chars.x[i]     = x;
+	bc->chars.y[i]     = y;
+	bc->chars.fsize[i] = fsize;
+	bc->chars.c[i]     = c;
+}
+
+
+/*****************************************************************************/
+/* Give barcode an empty (all light) module matrix.                          */
+/*****************************************************************************/
+void
+gl_barcode_set_matrix (glBarcode *bc,
+                       gint       n_cols,
+                       gint       n_rows,
+                       gdouble    module_size)
+{
+	glBarcodeMatrix *matrix;
+	gint             stride;
+
+	g_return_if_fail (bc);
+	g_return_if_fail (bc->matrix == NULL);
+	g_return_if_fail ((n_cols > 0) && (n_rows > 0));
+
+	/* Header and modules in one block. */
+	stride = (n_cols + 7) / 8;
+	matrix = g_malloc0 (sizeof (glBarcodeMatrix) + stride*n_rows);
+
+	matrix->n_cols      = n_cols;
+	matrix->n_rows      = n_rows;
+	matrix->stride      = stride;
+	matrix->module_size = module_size;
+	matrix->data        = (guchar *)(matrix + 1);
+
+	bc->matrix = matrix;
+}
+
+
+/*****************************************************************************/
+/* Make module of barcode's matrix dark.                                     */
+/*****************************************************************************/
+void
+gl_barcode_set_module (glBarcode *bc,
+                       gint       col,
+                       gint       row)
+{
+	glBarcodeMatrix *matrix;
+
+	g_return_if_fail (bc && bc->matrix);
+
+	matrix = bc->matrix;
+	g_return_if_fail ((col >= 0) && (col < matrix->n_cols));
+	g_return_if_fail ((row >= 0) && (row < matrix->n_rows));
+
+	matrix->data[row*matrix->stride + col/8] |= 0x80 >> (col%8);
 }
 
 
@@ -559,17 +895,17 @@ gchar *
 gl_barcode_default_digits (const gchar *id,
 			   guint        n)
 {
-	int i;
+	const Backend *backend;
 
-	i = id_to_index (id);
+	backend = id_to_backend (id);
 
-	if (backends[i].can_freeform) {
+	if (backend->can_freeform) {
 
 		return g_strnfill (MAX (n,1), '0');
 
 	} else {
 
-		return g_strdup (backends[i].default_digits);
+		return g_strdup (backend->default_digits);
 
 	}
 }
@@ -581,14 +917,14 @@ gl_barcode_default_digits (const gchar *id,
 gboolean
 gl_barcode_can_text (const gchar *id)
 {
-	return backends[id_to_index (id)].can_text;
+	return id_to_backend (id)->can_text;
 }
 
 
 gboolean
 gl_barcode_text_optional (const gchar *id)
 {
-	return backends[id_to_index (id)].text_optional;
+	return id_to_backend (id)->text_optional;
 }
 
 
@@ -598,14 +934,14 @@ gl_barcode_text_optional (const gchar *id)
 gboolean
 gl_barcode_can_csum (const gchar *id)
 {
-	return backends[id_to_index (id)].can_checksum;
+	return id_to_backend (id)->can_checksum;
 }
 
 
 gboolean
 gl_barcode_csum_optional (const gchar *id)
 {
-	return backends[id_to_index (id)].checksum_optional;
+	return id_to_backend (id)->checksum_optional;
 }
 
 
@@ -615,7 +951,7 @@ gl_barcode_csum_optional (const gchar *id)
 gboolean
 gl_barcode_can_freeform     (const gchar    *id)
 {
-	return backends[id_to_index (id)].can_freeform;
+	return id_to_backend (id)->can_freeform;
 }
 
 
@@ -625,7 +961,7 @@ gl_barcode_can_freeform     (const gchar    *id)
 guint
 gl_barcode_get_prefered_n (const gchar    *id)
 {
-	return backends[id_to_index (id)].prefered_n;
+	return id_to_backend (id)->prefered_n;
 }
 
 
@@ -635,7 +971,7 @@ gl_barcode_get_prefered_n (const gchar    *id)
 const gchar *
 gl_barcode_id_to_name (const gchar *id)
 {
-	return gettext (backends[id_to_index (id)].name);
+	return gettext (id_to_backend (id)->name);
 }
 
 
@@ -647,10 +983,215 @@ gl_barcode_name_to_id (const gchar *name)
 {
 	g_return_val_if_fail (name!=NULL, backends[0].id);
 
-	return backends[name_to_index (name)].id;
+	return name_to_backend (name)->id;
+}
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Build registry of backends table.  Where an id or name appears  */
+/* more than once (several libraries), the first entry wins, as it always    */
+/* has.                                                                      */
+/*---------------------------------------------------------------------------*/
+static gpointer
+registry_init (gpointer data)
+{
+	gint         i;
+	gchar       *key;
+	const gchar *name;
+
+	id_index   = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	name_index = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (i=0; backends[i].id != NULL; i++) {
+
+		key = g_ascii_strdown (backends[i].id, -1);
+		if (g_hash_table_lookup (id_index, key) == NULL) {
+			g_hash_table_insert (id_index, key, (gpointer)&backends[i]);
+		} else {
+			g_free (key);
+		}
+
+		name = gettext (backends[i].name);
+		if (g_hash_table_lookup (name_index, name) == NULL) {
+			g_hash_table_insert (name_index, (gpointer)name, (gpointer)&backends[i]);
+		}
+	}
+
+	return NULL;
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Look up key in encode cache.  Returns FALSE on a miss, else     */
+/* sets gbc to a new reference to the cached barcode (or NULL if the data    */
+/* was invalid).                                                             */
+/*---------------------------------------------------------------------------*/
+static gboolean
+cache_lookup (const gchar  *key,
+              glBarcode   **gbc)
+{
+	GList      *link = NULL;
+	CacheEntry *entry;
+
+	G_LOCK (cache);
+
+	if ( cache_index != NULL ) {
+		link = g_hash_table_lookup (cache_index, key);
+	}
+
+	if ( link == NULL ) {
+		cache_misses++;
+		G_UNLOCK (cache);
+		return FALSE;
+	}
+
+	/* Move to front of LRU queue. */
+	g_queue_unlink (cache_lru, link);
+	g_queue_push_head_link (cache_lru, link);
+
+	entry = (CacheEntry *)link->data;
+	if ( entry->gbc != NULL ) {
+		g_atomic_int_inc (&entry->gbc->ref_count);
+	}
+	*gbc = entry->gbc;
+
+	cache_hits++;
+
+	G_UNLOCK (cache);
+
+	return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add newly encoded barcode to cache, taking ownership of key.    */
+/* Returns barcode to give to caller: a new reference to gbc, or to an equal */
+/* barcode inserted meanwhile by another thread.                             */
+/*---------------------------------------------------------------------------*/
+static glBarcode *
+cache_insert (gchar     *key,
+              glBarcode *gbc)
+{
+	GList      *link;
+	CacheEntry *entry;
+	glBarcode  *shared;
+
+	G_LOCK (cache);
+
+	if ( cache_index == NULL ) {
+		cache_index = g_hash_table_new (g_str_hash, g_str_equal);
+		cache_lru   = g_queue_new ();
+	}
+
+	link = g_hash_table_lookup (cache_index, key);
+	if ( link != NULL ) {
+		/* Encoded by another thread since our lookup, use theirs. */
+		entry = (CacheEntry *)link->data;
+		if ( entry->gbc != NULL ) {
+			g_atomic_int_inc (&entry->gbc->ref_count);
+		}
+		shared = entry->gbc;
+		G_UNLOCK (cache);
+
+		g_free (key);
+		gl_barcode_free (&gbc);
+		return shared;
+	}
+
+	if ( g_queue_get_length (cache_lru) >= CACHE_SIZE ) {
+		entry = (CacheEntry *)g_queue_pop_tail (cache_lru);
+		g_hash_table_remove (cache_index, entry->key);
+		cache_entry_free (entry);
+	}
+
+	if ( gbc != NULL ) {
+		/* One reference for the cache, one for the caller. */
+		gbc->ref_count = 2;
+	}
+
+	entry = g_new0 (CacheEntry, 1);
+	entry->key = key;
+	entry->gbc = gbc;
+
+	g_queue_push_head (cache_lru, entry);
+	g_hash_table_insert (cache_index, entry->key, cache_lru->head);
+
+	G_UNLOCK (cache);
+
+	return gbc;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free cache entry, dropping the cache's reference to barcode.    */
+/*---------------------------------------------------------------------------*/
+static void
+cache_entry_free (CacheEntry *entry)
+{
+	gl_barcode_free (&entry->gbc);
+	g_free (entry->key);
+	g_free (entry);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Reallocate lines block to hold size lines.                      */
+/*---------------------------------------------------------------------------*/
+static void
+grow_lines (glBarcode *bc,
+            guint      size)
+{
+	gdouble *block;
+	guint    n = bc->lines.n;
+
+	/* One block: x[size], y[size], length[size], width[size]. */
+	block = g_new (gdouble, 4*size);
+
+	if (n > 0) {
+		memcpy (&block[0],      bc->lines.x,      n*sizeof(gdouble));
+		memcpy (&block[size],   bc->lines.y,      n*sizeof(gdouble));
+		memcpy (&block[2*size], bc->lines.length, n*sizeof(gdouble));
+		memcpy (&block[3*size], bc->lines.width,  n*sizeof(gdouble));
+	}
+	g_free (bc->lines.x);
+
+	bc->lines.x      = &block[0];
+	bc->lines.y      = &block[size];
+	bc->lines.length = &block[2*size];
+	bc->lines.width  = &block[3*size];
+	bc->lines_size   = size;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Reallocate chars block to hold size chars.                      */
+/*---------------------------------------------------------------------------*/
+static void
+grow_chars (glBarcode *bc,
+            guint      size)
+{
+	gdouble *block;
+	guint    n = bc->chars.n;
+
+	/* One block: x[size], y[size], fsize[size], then c[size]. */
+	block = g_malloc (size * (3*sizeof(gdouble) + sizeof(gchar)));
+
+	if (n > 0) {
+		memcpy (&block[0],      bc->chars.x,     n*sizeof(gdouble));
+		memcpy (&block[size],   bc->chars.y,     n*sizeof(gdouble));
+		memcpy (&block[2*size], bc->chars.fsize, n*sizeof(gdouble));
+		memcpy (&block[3*size], bc->chars.c,     n*sizeof(gchar));
+	}
+	g_free (bc->chars.x);
+
+	bc->chars.x     = &block[0];
+	bc->chars.y     = &block[size];
+	bc->chars.fsize = &block[2*size];
+	bc->chars.c     = (gchar *)&block[3*size];
+	bc->chars_size  = size;
+}
+
+
+
 
 /*
  * Local Variables:       -- emacs
@@ -26,91 +26,91 @@
 
 G_BEGIN_DECLS
 
-typedef enum {
-        GL_BARCODE_SHAPE_LINE,
-        GL_BARCODE_SHAPE_ALPHA,
-} glBarcodeShapeType;
-
-typedef struct {
-
-        /* Begin Common Fields */
-        glBarcodeShapeType  type;
-        gdouble             x;
-        gdouble             y;
-        /* End Common Fields */
-
-} glBarcodeShapeAny;
-
 /*
- * glBarcodeShapeLine:
+ * glBarcodeLines:  the bars (or matrix modules) of a barcode, stored as
+ * parallel arrays.  Bar i is:
  *
- * @ =  origin (x,y) from top left corner of barcode
+ * @ =  origin (x[i],y[i]) from top left corner of barcode
  *
  *              +--@--+
  *              |     |
  *              |     |
  *              |     |
- *              |     | length
+ *              |     | length[i]
  *              |     |
  *              |     |
  *              |     |
  *              +-----+
- *               width
+ *              width[i]
  */
 typedef struct {
-
-        /* Begin Common Fields */
-        glBarcodeShapeType  type; /* Always GL_BARCODE_SHAPE_LINE. */
-        gdouble             x;
-        gdouble             y;
-        /* End Common Fields */
-
-        gdouble             length;
-        gdouble             width;
-
-} glBarcodeShapeLine;
+        guint               n;
+        gdouble            *x;
+        gdouble            *y;
+        gdouble            *length;
+        gdouble            *width;
+} glBarcodeLines;
 
 /*
- * glBarcodeShapeAlpha:
+ * glBarcodeChars:  the human readable characters of a barcode, stored as
+ * parallel arrays.  Character i is:
  *
- * @ =  origin (x,y) from top left corner of barcode
+ * @ =  origin (x[i],y[i]) from top left corner of barcode
  *
  *              ____ ------------
  *             /    \           ^
  *            /  /\  \          |
  *           /  /__\  \         |
- *          /  ______  \        | ~fsize
+ *          /  ______  \        | ~fsize[i]
  *         /  /      \  \       |
  *        /__/        \__\      |
  *                              v
  *       @ ----------------------
  */
 typedef struct {
+        guint               n;
+        gdouble            *x;
+        gdouble            *y;
+        gdouble            *fsize;
+        gchar              *c;
+} glBarcodeChars;
 
-        /* Begin Common Fields */
-        glBarcodeShapeType  type; /* Always GL_BARCODE_SHAPE_ALPHA. */
-        gdouble             x;
-        gdouble             y;
-        /* End Common Fields */
+/*
+ * glBarcodeMatrix:  the modules of a 2D matrix symbol, packed one bit per
+ * module (most significant bit first, 1 = dark), row by row from the top.
+ * Module (col,row) covers the square at (col*module_size, row*module_size).
+ */
+typedef struct {
+        gint                n_cols;
+        gint                n_rows;
+        gint                stride;       /* Bytes per row. */
+        gdouble             module_size;
+        guchar             *data;
+} glBarcodeMatrix;
 
-        gdouble             fsize;
-        gchar               c;
+#define GL_BARCODE_MATRIX_GET(m, col, row) \
+        (((m)->data[(row)*(m)->stride + (col)/8] >> (7 - (col)%8)) & 1)
 
-} glBarcodeShapeAlpha;
+/*
+ * A zeroed glBarcode (g_new0) is a valid empty barcode.  Lines and chars each
+ * live in a single block owned by the barcode, so a barcode costs a handful
+ * of allocations however many modules it has.
+ */
+typedef struct {
+	gdouble width, height;
 
-typedef union {
+	glBarcodeLines lines;
+	glBarcodeChars chars;
 
-        glBarcodeShapeType    type;
-        glBarcodeShapeAny     any;
+	glBarcodeMatrix *matrix;	/* Matrix symbols only, else NULL. */
 
-        glBarcodeShapeLine    line;
-        glBarcodeShapeAlpha   alpha;
+	gdouble bar_shrink;	/* Narrowing of each bar for ink spread. */
 
-} glBarcodeShape;
+	/*< private >*/
+	guint lines_size;	/* Allocated length of lines arrays. */
+	guint chars_size;	/* Allocated length of chars arrays. */
 
-typedef struct {
-	gdouble width, height;
-	GList *shapes;		/* List of glBarcodeShape */
+	gint ref_count;		/* Set by gl_barcode_new(), 0 for unshared. */
 } glBarcode;
 
 typedef glBarcode *(*glBarcodeNewFunc) (const gchar    *id,
@@ -120,14 +120,26 @@ typedef glBarcode *(*glBarcodeNewFunc) (const gchar    *id,
 					gdouble         h,
 					const gchar    *digits);
 
+typedef gboolean (*glBarcodeMeasureFunc) (const gchar    *id,
+					  gboolean        text_flag,
+					  gboolean        checksum_flag,
+					  gdouble         w,
+					  gdouble         h,
+					  const gchar    *digits,
+					  gdouble        *width,
+					  gdouble        *height);
+
+
+/*
+ * glBarcodeStyle:  a barcode style (symbology), as resolved from its id.
+ */
+typedef struct _glBarcodeStyle glBarcodeStyle;
+
 
 #define GL_BARCODE_FONT_FAMILY      "Sans"
 #define GL_BARCODE_FONT_WEIGHT      PANGO_WEIGHT_NORMAL
 
 
-glBarcodeShapeLine  *gl_barcode_shape_line_new  (void);
-glBarcodeShapeAlpha *gl_barcode_shape_alpha_new (void);
-
 glBarcode       *gl_barcode_new              (const gchar    *id,
 					      gboolean        text_flag,
 					      gboolean        checksum_flag,
@@ -137,8 +149,66 @@ glBarcode       *gl_barcode_new              (const gchar    *id,
 
 void             gl_barcode_free             (glBarcode     **bc);
 
-void             gl_barcode_add_shape        (glBarcode      *bc,
-                                              glBarcodeShape *shape);
+gboolean         gl_barcode_measure          (const gchar    *id,
+					      gboolean        text_flag,
+					      gboolean        checksum_flag,
+					      gdouble         w,
+					      gdouble         h,
+					      const gchar    *digits,
+					      gdouble        *width,
+					      gdouble        *height);
+
+const glBarcodeStyle *gl_barcode_style_lookup (const gchar    *id);
+
+const gchar     *gl_barcode_style_get_id     (const glBarcodeStyle *style);
+
+gboolean         gl_barcode_style_is_thread_safe (const glBarcodeStyle *style);
+
+glBarcode       *gl_barcode_style_new        (const glBarcodeStyle *style,
+					      gboolean        text_flag,
+					      gboolean        checksum_flag,
+					      gdouble         w,
+					      gdouble         h,
+					      const gchar    *digits);
+
+gboolean         gl_barcode_style_measure    (const glBarcodeStyle *style,
+					      gboolean        text_flag,
+					      gboolean        checksum_flag,
+					      gdouble         w,
+					      gdouble         h,
+					      const gchar    *digits,
+					      gdouble        *width,
+					      gdouble        *height);
+
+void             gl_barcode_cache_get_stats  (guint          *hits,
+                                              guint          *misses);
+
+void             gl_barcode_cache_set_enabled (gboolean       enabled);
+
+void             gl_barcode_reserve          (glBarcode      *bc,
+                                              guint           n_lines,
+                                              guint           n_chars);
+
+void             gl_barcode_add_line         (glBarcode      *bc,
+                                              gdouble         x,
+                                              gdouble         y,
+                                              gdouble         length,
+                                              gdouble         width);
+
+void             gl_barcode_add_char         (glBarcode      *bc,
+                                              gdouble         x,
+                                              gdouble         y,
+                                              gdouble         fsize,
+                                              gchar           c);
+
+void             gl_barcode_set_matrix       (glBarcode      *bc,
+                                              gint            n_cols,
+                                              gint            n_rows,
+                                              gdouble         module_size);
+
+void             gl_barcode_set_module       (glBarcode      *bc,
+                                              gint            col,
+                                              gint            row);
 
 GList           *gl_barcode_get_styles_list  (void);
 void             gl_barcode_free_styles_list (GList          *styles_list);
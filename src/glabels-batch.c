@@ -21,17 +21,24 @@
 #include <config.h>
 
 #include <glib/gi18n.h>
-
-#include <math.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <libglabels.h>
 #include "merge-init.h"
 #include "template-history.h"
 #include "font-history.h"
-#include "xml-label.h"
-#include "print.h"
-#include "print-op.h"
-#include "file-util.h"
+#include "batch-job.h"
+#include "batch-server.h"
+#include "batch-manifest.h"
+#include "batch-plan.h"
+#include "batch-raster.h"
+#include "batch-bitmap.h"
+#include "batch-stream.h"
+#include "stats.h"
+#include "barcode-prefetch.h"
 #include "prefs.h"
 #include "debug.h"
 
@@ -46,6 +53,23 @@ static gboolean outline_flag     = FALSE;
 static gboolean reverse_flag     = FALSE;
 static gboolean crop_marks_flag  = FALSE;
 static gchar    *input           = NULL;
+static gint     checkpoint       = 0;
+static gboolean resume_flag      = FALSE;
+static gboolean incremental_flag = FALSE;
+static gchar    *pages           = NULL;
+static gchar    *records         = NULL;
+static gchar    *serve           = NULL;
+static gchar    *manifest        = NULL;
+static gchar    *plan            = NULL;
+static gchar    *raster          = NULL;
+static gdouble  dpi              = 300.0;
+static gboolean per_label_flag   = FALSE;
+static gboolean zpl_flag         = FALSE;
+static gchar    *bitmap          = NULL;
+static gboolean rle_flag         = FALSE;
+static gint     n_workers        = 0;
+static gboolean stats_flag       = FALSE;
+static gchar    *stats_json      = NULL;
 static gchar    **remaining_args = NULL;
 
 static GOptionEntry option_entries[] = {
@@ -65,13 +89,53 @@ static GOptionEntry option_entries[] = {
          N_("print crop marks"), NULL},
         {"input", 'i', 0, G_OPTION_ARG_STRING, &input,
          N_("input file for merging"), N_("filename")},
+        {"checkpoint", 'k', 0, G_OPTION_ARG_INT, &checkpoint,
+         N_("write output in shards of N sheets, saving progress after each shard"), N_("sheets")},
+        {"resume", 'R', 0, G_OPTION_ARG_NONE, &resume_flag,
+         N_("resume an interrupted checkpointed job"), NULL},
+        {"pages", 0, 0, G_OPTION_ARG_STRING, &pages,
+         N_("print only sheets N to M of the job"), N_("N-M")},
+        {"records", 0, 0, G_OPTION_ARG_STRING, &records,
+         N_("print only records N to M of the merge data"), N_("N-M")},
+        {"incremental", 'I', 0, G_OPTION_ARG_NONE, &incremental_flag,
+         N_("skip outputs whose label, fonts, images, merge data and options are unchanged"), NULL},
+        {"serve", 'S', 0, G_OPTION_ARG_FILENAME, &serve,
+         N_("serve print jobs on a Unix domain socket"), N_("socket")},
+        {"manifest", 'm', 0, G_OPTION_ARG_FILENAME, &manifest,
+         N_("print all jobs listed in a JSON manifest file"), N_("filename")},
+        {"plan", 'P', 0, G_OPTION_ARG_STRING, &plan,
+         N_("report sheets, label placement and invalid data, without printing (json or csv)"), N_("format")},
+        {"raster", 0, 0, G_OPTION_ARG_STRING, &raster,
+         N_("write numbered image files instead of PDF (png or tiff)"), N_("format")},
+        {"dpi", 0, 0, G_OPTION_ARG_DOUBLE, &dpi,
+         N_("resolution of image files or ZPL printer (default=300)"), N_("dpi")},
+        {"per-label", 0, 0, G_OPTION_ARG_NONE, &per_label_flag,
+         N_("write one image file per label, rather than per sheet"), NULL},
+        {"zpl", 0, 0, G_OPTION_ARG_NONE, &zpl_flag,
+         N_("write ZPL for Zebra label printers instead of PDF"), NULL},
+        {"bitmap", 0, 0, G_OPTION_ARG_STRING, &bitmap,
+         N_("write a 1-bit raster stream for roll label printers instead of PDF (threshold or ordered)"), N_("dither")},
+        {"rle", 0, 0, G_OPTION_ARG_NONE, &rle_flag,
+         N_("run-length encode lines of bitmap output"), NULL},
+        {"stats", 0, 0, G_OPTION_ARG_NONE, &stats_flag,
+         N_("print time spent in each phase and on each type of object"), NULL},
+        {"stats-json", 0, 0, G_OPTION_ARG_FILENAME, &stats_json,
+         N_("write --stats report as JSON (\"-\" for standard output)"), N_("filename")},
+        {"workers", 'w', 0, G_OPTION_ARG_INT, &n_workers,
+         N_("maximum number of concurrent jobs when serving or printing a manifest (default=number of CPUs)"), N_("workers")},
         { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY,
           &remaining_args, NULL, N_("[FILE...]") },
         { NULL }
 };
 
 
-
+/*============================================*/
+/* Private function prototypes                */
+/*============================================*/
+static void print_stats (void);
+
+
+
 /*****************************************************************************/
 /* Main                                                                      */
 /*****************************************************************************/
@@ -80,13 +144,16 @@ main (int argc, char **argv)
 {
 	GOptionContext    *option_context;
         GList             *p, *file_list = NULL;
-        gchar             *abs_fn;
-        glLabel           *label = NULL;
-        glMerge           *merge = NULL;
-        const lglTemplate *template;
-        lglTemplateFrame  *frame;
-        glXMLLabelStatus   status;
-        glPrintOp         *print_op;
+        glBatchJob        *job;
+        glBatchJobResult   result;
+        gint               n_rebuilt = 0, n_up_to_date = 0, n_failed = 0;
+        gint               first_page = 0, last_page = 0;
+        gint               first_record = 0, last_record = 0;
+        gint               n_modes;
+        glBatchPlanFormat  plan_format = BATCH_PLAN_FORMAT_JSON;
+        glBatchRasterFormat raster_format = BATCH_RASTER_FORMAT_PNG;
+        glBatchBitmapDither bitmap_dither = BATCH_BITMAP_DITHER_THRESHOLD;
+        glLabel           *label;
 	gchar	          *utf8_filename;
         GError            *error = NULL;
 
@@ -100,6 +167,13 @@ main (int argc, char **argv)
 	g_option_context_add_main_entries (option_context, option_entries, GETTEXT_PACKAGE);
 
 
+        /* Raster output encodes images on a separate thread, and merge
+           jobs encode barcodes ahead of drawing on a thread pool. */
+        if (!g_thread_supported ()) {
+                g_thread_init (NULL);
+        }
+        gl_barcode_prefetch_enable ();
+
         /* Initialize minimal gnome program */
         // gtk_init (&argc, &argv);
         gtk_type_init(0);
@@ -112,6 +186,65 @@ main (int argc, char **argv)
 	}
 
 
+        if (pages != NULL && !gl_batch_job_parse_range (pages, &first_page, &last_page)) {
+                g_print(_("Invalid page range \"%s\", expected e.g. \"120-140\".\n"), pages);
+                return 1;
+        }
+        if (records != NULL && !gl_batch_job_parse_range (records, &first_record, &last_record)) {
+                g_print(_("Invalid record range \"%s\", expected e.g. \"5000-5999\".\n"), records);
+                return 1;
+        }
+
+        n_modes = (plan != NULL) + (raster != NULL) + (zpl_flag ? 1 : 0) + (bitmap != NULL);
+        if (n_modes > 1) {
+                g_print(_("Only one of --plan, --raster, --zpl and --bitmap can be used.\n"));
+                return 1;
+        }
+        if (n_modes > 0 && (manifest != NULL || serve != NULL)) {
+                g_print(_("--plan, --raster, --zpl and --bitmap cannot be used with --manifest or --serve.\n"));
+                return 1;
+        }
+        if (manifest != NULL && serve != NULL) {
+                g_print(_("--manifest cannot be used with --serve.\n"));
+                return 1;
+        }
+
+        if (pages != NULL && input != NULL && strcmp (input, "-") == 0) {
+                g_print(_("--pages cannot be used with merge data from standard input.\n"));
+                return 1;
+        }
+        if ((checkpoint > 0 || resume_flag || incremental_flag) &&
+            input != NULL && strcmp (input, "-") == 0) {
+                g_print(_("--checkpoint, --resume and --incremental cannot be used with merge data from standard input.\n"));
+                return 1;
+        }
+        if (pages != NULL && (plan != NULL || raster != NULL || zpl_flag || bitmap != NULL)) {
+                g_print(_("--pages can only be used when printing PDF, not with --plan, --raster, --zpl or --bitmap.\n"));
+                return 1;
+        }
+
+        if (plan != NULL && !gl_batch_plan_parse_format (plan, &plan_format)) {
+                g_print(_("Unknown plan format \"%s\", expected \"json\" or \"csv\".\n"), plan);
+                return 1;
+        }
+
+        if (raster != NULL && !gl_batch_raster_parse_format (raster, &raster_format)) {
+                g_print(_("Unknown raster format \"%s\", expected \"png\" or \"tiff\".\n"), raster);
+                return 1;
+        }
+        if (bitmap != NULL && !gl_batch_bitmap_parse_dither (bitmap, &bitmap_dither)) {
+                g_print(_("Unknown dither \"%s\", expected \"threshold\" or \"ordered\".\n"), bitmap);
+                return 1;
+        }
+        if (dpi <= 0.0) {
+                g_print(_("Resolution must be positive.\n"));
+                return 1;
+        }
+        if (serve != NULL && (stats_flag || stats_json != NULL)) {
+                g_print(_("--stats cannot be used with --serve.\n"));
+                return 1;
+        }
+
         /* create file list */
 	if (remaining_args != NULL) {
 		gint i, num_args;
@@ -126,6 +259,15 @@ main (int argc, char **argv)
 		remaining_args = NULL;
 	}
 
+        if (g_list_length (file_list) > 1 && input != NULL && strcmp (input, "-") == 0) {
+                g_print(_("Only one label file can be printed with merge data from standard input.\n"));
+                return 1;
+        }
+
+        if (stats_flag || stats_json != NULL) {
+                gl_stats_enable ();
+        }
+
         /* initialize components */
         gl_debug_init ();
         gl_merge_init ();
@@ -134,64 +276,167 @@ main (int argc, char **argv)
 	gl_template_history_init ();
 	gl_font_history_init ();
 
+        if (n_workers < 1) {
+                n_workers = MAX (1, sysconf (_SC_NPROCESSORS_ONLN));
+        }
+
+        /* serve jobs, rather than print files */
+        if (serve != NULL) {
+                return gl_batch_server_run (serve, n_workers) ? 0 : 1;
+        }
+
+        /* print jobs from manifest, rather than files */
+        if (manifest != NULL) {
+                gboolean ok = gl_batch_manifest_run (manifest, n_workers, incremental_flag);
+                print_stats ();
+                return ok ? 0 : 1;
+        }
+
         /* now print the files */
         for (p = file_list; p; p = p->next) {
                 // g_print ("LABEL FILE = %s\n", (gchar *) p->data);
-                label = gl_xml_label_open (p->data, &status);
+                job = gl_batch_job_new ();
 
+                g_free (job->output);
+
+                job->label_filename  = g_strdup (p->data);
+                job->input           = g_strdup (input);
+                job->output          = g_strdup (output);
+                job->n_copies        = n_copies;
+                job->n_sheets        = n_sheets;
+                job->first           = first;
+                job->outline_flag    = outline_flag;
+                job->reverse_flag    = reverse_flag;
+                job->crop_marks_flag = crop_marks_flag;
+                job->checkpoint      = checkpoint;
+                job->resume_flag     = resume_flag;
+                job->incremental_flag = incremental_flag;
+                job->first_page      = first_page;
+                job->last_page       = last_page;
+                job->first_record    = first_record;
+                job->last_record     = last_record;
+
+                /* plan job, rather than print it */
+                if (plan != NULL) {
+                        label = gl_batch_job_open_label (job, &result);
+                        if (label == NULL ||
+                            !gl_batch_plan_run (job, label, plan_format, n_workers, stdout)) {
+                                n_failed++;
+                        }
+                        if (label != NULL) {
+                                g_object_unref (label);
+                        }
+                        gl_batch_job_free (job);
+                        continue;
+                }
 
-                if ( status == XML_LABEL_OK ) {
+                /* render job to image files, rather than print it */
+                if (raster != NULL) {
+                        label = gl_batch_job_open_label (job, &result);
+                        if (label == NULL ||
+                            !gl_batch_raster_run (job, label, raster_format, dpi,
+                                                  per_label_flag, n_workers, &result)) {
+                                n_failed++;
+                        }
+                        if (label != NULL) {
+                                g_object_unref (label);
+                        }
+                        gl_batch_job_free (job);
+                        continue;
+                }
 
-                        merge = gl_label_get_merge (label);
-                        if (input != NULL) {
-                                if (merge != NULL) {
-                                        gl_merge_set_src(merge, input);
-                                        gl_label_set_merge(label, merge, FALSE);
-                                } else {
-                                        fprintf ( stderr,
-                                                  _("cannot perform document merge with glabels file %s\n"),
-                                                  (char *)p->data );
-                                }
+                /* print job as ZPL, rather than PDF */
+                if (zpl_flag) {
+                        label = gl_batch_job_open_label (job, &result);
+                        if (label == NULL ||
+                            !gl_batch_job_print_zpl (job, label, dpi, &result)) {
+                                n_failed++;
                         }
-                        abs_fn = gl_file_util_make_absolute ( output );
-                        template = gl_label_get_template (label);
-                        frame = (lglTemplateFrame *)template->frames->data;
-
-                        print_op = gl_print_op_new (label);
-                        gl_print_op_set_filename        (print_op, abs_fn);
-                        gl_print_op_set_n_copies        (print_op, n_copies);
-                        gl_print_op_set_first           (print_op, first);
-                        gl_print_op_set_outline_flag    (print_op, outline_flag);
-                        gl_print_op_set_reverse_flag    (print_op, reverse_flag);
-                        gl_print_op_set_crop_marks_flag (print_op, crop_marks_flag);
-                        if (merge)
-                        {
-                                gl_print_op_set_n_sheets (print_op,
-                                                          ceil ((double)(first-1 + n_copies * gl_merge_get_record_count(merge))
-                                                                / lgl_template_frame_get_n_labels (frame)));
+                        if (label != NULL) {
+                                g_object_unref (label);
                         }
-                        else
-                        {
-                                gl_print_op_set_n_sheets (print_op, n_sheets);
-                                gl_print_op_set_last     (print_op,
-                                                          lgl_template_frame_get_n_labels (frame));
+                        gl_batch_job_free (job);
+                        continue;
+                }
+
+                /* print job as bitmap raster stream, rather than PDF */
+                if (bitmap != NULL) {
+                        label = gl_batch_job_open_label (job, &result);
+                        if (label == NULL ||
+                            !gl_batch_bitmap_run (job, label, bitmap_dither, dpi,
+                                                  rle_flag, &result)) {
+                                n_failed++;
                         }
-                        gtk_print_operation_run (GTK_PRINT_OPERATION (print_op),
-                                                 GTK_PRINT_OPERATION_ACTION_EXPORT,
-                                                 NULL,
-                                                 NULL);
+                        if (label != NULL) {
+                                g_object_unref (label);
+                        }
+                        gl_batch_job_free (job);
+                        continue;
+                }
 
-                        g_object_unref (label);
+                /* stream merge data from standard input, one sheet at a time */
+                if (input != NULL && strcmp (input, "-") == 0) {
+                        label = gl_batch_job_open_label (job, &result);
+                        if (label == NULL ||
+                            !gl_batch_stream_run (job, label, &result)) {
+                                n_failed++;
+                        }
+                        if (label != NULL) {
+                                g_object_unref (label);
+                        }
+                        gl_batch_job_free (job);
+                        continue;
                 }
-                else {
-                        fprintf ( stderr, _("cannot open glabels file %s\n"),
-                                  (char *)p->data );
+
+                if (!gl_batch_job_run (job, &result)) {
+                        n_failed++;
+                } else if (result.up_to_date) {
+                        n_up_to_date++;
+                } else {
+                        n_rebuilt++;
+                        if (incremental_flag) {
+                                fprintf (stderr, _("rebuilt %s\n"), job->output);
+                        }
                 }
+
+                gl_batch_job_free (job);
         }
 
         g_list_free (file_list);
 
-        return 0;
+        print_stats ();
+
+        if (incremental_flag && plan == NULL) {
+                fprintf (stderr, _("%d rebuilt, %d up to date, %d failed\n"),
+                         n_rebuilt, n_up_to_date, n_failed);
+        }
+
+        return n_failed ? 1 : 0;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Print --stats and --stats-json reports, if asked for.           */
+/*---------------------------------------------------------------------------*/
+static void
+print_stats (void)
+{
+        if (stats_flag) {
+                gl_stats_print (stderr);
+        }
+        if (stats_json != NULL) {
+                if (strcmp (stats_json, "-") == 0) {
+                        gl_stats_print_json (stdout);
+                } else {
+                        FILE *fp = g_fopen (stats_json, "w");
+                        if (fp != NULL) {
+                                gl_stats_print_json (fp);
+                                fclose (fp);
+                        } else {
+                                fprintf (stderr, _("cannot write %s\n"), stats_json);
+                        }
+                }
+        }
 }
 
 
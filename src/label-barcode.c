@@ -26,6 +26,8 @@
 #include <glib/gi18n.h>
 #include <pango/pangocairo.h>
 
+#include "stats.h"
+
 #include "debug.h"
 
 
@@ -43,6 +45,7 @@
 struct _glLabelBarcodePrivate {
 	glTextNode     *text_node;
 	gchar          *id;
+	const glBarcodeStyle *style;	/* Resolved from id. */
 	glColorNode    *color_node;
 	gboolean        text_flag;
 	gboolean        checksum_flag;
@@ -54,6 +57,13 @@ struct _glLabelBarcodePrivate {
 /* Private globals.                                       */
 /*========================================================*/
 
+/*
+ * Glyph index of each ASCII character (0 = not looked up yet), attached to
+ * each scaled font used for human readable text.
+ */
+G_LOCK_DEFINE_STATIC (text_glyphs);
+static cairo_user_data_key_t text_glyphs_key;
+
 
 /*========================================================*/
 /* Private function prototypes.                           */
@@ -64,6 +74,8 @@ static void  gl_label_barcode_finalize      (GObject             *object);
 static void  copy                           (glLabelObject       *dst_object,
 					     glLabelObject       *src_object);
 
+static GList *get_field_keys                (glLabelObject       *object);
+
 static void  get_size                       (glLabelObject       *object,
 					     gdouble             *w,
 					     gdouble             *h);
@@ -84,6 +96,18 @@ static gboolean object_at                   (glLabelObject       *object,
                                              gdouble              x_pixels,
                                              gdouble              y_pixels);
 
+static void     draw_matrix                 (cairo_t             *cr,
+                                             glBarcodeMatrix     *matrix);
+
+static void     draw_lines                  (cairo_t             *cr,
+                                             glBarcodeLines      *lines);
+
+static void     draw_chars                  (cairo_t             *cr,
+                                             glBarcodeChars      *chars);
+
+static gulong   get_glyph_index             (cairo_scaled_font_t *font,
+                                             gchar                c);
+
 
 /*****************************************************************************/
 /* Boilerplate object stuff.                                                 */
@@ -100,6 +124,7 @@ gl_label_barcode_class_init (glLabelBarcodeClass *class)
 	gl_label_barcode_parent_class = g_type_class_peek_parent (class);
 
 	label_object_class->copy           = copy;
+	label_object_class->get_field_keys = get_field_keys;
 	label_object_class->get_size       = get_size;
 	label_object_class->set_line_color = set_line_color;
 	label_object_class->get_line_color = get_line_color;
@@ -116,6 +141,7 @@ gl_label_barcode_init (glLabelBarcode *lbc)
 {
 	lbc->priv = g_new0 (glLabelBarcodePrivate, 1);
 	lbc->priv->text_node  = gl_text_node_new_from_text ("");
+	lbc->priv->style      = gl_barcode_style_lookup (NULL);
 }
 
 
@@ -205,6 +231,24 @@ copy (glLabelObject *dst_object,
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get merge field keys referenced by object method.               */
+/*---------------------------------------------------------------------------*/
+static GList *
+get_field_keys (glLabelObject *object)
+{
+	glLabelBarcode      *lbc = (glLabelBarcode *)object;
+	GList               *keys = NULL;
+
+	if ( lbc->priv->text_node->field_flag && lbc->priv->text_node->data )
+        {
+		keys = g_list_append (keys, g_strdup (lbc->priv->text_node->data));
+	}
+
+	return keys;
+}
+
+
 /*****************************************************************************/
 /* Set object params.                                                        */
 /*****************************************************************************/
@@ -264,6 +308,7 @@ gl_label_barcode_set_props (glLabelBarcode *lbc,
                 }
 
 		lbc->priv->id               = g_strdup (id);
+		lbc->priv->style            = gl_barcode_style_lookup (id);
 		lbc->priv->text_flag        = text_flag;
 		lbc->priv->checksum_flag    = checksum_flag;
 		lbc->priv->format_digits    = format_digits;
@@ -303,6 +348,15 @@ gl_label_barcode_get_props (glLabelBarcode *lbc,
 }
 
 
+const glBarcodeStyle *
+gl_label_barcode_get_style (glLabelBarcode *lbc)
+{
+	g_return_val_if_fail (lbc && GL_IS_LABEL_BARCODE (lbc), NULL);
+
+	return lbc->priv->style;
+}
+
+
 /*---------------------------------------------------------------------------*/
 /* PRIVATE.  Get object size method.                                         */
 /*---------------------------------------------------------------------------*/
@@ -314,7 +368,7 @@ get_size (glLabelObject *object,
 	glLabelBarcode      *lbc = (glLabelBarcode *)object;
 	gchar               *data;
 	gdouble              w_parent, h_parent;
-	glBarcode           *gbc;
+	gboolean             ok;
 
 	gl_debug (DEBUG_LABEL, "START");
 
@@ -329,41 +383,36 @@ get_size (glLabelObject *object,
 		data = gl_text_node_expand (lbc->priv->text_node, NULL);
 	}
 
-	gbc = gl_barcode_new (lbc->priv->id,
-			      lbc->priv->text_flag,
-			      lbc->priv->checksum_flag,
-			      w_parent,
-			      h_parent,
-			      data);
+	ok = gl_barcode_style_measure (lbc->priv->style,
+				       lbc->priv->text_flag,
+				       lbc->priv->checksum_flag,
+				       w_parent,
+				       h_parent,
+				       data,
+				       w, h);
 	g_free (data);
 
-	if ( gbc == NULL ) {
+	if ( !ok ) {
 		/* Try again with default digits. */
 		data = gl_barcode_default_digits (lbc->priv->id,
 						  lbc->priv->format_digits);
-		gbc = gl_barcode_new (lbc->priv->id,
-				      lbc->priv->text_flag,
-				      lbc->priv->checksum_flag,
-				      w_parent,
-				      h_parent,
-				      data);
+		ok = gl_barcode_style_measure (lbc->priv->style,
+					       lbc->priv->text_flag,
+					       lbc->priv->checksum_flag,
+					       w_parent,
+					       h_parent,
+					       data,
+					       w, h);
                 g_free (data);
 	}
 
-        if ( gbc != NULL )
-        {
-                *w = gbc->width;
-                *h = gbc->height;
-        }
-        else
+        if ( !ok )
         {
                 /* If we still can't render, just set a default size. */
                 *w = 144;
                 *h = 72;
         }
 
-	gl_barcode_free (&gbc);
-
 	gl_debug (DEBUG_LABEL, "END");
 }
 
@@ -422,19 +471,15 @@ draw_object (glLabelObject *object,
         gdouble               x0, y0;
         cairo_matrix_t        matrix;
         glBarcode            *gbc;
-        glBarcodeShape       *shape;
-        glBarcodeShapeLine   *line;
-        glBarcodeShapeAlpha  *bchar;
-        GList                *p;
-        gdouble               y_offset;
         PangoLayout          *layout;
         PangoFontDescription *desc;
-        gchar                *text, *cstring;
+        gchar                *text;
         glTextNode           *text_node;
         gchar                *id;
         gboolean              text_flag;
         gboolean              checksum_flag;
         guint                 color;
+        glStatsMark           mark;
         glColorNode          *color_node;
         guint                 format_digits;
         gdouble               w, h;
@@ -464,7 +509,10 @@ draw_object (glLabelObject *object,
 		text = gl_barcode_default_digits (id, format_digits);
 	}
 
-	gbc = gl_barcode_new (id, text_flag, checksum_flag, w, h, text);
+        gl_stats_mark (&mark);
+	gbc = gl_barcode_style_new (gl_label_barcode_get_style (GL_LABEL_BARCODE (object)),
+				    text_flag, checksum_flag, w, h, text);
+        gl_stats_add_phase (GL_STATS_PHASE_BARCODE_ENCODE, &mark);
 
         cairo_set_source_rgba (cr, GL_COLOR_RGBA_ARGS (color));
 
@@ -494,62 +542,235 @@ draw_object (glLabelObject *object,
 
 	} else {
 
-		for (p = gbc->shapes; p != NULL; p = p->next) {
-                        shape = (glBarcodeShape *)p->data;
-                        switch (shape->type)
+                if (gbc->matrix != NULL) {
+                        draw_matrix (cr, gbc->matrix);
+                }
+
+                if (gbc->lines.n > 0) {
+                        draw_lines (cr, &gbc->lines);
+                }
+
+                if (gbc->chars.n > 0) {
+                        draw_chars (cr, &gbc->chars);
+                }
+
+		gl_barcode_free (&gbc);
+
+	}
+
+	g_free (text);
+	gl_text_node_free (&text_node);
+	g_free (id);
+
+	gl_debug (DEBUG_LABEL, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw matrix symbol as one path of row runs, filled once.        */
+/*---------------------------------------------------------------------------*/
+static void
+draw_matrix (cairo_t         *cr,
+             glBarcodeMatrix *matrix)
+{
+        gdouble m = matrix->module_size;
+        gint    row, col, col0;
+
+        cairo_new_path (cr);
+
+        for ( row = 0; row < matrix->n_rows; row++ )
+        {
+                col = 0;
+                while ( col < matrix->n_cols )
+                {
+                        if ( !GL_BARCODE_MATRIX_GET (matrix, col, row) )
                         {
+                                col++;
+                                continue;
+                        }
 
-                        case GL_BARCODE_SHAPE_LINE:
-                                line = (glBarcodeShapeLine *) shape;
+                        col0 = col;
+                        while ( (col < matrix->n_cols) && GL_BARCODE_MATRIX_GET (matrix, col, row) )
+                        {
+                                col++;
+                        }
 
-                                cairo_move_to (cr, line->x, line->y);
-                                cairo_line_to (cr, line->x, line->y + line->length);
-                                cairo_set_line_width (cr, line->width);
-                                cairo_stroke (cr);
+                        cairo_rectangle (cr, col0*m, row*m, (col-col0)*m, m);
+                }
+        }
 
-                                break;
+        cairo_fill (cr);
+}
 
-                        case GL_BARCODE_SHAPE_ALPHA:
-                                bchar = (glBarcodeShapeAlpha *) shape;
 
-                                layout = pango_cairo_create_layout (cr);
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw bars as one path of rectangles, filled once.               */
+/*---------------------------------------------------------------------------*/
+static void
+draw_lines (cairo_t        *cr,
+            glBarcodeLines *lines)
+{
+        guint i;
+
+        cairo_new_path (cr);
+
+        /* Bar x is the center line, as when the bars were stroked. */
+        for ( i = 0; i < lines->n; i++ )
+        {
+                cairo_rectangle (cr,
+                                 lines->x[i] - lines->width[i]/2.0, lines->y[i],
+                                 lines->width[i], lines->length[i]);
+        }
 
-                                desc = pango_font_description_new ();
-                                pango_font_description_set_family (desc, GL_BARCODE_FONT_FAMILY);
-                                pango_font_description_set_size   (desc, bchar->fsize * PANGO_SCALE * FONT_SCALE);
-                                pango_layout_set_font_description (layout, desc);
-                                pango_font_description_free       (desc);
+        cairo_fill (cr);
+}
 
-                                cstring = g_strdup_printf ("%c", bchar->c);
-                                pango_layout_set_text (layout, cstring, -1);
-                                g_free (cstring);
 
-                                y_offset = 0.2 * bchar->fsize;
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw human readable characters, one glyph run per font size.    */
+/*                                                                           */
+/* Fonts are loaded through Pango, as the text of other objects is, so they  */
+/* follow fontconfig and the surface's font options.                         */
+/*---------------------------------------------------------------------------*/
+static void
+draw_chars (cairo_t        *cr,
+            glBarcodeChars *chars)
+{
+        PangoContext         *context;
+        PangoFontDescription *desc;
+        PangoFont            *font;
+        cairo_scaled_font_t  *scaled_font;
+        cairo_font_extents_t  extents;
+        cairo_glyph_t        *glyphs;
+        gdouble               fsize;
+        guint                 i, n;
 
-                                cairo_move_to (cr, bchar->x, bchar->y-y_offset);
-                                pango_cairo_show_layout (cr, layout);
+        context = pango_cairo_create_context (cr);
 
-                                g_object_unref (layout);
+        desc = pango_font_description_new ();
+        pango_font_description_set_family (desc, GL_BARCODE_FONT_FAMILY);
 
-                                break;
+        glyphs = g_new (cairo_glyph_t, chars->n);
 
-                        default:
-                                g_assert_not_reached ();
-                                break;
+        cairo_save (cr);
 
+        i = 0;
+        while ( i < chars->n )
+        {
+                /*
+                 * Pango sizes are in points at 96 dpi, scaled by FONT_SCALE,
+                 * so fsize is the font size in user units.  Characters are
+                 * positioned by the top of the text, 0.2*fsize above y.
+                 */
+                fsize = chars->fsize[i];
+                pango_font_description_set_size (desc, fsize * PANGO_SCALE * FONT_SCALE);
+                font = pango_context_load_font (context, desc);
+
+                scaled_font = NULL;
+                if ( font != NULL )
+                {
+                        scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
+                }
+
+                if ( scaled_font == NULL )
+                {
+                        /* Skip run. */
+                        while ( (i < chars->n) && (chars->fsize[i] == fsize) )
+                        {
+                                i++;
                         }
+                }
+                else
+                {
+                        cairo_set_scaled_font (cr, scaled_font);
+                        cairo_scaled_font_extents (scaled_font, &extents);
 
-		}
+                        for ( n = 0; (i < chars->n) && (chars->fsize[i] == fsize); i++, n++ )
+                        {
+                                glyphs[n].index = get_glyph_index (scaled_font, chars->c[i]);
+                                glyphs[n].x     = chars->x[i];
+                                glyphs[n].y     = chars->y[i] - 0.2*fsize + extents.ascent;
+                        }
 
-		gl_barcode_free (&gbc);
+                        cairo_show_glyphs (cr, glyphs, n);
+                }
 
-	}
+                if ( font != NULL )
+                {
+                        g_object_unref (font);
+                }
+        }
 
-	g_free (text);
-	gl_text_node_free (&text_node);
-	g_free (id);
+        cairo_restore (cr);
 
-	gl_debug (DEBUG_LABEL, "END");
+        g_free (glyphs);
+        pango_font_description_free (desc);
+        g_object_unref (context);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get glyph index of character in scaled font.                    */
+/*                                                                           */
+/* ASCII characters are cached in a table that lives as long as the font.   */
+/*---------------------------------------------------------------------------*/
+static gulong
+get_glyph_index (cairo_scaled_font_t *font,
+                 gchar                c)
+{
+        gulong        *table = NULL;
+        gchar          cstring[2];
+        cairo_glyph_t *glyphs = NULL;
+        gint           n_glyphs = 0;
+        gulong         index = 0;
+
+        if ( !(c & 0x80) )
+        {
+                G_LOCK (text_glyphs);
+                table = cairo_scaled_font_get_user_data (font, &text_glyphs_key);
+                if ( table == NULL )
+                {
+                        table = g_new0 (gulong, 128);
+                        if ( cairo_scaled_font_set_user_data (font, &text_glyphs_key,
+                                                              table, g_free) != CAIRO_STATUS_SUCCESS )
+                        {
+                                g_free (table);
+                                table = NULL;
+                        }
+                }
+                if ( table != NULL )
+                {
+                        index = table[(guchar)c];
+                }
+                G_UNLOCK (text_glyphs);
+
+                if ( index != 0 )
+                {
+                        return index;
+                }
+        }
+
+        cstring[0] = c;
+        cstring[1] = '\0';
+        if ( cairo_scaled_font_text_to_glyphs (font, 0, 0, cstring, 1,
+                                               &glyphs, &n_glyphs,
+                                               NULL, NULL, NULL) == CAIRO_STATUS_SUCCESS )
+        {
+                if ( n_glyphs > 0 )
+                {
+                        index = glyphs[0].index;
+                }
+                cairo_glyph_free (glyphs);
+        }
+
+        if ( table != NULL )
+        {
+                G_LOCK (text_glyphs);
+                table[(guchar)c] = index;
+                G_UNLOCK (text_glyphs);
+        }
+
+        return index;
 }
 
 
@@ -74,6 +74,8 @@ void            gl_label_barcode_get_props (glLabelBarcode *lbc,
 					    gboolean       *checksum_flag,
 					    guint          *format_digits);
 
+const glBarcodeStyle *gl_label_barcode_get_style (glLabelBarcode *lbc);
+
 G_END_DECLS
 
 #endif /* __LABEL_BARCODE_H__ */
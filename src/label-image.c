@@ -30,6 +30,7 @@
 
 #include "pixbuf-util.h"
 #include "file-util.h"
+#include "stats.h"
 #include "pixmaps/checkerboard.xpm"
 
 #include "debug.h"
@@ -76,6 +77,8 @@ static void gl_label_image_finalize      (GObject           *object);
 static void copy                         (glLabelObject     *dst_object,
                                           glLabelObject     *src_object);
 
+static GList *get_field_keys             (glLabelObject     *object);
+
 static void set_size                     (glLabelObject     *object,
                                           gdouble            w,
                                           gdouble            h,
@@ -113,6 +116,7 @@ gl_label_image_class_init (glLabelImageClass *class)
         gl_label_image_parent_class = g_type_class_peek_parent (class);
 
         label_object_class->copy              = copy;
+        label_object_class->get_field_keys    = get_field_keys;
         label_object_class->set_size          = set_size;
         label_object_class->draw_object       = draw_object;
         label_object_class->draw_shadow       = draw_shadow;
@@ -270,6 +274,24 @@ copy (glLabelObject *dst_object,
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get merge field keys referenced by object method.               */
+/*---------------------------------------------------------------------------*/
+static GList *
+get_field_keys (glLabelObject *object)
+{
+        glLabelImage *this = (glLabelImage *)object;
+        GList        *keys = NULL;
+
+        if ( this->priv->filename->field_flag && this->priv->filename->data )
+        {
+                keys = g_list_append (keys, g_strdup (this->priv->filename->data));
+        }
+
+        return keys;
+}
+
+
 /*---------------------------------------------------------------------------*/
 /* PRIVATE.  Set size method.                                                */
 /*---------------------------------------------------------------------------*/
@@ -539,6 +561,7 @@ gl_label_image_get_pixbuf (glLabelImage  *this,
 
                 GdkPixbuf   *pixbuf = NULL;
                 gchar       *real_filename;
+                glStatsMark  mark;
 
                 /* Indirect filename, re-evaluate for given record. */
 
@@ -547,7 +570,9 @@ gl_label_image_get_pixbuf (glLabelImage  *this,
 
                 if (real_filename != NULL)
                 {
+                        gl_stats_mark (&mark);
                         pixbuf = gdk_pixbuf_new_from_file (real_filename, NULL);
+                        gl_stats_add_phase (GL_STATS_PHASE_IMAGE_DECODE, &mark);
                 }
                 return pixbuf;
         }
@@ -574,6 +599,7 @@ gl_label_image_get_svg_handle (glLabelImage  *this,
 
 		RsvgHandle  *svg_handle = NULL;
 		gchar       *real_filename;
+                glStatsMark  mark;
 
 		/* Indirect filename, re-evaluate for given record. */
 
@@ -584,7 +610,9 @@ gl_label_image_get_svg_handle (glLabelImage  *this,
                 {
                         if ( gl_file_util_is_extension (real_filename, ".svg") )
                         {
+                                gl_stats_mark (&mark);
                                 svg_handle = rsvg_handle_new_from_file (real_filename, NULL);
+                                gl_stats_add_phase (GL_STATS_PHASE_IMAGE_DECODE, &mark);
                         }
 		}
                 return svg_handle;
@@ -25,8 +25,10 @@
 #include <glib/gi18n.h>
 #include <glib.h>
 #include <math.h>
+#include <string.h>
 
 #include "marshal.h"
+#include "stats.h"
 
 #include "debug.h"
 
@@ -97,6 +99,12 @@ static void     set_size                  (glLabelObject      *object,
 					   gdouble             h,
                                            gboolean            checkpoint);
 
+static GList   *add_field_key             (GList              *keys,
+                                           const gchar        *key);
+
+static GList   *add_color_field_key       (GList              *keys,
+                                           glColorNode        *color_node);
+
 
 /*****************************************************************************/
 /* Boilerplate object stuff.                                                 */
@@ -1342,6 +1350,85 @@ gl_label_object_get_shadow_opacity (glLabelObject     *object)
 }
 
 
+/****************************************************************************/
+/* Get list of merge field keys referenced by object.                       */
+/*                                                                          */
+/* An object with no field keys renders identically for every record.      */
+/* Free returned list with gl_merge_free_key_list().                        */
+/****************************************************************************/
+GList *
+gl_label_object_get_field_keys (glLabelObject     *object)
+{
+        GList       *keys = NULL;
+        GList       *object_keys, *p;
+
+	gl_debug (DEBUG_LABEL, "START");
+
+	g_return_val_if_fail (object && GL_IS_LABEL_OBJECT (object), NULL);
+
+        keys = add_color_field_key (keys, gl_label_object_get_text_color (object));
+        keys = add_color_field_key (keys, gl_label_object_get_fill_color (object));
+        keys = add_color_field_key (keys, gl_label_object_get_line_color (object));
+
+        if ( object->priv->shadow_state )
+        {
+                keys = add_color_field_key (keys, gl_color_node_dup (object->priv->shadow_color_node));
+        }
+
+	if ( GL_LABEL_OBJECT_GET_CLASS(object)->get_field_keys != NULL )
+        {
+		/* We have an object specific method, use it */
+		object_keys = GL_LABEL_OBJECT_GET_CLASS(object)->get_field_keys (object);
+
+                for ( p = object_keys; p != NULL; p = p->next )
+                {
+                        keys = add_field_key (keys, (gchar *)p->data);
+                }
+                gl_merge_free_key_list (&object_keys);
+	}
+
+	gl_debug (DEBUG_LABEL, "END");
+
+	return keys;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add key to list, if not already present.                        */
+/*---------------------------------------------------------------------------*/
+static GList *
+add_field_key (GList       *keys,
+               const gchar *key)
+{
+        if ( (key != NULL) && !g_list_find_custom (keys, key, (GCompareFunc)strcmp) )
+        {
+                keys = g_list_append (keys, g_strdup (key));
+        }
+
+        return keys;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add key of color node to list, if it is a field. Frees node.    */
+/*---------------------------------------------------------------------------*/
+static GList *
+add_color_field_key (GList       *keys,
+                     glColorNode *color_node)
+{
+        if ( color_node != NULL )
+        {
+                if ( color_node->field_flag )
+                {
+                        keys = add_field_key (keys, color_node->key);
+                }
+                gl_color_node_free (&color_node);
+        }
+
+        return keys;
+}
+
+
 /****************************************************************************/
 /* Flip object horizontally.                                                */
 /****************************************************************************/
@@ -1444,11 +1531,19 @@ gl_label_object_draw (glLabelObject *object,
         cairo_matrix_t matrix;
 	gboolean       shadow_state;
 	gdouble        shadow_x, shadow_y;
+        gboolean       stats_flag;
+        glStatsMark    mark;
 
 	gl_debug (DEBUG_LABEL, "START");
 
 	g_return_if_fail (object && GL_IS_LABEL_OBJECT (object));
 
+        stats_flag = gl_stats_enabled ();
+        if ( stats_flag )
+        {
+                gl_stats_mark (&mark);
+        }
+
         gl_label_object_get_position (object, &x0, &y0);
         gl_label_object_get_matrix (object, &matrix);
 
@@ -1491,6 +1586,11 @@ gl_label_object_draw (glLabelObject *object,
 
         cairo_restore (cr);
 
+        if ( stats_flag )
+        {
+                gl_stats_add_object (G_OBJECT_TYPE (object), &mark);
+        }
+
 	gl_debug (DEBUG_LABEL, "END");
 }
 
@@ -157,6 +157,8 @@ struct _glLabelObjectClass {
 ,
                                                    glLabelObject     *src_object);
 
+        GList *           (*get_field_keys)       (glLabelObject     *object);
+
         /*
          * Draw methods
          */
@@ -376,6 +378,9 @@ glColorNode*   gl_label_object_get_shadow_color      (glLabelObject     *object)
 gdouble        gl_label_object_get_shadow_opacity    (glLabelObject     *object);
 
 
+GList         *gl_label_object_get_field_keys        (glLabelObject     *object);
+
+
 void           gl_label_object_draw                  (glLabelObject     *object,
                                                       cairo_t           *cr,
                                                       gboolean           screen_flag,
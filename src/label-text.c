@@ -30,6 +30,7 @@
 
 #include "font-util.h"
 #include "font-history.h"
+#include "stats.h"
 
 #include "debug.h"
 
@@ -84,6 +85,8 @@ static void gl_label_text_finalize      (GObject          *object);
 static void copy                        (glLabelObject    *dst_object,
 					 glLabelObject    *src_object);
 
+static GList *get_field_keys             (glLabelObject    *object);
+
 static void buffer_begin_user_action_cb (GtkTextBuffer    *textbuffer,
                                          glLabelText      *ltext);
 
@@ -192,6 +195,7 @@ gl_label_text_class_init (glLabelTextClass *class)
 	gl_label_text_parent_class = g_type_class_peek_parent (class);
 
 	label_object_class->copy                  = copy;
+	label_object_class->get_field_keys        = get_field_keys;
 
 	label_object_class->get_size              = get_size;
 
@@ -436,6 +440,35 @@ gl_label_text_get_text (glLabelText      *ltext)
 }
 
 
+/*****************************************************************************/
+/* Get merge field keys referenced by object method.                         */
+/*****************************************************************************/
+static GList *
+get_field_keys (glLabelObject *object)
+{
+	glLabelText      *ltext = (glLabelText *)object;
+	GList            *lines, *p_line, *p_node;
+	glTextNode       *text_node;
+	GList            *keys = NULL;
+
+	lines = gl_label_text_get_lines (ltext);
+	for (p_line = lines; p_line != NULL; p_line = p_line->next)
+        {
+		for (p_node = (GList *) p_line->data; p_node != NULL; p_node = p_node->next)
+                {
+			text_node = (glTextNode *) p_node->data;
+			if ( text_node->field_flag && text_node->data )
+                        {
+				keys = g_list_append (keys, g_strdup (text_node->data));
+			}
+		}
+	}
+	gl_text_node_lines_free (&lines);
+
+	return keys;
+}
+
+
 /*****************************************************************************/
 /* Text buffer "changed" callback.                                           */
 /*****************************************************************************/
@@ -1034,12 +1067,15 @@ set_text_path (glLabelText      *this,
         PangoFontDescription *desc;
         cairo_font_options_t *font_options;
         PangoContext         *context;
+        glStatsMark           mark;
 
 
         gl_debug (DEBUG_LABEL, "START");
 
         cairo_save (cr);
 
+        gl_stats_mark (&mark);
+
         gl_label_object_get_size (GL_LABEL_OBJECT (this), &object_w, &object_h);
         gl_label_object_get_raw_size (GL_LABEL_OBJECT (this), &raw_w, &raw_h);
 
@@ -1098,6 +1134,8 @@ set_text_path (glLabelText      *this,
         g_object_unref (layout);
         gl_text_node_lines_free (&lines);
 
+        gl_stats_add_phase (GL_STATS_PHASE_TEXT_LAYOUT, &mark);
+
         cairo_restore (cr);
 
         gl_debug (DEBUG_LABEL, "END");
@@ -382,7 +382,8 @@ gl_merge_text_close (glMerge *merge)
 
 	if (merge_text->priv->fp != NULL) {
 
-		fclose (merge_text->priv->fp);
+		if (merge_text->priv->fp != stdin)
+			fclose (merge_text->priv->fp);
 		merge_text->priv->fp = NULL;
 
 	}
@@ -235,7 +235,11 @@ gl_merge_vcard_open (glMerge *merge)
         src = gl_merge_get_src (merge);
 
         if (src != NULL) {
-                merge_vcard->priv->fp = fopen (src, "r");
+                if (strcmp (src, "-") == 0) {
+                        merge_vcard->priv->fp = stdin;
+                } else {
+                        merge_vcard->priv->fp = fopen (src, "r");
+                }
         }
 
         g_free (src);
@@ -255,7 +259,9 @@ gl_merge_vcard_close (glMerge *merge)
         merge_vcard = GL_MERGE_VCARD (merge);
 
         if (merge_vcard->priv->fp != NULL) {
-                fclose (merge_vcard->priv->fp);
+                if (merge_vcard->priv->fp != stdin) {
+                        fclose (merge_vcard->priv->fp);
+                }
                 merge_vcard->priv->fp = NULL;
         }
 }
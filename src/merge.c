@@ -404,9 +404,25 @@ gl_merge_get_src_type (glMerge *merge)
 void
 gl_merge_set_src (glMerge *merge,
 		  gchar   *src)
+{
+	gl_merge_set_src_range (merge, src, 1, 0);
+}
+
+/*****************************************************************************/
+/* Set src of merge, keeping only records first_record to last_record of the */
+/* source (1 based, inclusive; last_record < 1 means to the end).  Records   */
+/* before the range are freed as they are read, and reading stops after the */
+/* last one, so the remainder of the source is never parsed.                */
+/*****************************************************************************/
+void
+gl_merge_set_src_range (glMerge *merge,
+			gchar   *src,
+			gint     first_record,
+			gint     last_record)
 {
 	GList         *record_list = NULL;
 	glMergeRecord *record;
+	gint           i_record;
 
 	gl_debug (DEBUG_MERGE, "START");
 
@@ -432,21 +448,37 @@ gl_merge_set_src (glMerge *merge,
 	else
 	{
 
+		src = g_strdup (src);
 		if ( merge->priv->src != NULL )
 		{
 			g_free(merge->priv->src);
 		}
-		merge->priv->src = g_strdup (src);
+		merge->priv->src = src;
 
 		merge_free_record_list (&merge->priv->record_list);
 			
 		merge_open (merge);
-		while ( (record = merge_get_record (merge)) != NULL )
+		for ( i_record = 1;
+		      (last_record < 1) || (i_record <= last_record);
+		      i_record++ )
 		{
-			record_list = g_list_append( record_list, record );
+			record = merge_get_record (merge);
+			if ( record == NULL )
+			{
+				break;
+			}
+
+			if ( i_record < first_record )
+			{
+				merge_free_record (&record);
+			}
+			else
+			{
+				record_list = g_list_prepend( record_list, record );
+			}
 		}
 		merge_close (merge);
-		merge->priv->record_list = record_list;
+		merge->priv->record_list = g_list_reverse (record_list);
 
 	}
 		     
@@ -717,6 +749,59 @@ gl_merge_get_record_list (glMerge *merge)
 	}
 }
 
+/*****************************************************************************/
+/* Open src of merge for reading one record at a time.  Records are not      */
+/* kept in the merge's record list, which is emptied, so any source can be   */
+/* read in constant memory, including a pipe (src "-", standard input, for   */
+/* backends that support it).                                                */
+/*****************************************************************************/
+void
+gl_merge_stream_open (glMerge *merge,
+		      gchar   *src)
+{
+	gl_debug (DEBUG_MERGE, "START");
+
+	g_return_if_fail (merge && GL_IS_MERGE (merge));
+
+	src = g_strdup (src);
+	g_free (merge->priv->src);
+	merge->priv->src = src;
+
+	merge_free_record_list (&merge->priv->record_list);
+
+	merge_open (merge);
+
+	gl_debug (DEBUG_MERGE, "END");
+}
+
+/*****************************************************************************/
+/* Get next record of opened stream, NULL at end.  Free with                 */
+/* gl_merge_free_record().                                                   */
+/*****************************************************************************/
+glMergeRecord *
+gl_merge_stream_get_record (glMerge *merge)
+{
+	return merge_get_record (merge);
+}
+
+/*****************************************************************************/
+/* Close stream.                                                             */
+/*****************************************************************************/
+void
+gl_merge_stream_close (glMerge *merge)
+{
+	merge_close (merge);
+}
+
+/*****************************************************************************/
+/* Free record returned by gl_merge_stream_get_record().                     */
+/*****************************************************************************/
+void
+gl_merge_free_record (glMergeRecord **record)
+{
+	merge_free_record (record);
+}
+
 /*---------------------------------------------------------------------------*/
 /* Free a list of records.                                                   */
 /*---------------------------------------------------------------------------*/
@@ -790,6 +875,39 @@ gl_merge_get_record_count (glMerge *merge)
 }
 
 
+/*****************************************************************************/
+/* Get list node of n'th selected record (0 based).                          */
+/*****************************************************************************/
+const GList *
+gl_merge_get_nth_record (glMerge *merge,
+			 gint     n)
+{
+	GList         *p;
+	glMergeRecord *record;
+	gint           i;
+
+	gl_debug (DEBUG_MERGE, "START");
+
+	if ( (merge == NULL) || (n < 0) ) {
+		return NULL;
+	}
+
+	i = 0;
+	for ( p=merge->priv->record_list; p!=NULL; p=p->next ) {
+		record = (glMergeRecord *)p->data;
+
+		if ( record->select_flag ) {
+			if ( i == n ) break;
+			i++;
+		}
+	}
+
+	gl_debug (DEBUG_MERGE, "END");
+
+	return p;
+}
+
+
 
 /*
  * Local Variables:       -- emacs
@@ -107,6 +107,11 @@ glMergeSrcType    gl_merge_get_src_type        (glMerge           *merge);
 void              gl_merge_set_src             (glMerge           *merge,
 						gchar             *src);
 
+void              gl_merge_set_src_range       (glMerge           *merge,
+						gchar             *src,
+						gint               first_record,
+						gint               last_record);
+
 gchar            *gl_merge_get_src             (glMerge           *merge);
 
 GList            *gl_merge_get_key_list        (glMerge           *merge);
@@ -120,8 +125,20 @@ gchar            *gl_merge_eval_key            (glMergeRecord     *record,
 
 const GList      *gl_merge_get_record_list     (glMerge           *merge);
 
+void              gl_merge_stream_open         (glMerge           *merge,
+						gchar             *src);
+
+glMergeRecord    *gl_merge_stream_get_record   (glMerge           *merge);
+
+void              gl_merge_stream_close        (glMerge           *merge);
+
+void              gl_merge_free_record         (glMergeRecord    **record);
+
 gint              gl_merge_get_record_count    (glMerge           *merge);
 
+const GList      *gl_merge_get_nth_record      (glMerge           *merge,
+						gint               n);
+
 G_END_DECLS
 
 #endif
@@ -1149,6 +1149,8 @@ draw_rich_preview (glMiniPreview          *this,
 
         merge = gl_label_get_merge (this->priv->label);
 
+        gl_print_state_init (&state);
+
         if (!merge)
         {
                 gl_print_simple_sheet (this->priv->label,
@@ -1159,17 +1161,17 @@ draw_rich_preview (glMiniPreview          *this,
                                        this->priv->last,
                                        this->priv->outline_flag,
                                        this->priv->reverse_flag,
-                                       this->priv->crop_marks_flag);
+                                       this->priv->crop_marks_flag,
+                                       &state);
         }
         else
         {
-                /* FIXME: maybe the renderers should be more self contained.
-                 *        This will only work for the first page, since
-                 *        previous pages must be rendered to establish
-                 *        state.
-                 */
-                state.i_copy = 0;
-                state.p_record = (GList *)gl_merge_get_record_list (merge);
+                gl_print_state_seek_sheet (this->priv->label,
+                                           &state,
+                                           this->priv->page,
+                                           this->priv->n_copies,
+                                           this->priv->first,
+                                           this->priv->collate_flag);
 
                 if (this->priv->collate_flag)
                 {
@@ -1196,6 +1198,8 @@ draw_rich_preview (glMiniPreview          *this,
                                                          &state);
                 }
         }
+
+        gl_print_state_clear (&state);
 }
 
 
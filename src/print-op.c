@@ -57,6 +57,7 @@ struct _glPrintOpPrivate {
         gint       last;
         gint       n_sheets;
         gint       n_copies;
+        gint       start_sheet;
 
         glPrintState state;
 };
@@ -102,6 +103,10 @@ static void     draw_page_cb                  (GtkPrintOperation *operation,
                                                int                page_nr,
                                                gpointer           user_data);
 
+static void     end_print_cb                  (GtkPrintOperation *operation,
+                                               GtkPrintContext   *context,
+                                               gpointer           user_data);
+
 
 /*****************************************************************************/
 /* Boilerplate object stuff.                                                 */
@@ -133,6 +138,7 @@ gl_print_op_init (glPrintOp *op)
 
 	op->priv = g_new0 (glPrintOpPrivate, 1);
 
+        gl_print_state_init (&op->priv->state);
 }
 
 
@@ -147,13 +153,12 @@ gl_print_op_finalize (GObject *object)
         g_return_if_fail (GL_IS_PRINT_OP (op));
 	g_return_if_fail (op->priv != NULL);
 
+        gl_print_state_clear (&op->priv->state);
         g_object_unref (G_OBJECT(op->priv->label));
         g_free (op->priv->filename);
 	g_free (op->priv);
 
 	G_OBJECT_CLASS (gl_print_op_parent_class)->finalize (object);
-
-	g_free (op->priv);
 }
 
 
@@ -186,7 +191,7 @@ gl_print_op_construct (glPrintOp      *op,
         const lglTemplate      *template;
         const lglTemplateFrame *frame;
 
-	op->priv->label              = label;
+	op->priv->label              = g_object_ref (label);
 	op->priv->force_outline_flag = FALSE;
 
         merge    = gl_label_get_merge (label);
@@ -198,6 +203,7 @@ gl_print_op_construct (glPrintOp      *op,
         op->priv->first              = 1;
         op->priv->last               = lgl_template_frame_get_n_labels (frame);
         op->priv->n_copies           = 1;
+        op->priv->start_sheet        = 0;
 
         set_page_size (op, label);
 
@@ -209,6 +215,9 @@ gl_print_op_construct (glPrintOp      *op,
 
 	g_signal_connect (G_OBJECT (op), "draw-page",
 			  G_CALLBACK (draw_page_cb), label);
+
+	g_signal_connect (G_OBJECT (op), "end-print",
+			  G_CALLBACK (end_print_cb), label);
 }
 
 
@@ -276,6 +285,14 @@ gl_print_op_set_last (glPrintOp *op,
 }
 
 
+void
+gl_print_op_set_start_sheet (glPrintOp *op,
+                             gint       start_sheet)
+{
+        op->priv->start_sheet = start_sheet;
+}
+
+
 void
 gl_print_op_set_collate_flag (glPrintOp *op,
                               gboolean   collate_flag)
@@ -352,6 +369,13 @@ gl_print_op_get_last (glPrintOp *op)
 }
 
 
+gint
+gl_print_op_get_start_sheet (glPrintOp *op)
+{
+        return op->priv->start_sheet;
+}
+
+
 gboolean
 gl_print_op_get_collate_flag (glPrintOp *op)
 {
@@ -524,6 +548,18 @@ begin_print_cb (GtkPrintOperation *operation,
 
         gtk_print_operation_set_n_pages (operation, op->priv->n_sheets);
 
+        /* Not starting at the first sheet, so seek merge state directly
+         * rather than relying on preceding pages to establish it. */
+        if ( op->priv->merge_flag && (op->priv->start_sheet > 0) )
+        {
+                gl_print_state_seek_sheet (op->priv->label,
+                                           &op->priv->state,
+                                           op->priv->start_sheet,
+                                           op->priv->n_copies,
+                                           op->priv->first,
+                                           op->priv->collate_flag);
+        }
+
 }
 
 
@@ -538,20 +574,24 @@ draw_page_cb (GtkPrintOperation *operation,
 {
         glPrintOp *op = GL_PRINT_OP (operation);
         cairo_t       *cr;
+        gint           page;
 
         cr = gtk_print_context_get_cairo_context (context);
 
+        page = op->priv->start_sheet + page_nr;
+
         if (!op->priv->merge_flag)
         {
                 gl_print_simple_sheet (op->priv->label,
                                        cr,
-                                       page_nr,
+                                       page,
                                        op->priv->n_sheets,
                                        op->priv->first,
                                        op->priv->last,
                                        op->priv->outline_flag,
                                        op->priv->reverse_flag,
-                                       op->priv->crop_marks_flag);
+                                       op->priv->crop_marks_flag,
+                                       &op->priv->state);
         }
         else
         {
@@ -559,7 +599,7 @@ draw_page_cb (GtkPrintOperation *operation,
                 {
                         gl_print_collated_merge_sheet (op->priv->label,
                                                        cr,
-                                                       page_nr,
+                                                       page,
                                                        op->priv->n_copies,
                                                        op->priv->first,
                                                        op->priv->outline_flag,
@@ -571,7 +611,7 @@ draw_page_cb (GtkPrintOperation *operation,
                 {
                         gl_print_uncollated_merge_sheet (op->priv->label,
                                                          cr,
-                                                         page_nr,
+                                                         page,
                                                          op->priv->n_copies,
                                                          op->priv->first,
                                                          op->priv->outline_flag,
@@ -583,6 +623,21 @@ draw_page_cb (GtkPrintOperation *operation,
 }
 
 
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  "End print" callback                                           */
+/*--------------------------------------------------------------------------*/
+static void
+end_print_cb (GtkPrintOperation *operation,
+              GtkPrintContext   *context,
+              gpointer           user_data)
+{
+        glPrintOp *op = GL_PRINT_OP (operation);
+
+        /* Release anything cached for this job. */
+        gl_print_state_clear (&op->priv->state);
+}
+
+
 
 
 /*
@@ -79,6 +79,8 @@ void               gl_print_op_set_first           (glPrintOp         *print_op,
                                                     gint               first);
 void               gl_print_op_set_last            (glPrintOp         *print_op,
                                                     gint               last);
+void               gl_print_op_set_start_sheet     (glPrintOp         *print_op,
+                                                    gint               start_sheet);
 void               gl_print_op_set_collate_flag    (glPrintOp         *print_op,
                                                     gboolean           collate_flag);
 void               gl_print_op_set_outline_flag    (glPrintOp         *print_op,
@@ -93,6 +95,7 @@ gint               gl_print_op_get_n_sheets        (glPrintOp         *print_op)
 gint               gl_print_op_get_n_copies        (glPrintOp         *print_op);
 gint               gl_print_op_get_first           (glPrintOp         *print_op);
 gint               gl_print_op_get_last            (glPrintOp         *print_op);
+gint               gl_print_op_get_start_sheet     (glPrintOp         *print_op);
 gboolean           gl_print_op_get_collate_flag    (glPrintOp         *print_op);
 gboolean           gl_print_op_get_outline_flag    (glPrintOp         *print_op);
 gboolean           gl_print_op_get_reverse_flag    (glPrintOp         *print_op);
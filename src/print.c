@@ -24,12 +24,14 @@
 
 #include <glib/gi18n.h>
 #include <math.h>
+#include <string.h>
 #include <time.h>
 #include <ctype.h>
 
 #include <libglabels.h>
 #include "label.h"
 #include "cairo-label-path.h"
+#include "barcode-prefetch.h"
 
 #include "debug.h"
 
@@ -45,14 +47,70 @@
 #define TICK_OFFSET  2.25
 #define TICK_LENGTH 18.0
 
+#define RECORD_CACHE_SIZE 64
+
 
 /*=========================================================================*/
 /* Private types.                                                          */
 /*=========================================================================*/
 
+/*
+ * Print cache, owned by a glPrintState and kept for the life of a print job.
+ */
+struct _glPrintCache {
+
+        /* Label content, split into layers in z-order. */
+        gboolean         layers_valid;
+        GList           *layers;
+
+        /* Merge field keys referenced by label. */
+        GList           *field_keys;
+
+        /* Recent record contents (by referenced field values), most recent first. */
+        GHashTable      *record_index;
+        GQueue          *record_lru;
+
+        /* Barcodes of upcoming records, encoded ahead of drawing (merge only). */
+        gboolean           prefetch_valid;
+        glBarcodePrefetch *prefetch;
+
+        /* Complete simple (non-merge) sheet, identical on every page. */
+        cairo_pattern_t *sheet_pattern;
+
+        /* Template geometry. */
+        const lglTemplate *template;
+        gint               n_labels;
+        lglTemplateOrigin *origins;
+        cairo_path_t      *outline_path;
+        cairo_path_t      *clip_path;
+
+};
+
+/*
+ * A layer is either a recording of a run of consecutive static objects
+ * (objects that reference no merge fields), or a single field dependent
+ * object that must be drawn for each record.
+ */
+typedef struct {
+        cairo_pattern_t *pattern;
+        glLabelObject   *object;
+} PrintLayer;
+
+/*
+ * Record cache entry.  The pattern is only recorded once the same field
+ * values have been seen a second time, so unique records cost nothing extra.
+ */
+typedef struct {
+        gchar           *key;
+        cairo_pattern_t *pattern;
+} PrintRecordEntry;
+
 typedef struct _PrintInfo {
         cairo_t    *cr;
 
+        /* Print job cache */
+        glPrintCache *cache;
+
 	/* gLabels Template */
 	const lglTemplate *template;
 	gboolean           rotate_flag;
@@ -68,7 +126,8 @@ typedef struct _PrintInfo {
 /* Private function prototypes.                                            */
 /*=========================================================================*/
 static PrintInfo *print_info_new              (cairo_t          *cr,
-					       glLabel          *label);
+					       glLabel          *label,
+					       glPrintState     *state);
 
 static void       print_info_free             (PrintInfo       **pi);
 
@@ -83,15 +142,64 @@ static void       print_label                 (PrintInfo        *pi,
 					       gboolean          reverse_flag);
 
 
+static void       draw_label_content          (PrintInfo        *pi,
+					       glLabel          *label,
+					       glMergeRecord    *record);
+
+static void       draw_label_layers           (glPrintCache     *cache,
+					       cairo_t          *cr,
+					       glMergeRecord    *record);
+
 static void       draw_outline                (PrintInfo        *pi,
 					       glLabel          *label);
 
 static void       clip_to_outline             (PrintInfo        *pi,
 					       glLabel          *label);
 
+static cairo_pattern_t *record_simple_sheet  (glLabel          *label,
+					       cairo_t          *cr,
+					       glPrintState     *state,
+					       gint              first,
+					       gint              last,
+					       gboolean          outline_flag,
+					       gboolean          reverse_flag,
+					       gboolean          crop_marks_flag);
+
+static cairo_t   *recording_cr_new            (cairo_t          *cr);
+
+static cairo_pattern_t *recording_cr_finish   (cairo_t          *recording_cr);
+
+static glPrintCache *print_cache_get          (glPrintState     *state);
+
+static glMerge   *print_state_get_merge       (glPrintState     *state,
+                                               glLabel          *label);
+
+static void       print_cache_free            (glPrintCache     *cache);
+
+static void       print_cache_update_geometry (glPrintCache     *cache,
+					       const lglTemplate *template);
+
+static cairo_pattern_t *print_cache_lookup_record (glPrintCache *cache,
+					       cairo_t          *cr,
+					       glMergeRecord    *record);
+
+static void       print_record_entry_free     (PrintRecordEntry *entry);
+
+static void       print_cache_prefetch        (glPrintCache     *cache,
+					       glLabel          *label,
+					       GList            *p_record);
+
+static void       print_cache_build_layers    (glPrintCache     *cache,
+					       PrintInfo        *pi,
+					       glLabel          *label,
+					       glMergeRecord    *record);
+
 
 /*****************************************************************************/
 /* Print simple sheet (no merge data) command.                               */
+/*                                                                           */
+/* Without merge data every label, and therefore every sheet, is identical.  */
+/* The sheet is recorded once per print job and replayed for each page.      */
 /*****************************************************************************/
 void
 gl_print_simple_sheet (glLabel          *label,
@@ -102,35 +210,28 @@ gl_print_simple_sheet (glLabel          *label,
                        gint              last,
                        gboolean          outline_flag,
                        gboolean          reverse_flag,
-                       gboolean          crop_marks_flag)
+                       gboolean          crop_marks_flag,
+                       glPrintState     *state)
 {
-	PrintInfo              *pi;
-	const lglTemplateFrame *frame;
-	gint                    i_label;
-	lglTemplateOrigin      *origins;
+	glPrintCache           *cache;
 
 	gl_debug (DEBUG_PRINT, "START");
 
-	pi         = print_info_new (cr, label);
-
-        frame = (lglTemplateFrame *)pi->template->frames->data;
-	origins = lgl_template_frame_get_origins (frame);
-
-        if (crop_marks_flag) {
-                print_crop_marks (pi);
-        }
-
-        for (i_label = first - 1; i_label < last; i_label++) {
-
-                print_label (pi, label,
-                             origins[i_label].x, origins[i_label].y,
-                             NULL, outline_flag, reverse_flag);
+        cache = print_cache_get (state);
 
+        if ( cache->sheet_pattern == NULL )
+        {
+                cache->sheet_pattern = record_simple_sheet (label, cr, state,
+                                                            first, last,
+                                                            outline_flag,
+                                                            reverse_flag,
+                                                            crop_marks_flag);
         }
 
-	g_free (origins);
-
-	print_info_free (&pi);
+        cairo_save (cr);
+        cairo_set_source (cr, cache->sheet_pattern);
+        cairo_paint (cr);
+        cairo_restore (cr);
 
 	gl_debug (DEBUG_PRINT, "END");
 }
@@ -153,22 +254,20 @@ gl_print_collated_merge_sheet   (glLabel          *label,
 	glMerge                   *merge;
 	const GList               *record_list;
 	PrintInfo                 *pi;
-	const lglTemplateFrame    *frame;
 	gint                       i_label, n_labels_per_page, i_copy;
 	glMergeRecord             *record;
 	GList                     *p;
-	lglTemplateOrigin         *origins;
+	const lglTemplateOrigin   *origins;
 
 	gl_debug (DEBUG_PRINT, "START");
 
-	merge = gl_label_get_merge (label);
+	merge = print_state_get_merge (state, label);
 	record_list = gl_merge_get_record_list (merge);
 
-	pi = print_info_new (cr, label);
-        frame = (lglTemplateFrame *)pi->template->frames->data;
+	pi = print_info_new (cr, label, state);
 
-	n_labels_per_page = lgl_template_frame_get_n_labels (frame);
-	origins = lgl_template_frame_get_origins (frame);
+	n_labels_per_page = pi->cache->n_labels;
+	origins = pi->cache->origins;
 
         if (crop_marks_flag) {
                 print_crop_marks (pi);
@@ -191,6 +290,8 @@ gl_print_collated_merge_sheet   (glLabel          *label,
 		record = (glMergeRecord *)p->data;
 			
 		if ( record->select_flag ) {
+                        print_cache_prefetch (pi->cache, label, p);
+
 			for (i_copy = state->i_copy; i_copy < n_copies; i_copy++) {
 
 				print_label (pi, label,
@@ -202,7 +303,6 @@ gl_print_collated_merge_sheet   (glLabel          *label,
 				i_label++;
                                 if (i_label == n_labels_per_page)
                                 {
-                                        g_free (origins);
                                         print_info_free (&pi);
 
                                         state->i_copy = (i_copy+1) % n_copies;
@@ -221,7 +321,6 @@ gl_print_collated_merge_sheet   (glLabel          *label,
 		}
 	}
 
-        g_free (origins);
         print_info_free (&pi);
 
 	gl_debug (DEBUG_PRINT, "END");
@@ -245,22 +344,20 @@ gl_print_uncollated_merge_sheet (glLabel          *label,
 	glMerge                   *merge;
 	const GList               *record_list;
 	PrintInfo                 *pi;
-	const lglTemplateFrame    *frame;
 	gint                       i_label, n_labels_per_page, i_copy;
 	glMergeRecord             *record;
 	GList                     *p;
-	lglTemplateOrigin         *origins;
+	const lglTemplateOrigin   *origins;
 
 	gl_debug (DEBUG_PRINT, "START");
 
-	merge = gl_label_get_merge (label);
+	merge = print_state_get_merge (state, label);
 	record_list = gl_merge_get_record_list (merge);
 
-	pi = print_info_new (cr, label);
-        frame = (lglTemplateFrame *)pi->template->frames->data;
+	pi = print_info_new (cr, label, state);
 
-	n_labels_per_page = lgl_template_frame_get_n_labels (frame);
-	origins = lgl_template_frame_get_origins (frame);
+	n_labels_per_page = pi->cache->n_labels;
+	origins = pi->cache->origins;
 
         if (crop_marks_flag) {
                 print_crop_marks (pi);
@@ -285,6 +382,8 @@ gl_print_uncollated_merge_sheet (glLabel          *label,
 			
 			if ( record->select_flag ) {
 
+                                print_cache_prefetch (pi->cache, label, p);
+
                                 print_label (pi, label,
 					     origins[i_label].x,
 					     origins[i_label].y,
@@ -294,7 +393,6 @@ gl_print_uncollated_merge_sheet (glLabel          *label,
 				i_label++;
                                 if (i_label == n_labels_per_page)
                                 {
-                                        g_free (origins);
                                         print_info_free (&pi);
 
                                         state->p_record = p->next;
@@ -315,19 +413,296 @@ gl_print_uncollated_merge_sheet (glLabel          *label,
 
 	}
 
-	g_free (origins);
 	print_info_free (&pi);
 
 	gl_debug (DEBUG_PRINT, "END");
 }
 
 
+/*****************************************************************************/
+/* Print sheet of given records, one per label starting with label first.    */
+/*                                                                           */
+/* Unlike the merge sheet commands, the records need not come from the       */
+/* label's merge object, so a caller can stream records through one sheet    */
+/* at a time.                                                                */
+/*****************************************************************************/
+void
+gl_print_record_sheet (glLabel          *label,
+                       cairo_t          *cr,
+                       GList            *records,
+                       gint              first,
+                       gboolean          outline_flag,
+                       gboolean          reverse_flag,
+                       gboolean          crop_marks_flag,
+                       glPrintState     *state)
+{
+	PrintInfo                 *pi;
+	const lglTemplateOrigin   *origins;
+	gint                       i_label;
+	GList                     *p;
+
+	gl_debug (DEBUG_PRINT, "START");
+
+	pi = print_info_new (cr, label, state);
+
+	origins = pi->cache->origins;
+
+        if (crop_marks_flag) {
+                print_crop_marks (pi);
+        }
+
+        for ( p = records, i_label = first - 1;
+              (p != NULL) && (i_label < pi->cache->n_labels);
+              p = p->next, i_label++ )
+        {
+                print_label (pi, label,
+                             origins[i_label].x,
+                             origins[i_label].y,
+                             (glMergeRecord *)p->data,
+                             outline_flag, reverse_flag);
+        }
+
+        print_info_free (&pi);
+
+	gl_debug (DEBUG_PRINT, "END");
+}
+
+
+/*****************************************************************************/
+/* Print a single label at the origin, oriented as on the sheet.             */
+/*****************************************************************************/
+void
+gl_print_label (glLabel          *label,
+                cairo_t          *cr,
+                glMergeRecord    *record,
+                gboolean          outline_flag,
+                gboolean          reverse_flag,
+                glPrintState     *state)
+{
+	PrintInfo                 *pi;
+
+	gl_debug (DEBUG_PRINT, "START");
+
+	pi = print_info_new (cr, label, state);
+
+        print_label (pi, label, 0.0, 0.0, record, outline_flag, reverse_flag);
+
+        print_info_free (&pi);
+
+	gl_debug (DEBUG_PRINT, "END");
+}
+
+
+/*****************************************************************************/
+/* Initialize print state.                                                   */
+/*****************************************************************************/
+void
+gl_print_state_init (glPrintState     *state)
+{
+        state->i_copy   = 0;
+        state->p_record = NULL;
+        state->merge    = NULL;
+        state->cache    = NULL;
+}
+
+
+/*****************************************************************************/
+/* Clear print state, releasing anything cached during the print job.        */
+/*****************************************************************************/
+void
+gl_print_state_clear (glPrintState     *state)
+{
+        if ( state->cache != NULL )
+        {
+                print_cache_free (state->cache);
+                state->cache = NULL;
+        }
+
+        if ( state->merge != NULL )
+        {
+                g_object_unref (state->merge);
+                state->merge    = NULL;
+                state->p_record = NULL;
+        }
+}
+
+
+/*****************************************************************************/
+/* Set merge print state to the start of given sheet (0 based).              */
+/*                                                                           */
+/* The merge sheet renderers normally establish their state by printing      */
+/* every preceding sheet.  This computes the same state directly from the    */
+/* sheet schedule, so that a job can be started (or resumed) at any sheet.   */
+/* Returns the index of the first selected record printed on that sheet.     */
+/*****************************************************************************/
+gint
+gl_print_state_seek_sheet (glLabel          *label,
+                           glPrintState     *state,
+                           gint              sheet,
+                           gint              n_copies,
+                           gint              first,
+                           gboolean          collate_flag)
+{
+	glMerge                   *merge;
+	const lglTemplate         *template;
+	const lglTemplateFrame    *frame;
+	gint                       n_labels_per_page, n_records;
+	gint                       i_label, i_record;
+
+	gl_debug (DEBUG_PRINT, "START");
+
+	merge = print_state_get_merge (state, label);
+        template = gl_label_get_template (label);
+        frame = (lglTemplateFrame *)template->frames->data;
+
+	n_labels_per_page = lgl_template_frame_get_n_labels (frame);
+        n_records = gl_merge_get_record_count (merge);
+
+        if ( (sheet <= 0) || (n_copies < 1) || (n_records < 1) )
+        {
+                state->i_copy   = 0;
+                state->p_record = (GList *)gl_merge_get_record_list (merge);
+
+                gl_debug (DEBUG_PRINT, "END");
+                return 0;
+        }
+
+        /* Number of labels printed on all preceding sheets. */
+        i_label = sheet * n_labels_per_page - (first - 1);
+
+        if (collate_flag)
+        {
+                i_record      = i_label / n_copies;
+                state->i_copy = i_label % n_copies;
+        }
+        else
+        {
+                i_record      = i_label % n_records;
+                state->i_copy = i_label / n_records;
+                if (state->i_copy >= n_copies)
+                {
+                        /* Past end of job. */
+                        i_record = n_records;
+                }
+        }
+
+        state->p_record = (GList *)gl_merge_get_nth_record (merge, i_record);
+
+	gl_debug (DEBUG_PRINT, "END");
+
+        return i_record;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Record simple sheet.                                            */
+/*                                                                           */
+/* A single label (clipped, transformed and outlined) is recorded at the     */
+/* origin, then the sheet is recorded as crop marks plus a copy of that      */
+/* label at each origin.                                                     */
+/*---------------------------------------------------------------------------*/
+static cairo_pattern_t *
+record_simple_sheet (glLabel          *label,
+                     cairo_t          *cr,
+                     glPrintState     *state,
+                     gint              first,
+                     gint              last,
+                     gboolean          outline_flag,
+                     gboolean          reverse_flag,
+                     gboolean          crop_marks_flag)
+{
+	PrintInfo              *pi;
+	gint                    i_label;
+	const lglTemplateOrigin *origins;
+	cairo_pattern_t        *label_pattern;
+	cairo_pattern_t        *sheet_pattern;
+
+	gl_debug (DEBUG_PRINT, "START");
+
+	pi         = print_info_new (cr, label, state);
+
+	origins = pi->cache->origins;
+
+        /* Single label. */
+        pi->cr = recording_cr_new (cr);
+        print_label (pi, label, 0.0, 0.0, NULL, outline_flag, reverse_flag);
+        label_pattern = recording_cr_finish (pi->cr);
+
+        /* Complete sheet. */
+        pi->cr = recording_cr_new (cr);
+
+        if (crop_marks_flag) {
+                print_crop_marks (pi);
+        }
+
+        for (i_label = first - 1; i_label < last; i_label++) {
+
+                cairo_save (pi->cr);
+                cairo_translate (pi->cr, origins[i_label].x, origins[i_label].y);
+                cairo_set_source (pi->cr, label_pattern);
+                cairo_paint (pi->cr);
+                cairo_restore (pi->cr);
+
+        }
+
+        sheet_pattern = recording_cr_finish (pi->cr);
+
+        cairo_pattern_destroy (label_pattern);
+
+	print_info_free (&pi);
+
+	gl_debug (DEBUG_PRINT, "END");
+
+        return sheet_pattern;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Create context for recording content to be replayed into cr.   */
+/*---------------------------------------------------------------------------*/
+static cairo_t *
+recording_cr_new (cairo_t *cr)
+{
+        cairo_surface_t      *surface;
+        cairo_t              *recording_cr;
+        cairo_font_options_t *font_options;
+
+        surface      = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, NULL);
+        recording_cr = cairo_create (surface);
+        cairo_surface_destroy (surface);
+
+        /* Lay out text exactly as it would be if drawn directly into cr. */
+        font_options = cairo_font_options_create ();
+        cairo_get_font_options (cr, font_options);
+        cairo_set_font_options (recording_cr, font_options);
+        cairo_font_options_destroy (font_options);
+
+        return recording_cr;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Finish recording, returning recorded content as a pattern.      */
+/*---------------------------------------------------------------------------*/
+static cairo_pattern_t *
+recording_cr_finish (cairo_t *recording_cr)
+{
+        cairo_pattern_t *pattern;
+
+        pattern = cairo_pattern_create_for_surface (cairo_get_target (recording_cr));
+        cairo_destroy (recording_cr);
+
+        return pattern;
+}
+
+
 /*---------------------------------------------------------------------------*/
 /* PRIVATE.  new print info structure                                        */
 /*---------------------------------------------------------------------------*/
 static PrintInfo *
 print_info_new (cairo_t          *cr,
-		glLabel          *label)
+		glLabel          *label,
+		glPrintState     *state)
 {
 	PrintInfo            *pi = g_new0 (PrintInfo, 1);
         const lglTemplate    *template;
@@ -356,6 +731,9 @@ print_info_new (cairo_t          *cr,
 	pi->template = template;
 	pi->rotate_flag = rotate_flag;
 
+        pi->cache = print_cache_get (state);
+        print_cache_update_geometry (pi->cache, template);
+
 	gl_debug (DEBUG_PRINT, "END");
 
 	return pi;
@@ -531,7 +909,7 @@ print_label (PrintInfo     *pi,
 		cairo_scale (pi->cr, -1.0, 1.0);
 	}
 
-        gl_label_draw (label, pi->cr, FALSE, record);
+        draw_label_content (pi, label, record);
 
 	cairo_restore (pi->cr); /* From special transformations. */
 
@@ -547,6 +925,88 @@ print_label (PrintInfo     *pi,
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw label content.                                             */
+/*                                                                           */
+/* Without merge data this is just gl_label_draw().  Otherwise, static       */
+/* objects are painted from recordings made once for the job, so that only   */
+/* the field dependent objects are drawn for each record.  Records whose     */
+/* referenced field values repeat are painted from a recording of the first  */
+/* such label.                                                               */
+/*---------------------------------------------------------------------------*/
+static void
+draw_label_content (PrintInfo     *pi,
+                    glLabel       *label,
+                    glMergeRecord *record)
+{
+	cairo_pattern_t *pattern = NULL;
+
+	gl_debug (DEBUG_PRINT, "START");
+
+        if ( record == NULL )
+        {
+                gl_label_draw (label, pi->cr, FALSE, record);
+
+                gl_debug (DEBUG_PRINT, "END");
+                return;
+        }
+
+        if ( !pi->cache->layers_valid )
+        {
+                print_cache_build_layers (pi->cache, pi, label, record);
+        }
+
+        if ( pi->cache->field_keys != NULL )
+        {
+                pattern = print_cache_lookup_record (pi->cache, pi->cr, record);
+        }
+
+        if ( pattern != NULL )
+        {
+                cairo_save (pi->cr);
+                cairo_set_source (pi->cr, pattern);
+                cairo_paint (pi->cr);
+                cairo_restore (pi->cr);
+        }
+        else
+        {
+                draw_label_layers (pi->cache, pi->cr, record);
+        }
+
+	gl_debug (DEBUG_PRINT, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw cached label layers.                                       */
+/*---------------------------------------------------------------------------*/
+static void
+draw_label_layers (glPrintCache  *cache,
+                   cairo_t       *cr,
+                   glMergeRecord *record)
+{
+	GList          *p;
+	PrintLayer     *layer;
+
+        for ( p = cache->layers; p != NULL; p = p->next )
+        {
+                layer = (PrintLayer *)p->data;
+
+                if ( layer->pattern != NULL )
+                {
+                        cairo_save (cr);
+                        cairo_set_source (cr, layer->pattern);
+                        cairo_paint (cr);
+                        cairo_restore (cr);
+                }
+                else
+                {
+                        gl_label_object_draw (layer->object, cr, FALSE, record);
+                }
+        }
+}
+
+
 /*---------------------------------------------------------------------------*/
 /* PRIVATE.  Draw outline.                                                   */
 /*---------------------------------------------------------------------------*/
@@ -561,7 +1021,8 @@ draw_outline (PrintInfo *pi,
 	cairo_set_source_rgb (pi->cr, OUTLINE_RGB_ARGS);
 	cairo_set_line_width (pi->cr, OUTLINE_WIDTH);
 
-        gl_cairo_label_path (pi->cr, pi->template, FALSE, FALSE);
+        cairo_new_path (pi->cr);
+        cairo_append_path (pi->cr, pi->cache->outline_path);
 
         cairo_stroke (pi->cr);
 
@@ -580,7 +1041,8 @@ clip_to_outline (PrintInfo *pi,
 {
 	gl_debug (DEBUG_PRINT, "START");
 
-        gl_cairo_label_path (pi->cr, pi->template, FALSE, TRUE);
+        cairo_new_path (pi->cr);
+        cairo_append_path (pi->cr, pi->cache->clip_path);
 
         cairo_set_fill_rule (pi->cr, CAIRO_FILL_RULE_EVEN_ODD);
         cairo_clip (pi->cr);
@@ -589,6 +1051,340 @@ clip_to_outline (PrintInfo *pi,
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get cache of print state, creating it if needed.                */
+/*---------------------------------------------------------------------------*/
+static glPrintCache *
+print_cache_get (glPrintState *state)
+{
+        if ( state->cache == NULL )
+        {
+                state->cache = g_new0 (glPrintCache, 1);
+
+                state->cache->record_index = g_hash_table_new (g_str_hash, g_str_equal);
+                state->cache->record_lru   = g_queue_new ();
+        }
+
+        return state->cache;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get merge of print state, copying it from label if needed.      */
+/*                                                                           */
+/* The state keeps the copy, so that p_record stays valid from one sheet to  */
+/* the next, until the state is cleared.                                     */
+/*---------------------------------------------------------------------------*/
+static glMerge *
+print_state_get_merge (glPrintState *state,
+                       glLabel      *label)
+{
+        if ( state->merge == NULL )
+        {
+                state->merge = gl_label_get_merge (label);
+        }
+
+        return state->merge;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free print cache.                                               */
+/*---------------------------------------------------------------------------*/
+static void
+print_cache_free (glPrintCache *cache)
+{
+	GList          *p;
+	PrintLayer     *layer;
+
+	gl_debug (DEBUG_PRINT, "START");
+
+        gl_barcode_prefetch_free (cache->prefetch);
+
+        for ( p = cache->layers; p != NULL; p = p->next )
+        {
+                layer = (PrintLayer *)p->data;
+
+                if ( layer->pattern != NULL )
+                {
+                        cairo_pattern_destroy (layer->pattern);
+                }
+                if ( layer->object != NULL )
+                {
+                        g_object_unref (layer->object);
+                }
+                g_free (layer);
+        }
+        g_list_free (cache->layers);
+
+        gl_merge_free_key_list (&cache->field_keys);
+
+        g_hash_table_destroy (cache->record_index);
+        g_queue_foreach (cache->record_lru, (GFunc)print_record_entry_free, NULL);
+        g_queue_free (cache->record_lru);
+
+        if ( cache->sheet_pattern != NULL )
+        {
+                cairo_pattern_destroy (cache->sheet_pattern);
+        }
+
+        g_free (cache->origins);
+        if ( cache->outline_path != NULL )
+        {
+                cairo_path_destroy (cache->outline_path);
+        }
+        if ( cache->clip_path != NULL )
+        {
+                cairo_path_destroy (cache->clip_path);
+        }
+
+        g_free (cache);
+
+	gl_debug (DEBUG_PRINT, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Start encoding barcodes of records following p_record.          */
+/*---------------------------------------------------------------------------*/
+static void
+print_cache_prefetch (glPrintCache  *cache,
+                      glLabel       *label,
+                      GList         *p_record)
+{
+        if ( !cache->prefetch_valid )
+        {
+                cache->prefetch       = gl_barcode_prefetch_new (label);
+                cache->prefetch_valid = TRUE;
+        }
+
+        gl_barcode_prefetch_advance (cache->prefetch, p_record);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Update cached template geometry.                                */
+/*                                                                           */
+/* Label origins (sorted), label count, and the label outline and clip paths */
+/* are computed once per template rather than for every sheet and label.    */
+/* Paths are built relative to the label origin and appended to the target  */
+/* context after it has been translated to each label.                       */
+/*---------------------------------------------------------------------------*/
+static void
+print_cache_update_geometry (glPrintCache      *cache,
+                             const lglTemplate *template)
+{
+	const lglTemplateFrame *frame;
+        cairo_surface_t        *surface;
+        cairo_t                *cr;
+
+        if ( cache->template == template )
+        {
+                return;
+        }
+
+	gl_debug (DEBUG_PRINT, "START");
+
+        g_free (cache->origins);
+        if ( cache->outline_path != NULL )
+        {
+                cairo_path_destroy (cache->outline_path);
+        }
+        if ( cache->clip_path != NULL )
+        {
+                cairo_path_destroy (cache->clip_path);
+        }
+
+        frame = (lglTemplateFrame *)template->frames->data;
+
+        cache->template = template;
+        cache->n_labels = lgl_template_frame_get_n_labels (frame);
+        cache->origins  = lgl_template_frame_get_origins (frame);
+
+        surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, NULL);
+        cr      = cairo_create (surface);
+
+        gl_cairo_label_path (cr, template, FALSE, FALSE);
+        cache->outline_path = cairo_copy_path (cr);
+
+        cairo_new_path (cr);
+        gl_cairo_label_path (cr, template, FALSE, TRUE);
+        cache->clip_path = cairo_copy_path (cr);
+
+        cairo_destroy (cr);
+        cairo_surface_destroy (surface);
+
+	gl_debug (DEBUG_PRINT, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Split label objects into cached layers.                         */
+/*                                                                           */
+/* Each run of consecutive static objects is drawn once into a recording     */
+/* surface.  Field dependent objects become layers of their own, preserving  */
+/* stacking order.  The current record is only passed through so that static */
+/* text is laid out exactly as it would be when drawn directly.              */
+/*---------------------------------------------------------------------------*/
+static void
+print_cache_build_layers (glPrintCache  *cache,
+                          PrintInfo     *pi,
+                          glLabel       *label,
+                          glMergeRecord *record)
+{
+	const GList          *p;
+	glLabelObject        *object;
+	GList                *keys, *p_key;
+	PrintLayer           *layer;
+	cairo_t              *cr = NULL;
+
+	gl_debug (DEBUG_PRINT, "START");
+
+        for ( p = gl_label_get_object_list (label); p != NULL; p = p->next )
+        {
+                object = GL_LABEL_OBJECT (p->data);
+                keys   = gl_label_object_get_field_keys (object);
+
+                if ( keys == NULL )
+                {
+                        if ( cr == NULL )
+                        {
+                                /* Start a new static run. */
+                                cr = recording_cr_new (pi->cr);
+                        }
+
+                        gl_label_object_draw (object, cr, FALSE, record);
+                }
+                else
+                {
+                        if ( cr != NULL )
+                        {
+                                /* End current static run. */
+                                layer = g_new0 (PrintLayer, 1);
+                                layer->pattern = recording_cr_finish (cr);
+                                cache->layers = g_list_append (cache->layers, layer);
+                                cr = NULL;
+                        }
+
+                        layer = g_new0 (PrintLayer, 1);
+                        layer->object = g_object_ref (object);
+                        cache->layers = g_list_append (cache->layers, layer);
+
+                        for ( p_key = keys; p_key != NULL; p_key = p_key->next )
+                        {
+                                if ( !g_list_find_custom (cache->field_keys, p_key->data, (GCompareFunc)strcmp) )
+                                {
+                                        cache->field_keys = g_list_append (cache->field_keys,
+                                                                           g_strdup (p_key->data));
+                                }
+                        }
+                        gl_merge_free_key_list (&keys);
+                }
+        }
+
+        if ( cr != NULL )
+        {
+                layer = g_new0 (PrintLayer, 1);
+                layer->pattern = recording_cr_finish (cr);
+                cache->layers = g_list_append (cache->layers, layer);
+        }
+
+        cache->layers_valid = TRUE;
+
+	gl_debug (DEBUG_PRINT, "END");
+}
+
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Look up record content in cache.                                */
+/*                                                                           */
+/* Records are identified by the values of the fields the label references. */
+/* Returns a recording of the label content to paint, or NULL if the content */
+/* has not been seen before and should be drawn directly.                    */
+/*---------------------------------------------------------------------------*/
+static cairo_pattern_t *
+print_cache_lookup_record (glPrintCache  *cache,
+                           cairo_t       *cr,
+                           glMergeRecord *record)
+{
+	GString          *str;
+	gchar            *key, *value;
+	GList            *p, *link;
+	PrintRecordEntry *entry;
+	cairo_t          *recording_cr;
+
+        /* Build key from referenced field values, length prefixed to keep it unambiguous. */
+        str = g_string_new ("");
+        for ( p = cache->field_keys; p != NULL; p = p->next )
+        {
+                value = gl_merge_eval_key (record, (gchar *)p->data);
+                if ( value != NULL )
+                {
+                        g_string_append_printf (str, "%" G_GSIZE_FORMAT ":%s", strlen (value), value);
+                        g_free (value);
+                }
+                else
+                {
+                        g_string_append_c (str, '-');
+                }
+        }
+        key = g_string_free (str, FALSE);
+
+        link = g_hash_table_lookup (cache->record_index, key);
+        if ( link != NULL )
+        {
+                g_free (key);
+
+                /* Move to front of LRU queue. */
+                g_queue_unlink (cache->record_lru, link);
+                g_queue_push_head_link (cache->record_lru, link);
+
+                entry = (PrintRecordEntry *)link->data;
+                if ( entry->pattern == NULL )
+                {
+                        /* Content repeats: record it for this and later labels. */
+                        recording_cr = recording_cr_new (cr);
+                        draw_label_layers (cache, recording_cr, record);
+                        entry->pattern = recording_cr_finish (recording_cr);
+                }
+
+                return entry->pattern;
+        }
+
+        /* First occurrence, just remember it. */
+        if ( g_queue_get_length (cache->record_lru) >= RECORD_CACHE_SIZE )
+        {
+                entry = (PrintRecordEntry *)g_queue_pop_tail (cache->record_lru);
+                g_hash_table_remove (cache->record_index, entry->key);
+                print_record_entry_free (entry);
+        }
+
+        entry = g_new0 (PrintRecordEntry, 1);
+        entry->key = key;
+
+        g_queue_push_head (cache->record_lru, entry);
+        g_hash_table_insert (cache->record_index, entry->key, cache->record_lru->head);
+
+        return NULL;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free record cache entry.                                        */
+/*---------------------------------------------------------------------------*/
+static void
+print_record_entry_free (PrintRecordEntry *entry)
+{
+        if ( entry->pattern != NULL )
+        {
+                cairo_pattern_destroy (entry->pattern);
+        }
+        g_free (entry->key);
+        g_free (entry);
+}
+
 
 
 
@@ -27,11 +27,20 @@
 
 G_BEGIN_DECLS
 
+typedef struct _glPrintCache glPrintCache;
+
 typedef struct {
-	gint   i_copy;
-	GList *p_record;
+	gint          i_copy;
+	GList        *p_record;
+        glMerge      *merge;      /* Copy of label merge, owns p_record. */
+
+        glPrintCache *cache;
 } glPrintState;
 
+void gl_print_state_init             (glPrintState     *state);
+
+void gl_print_state_clear            (glPrintState     *state);
+
 void gl_print_simple_sheet           (glLabel          *label,
 				      cairo_t          *cr,
 				      gint              page,
@@ -40,7 +49,8 @@ void gl_print_simple_sheet           (glLabel          *label,
 				      gint              last,
 				      gboolean          outline_flag,
 				      gboolean          reverse_flag,
-				      gboolean          crop_marks_flag);
+				      gboolean          crop_marks_flag,
+				      glPrintState     *state);
 
 void gl_print_collated_merge_sheet   (glLabel          *label,
 				      cairo_t          *cr,
@@ -62,6 +72,29 @@ void gl_print_uncollated_merge_sheet (glLabel          *label,
 				      gboolean          crop_marks_flag,
 				      glPrintState     *state);
 
+void gl_print_record_sheet           (glLabel          *label,
+				      cairo_t          *cr,
+				      GList            *records,
+				      gint              first,
+				      gboolean          outline_flag,
+				      gboolean          reverse_flag,
+				      gboolean          crop_marks_flag,
+				      glPrintState     *state);
+
+void gl_print_label                  (glLabel          *label,
+				      cairo_t          *cr,
+				      glMergeRecord    *record,
+				      gboolean          outline_flag,
+				      gboolean          reverse_flag,
+				      glPrintState     *state);
+
+gint gl_print_state_seek_sheet       (glLabel          *label,
+				      glPrintState     *state,
+				      gint              sheet,
+				      gint              n_copies,
+				      gint              first,
+				      gboolean          collate_flag);
+
 G_END_DECLS
 
 #endif
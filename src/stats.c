@@ -0,0 +1,626 @@
+/*
+ *  stats.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Process-wide timing and throughput statistics, for glabels-3-batch
+ * --stats.  Collection is off unless gl_stats_enable() has been called, so
+ * the hooks in the drawing code cost a single test otherwise.
+ *
+ * A forked worker starts from zero with gl_stats_reset(), and hands its
+ * counts back to the parent with gl_stats_write(), to be added in with
+ * gl_stats_read().  Phase and object times are then summed over workers.
+ *
+ * Phase and object CPU times are those of the thread taking the
+ * measurement, so time spent meanwhile in other threads (barcode prefetch,
+ * the raster encoder) is not counted against them.  Only the overall total
+ * is process-wide.
+ */
+
+#include <config.h>
+
+#include "stats.h"
+
+#include <glib/gi18n.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "label-text.h"
+#include "label-box.h"
+#include "label-line.h"
+#include "label-ellipse.h"
+#include "label-image.h"
+#include "label-barcode.h"
+#include "bc.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define MAX_OBJECT_TYPES  8
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        gint              count;
+        gdouble           wall;
+        gdouble           cpu;
+} StatsTotal;
+
+typedef struct {
+        GType             type;
+        StatsTotal        total;
+} StatsObject;
+
+/* Counts of a worker, as written to its parent. */
+typedef struct {
+        StatsTotal        phases[GL_STATS_N_PHASES];
+        StatsObject       objects[MAX_OBJECT_TYPES];
+        gint              n_object_types;
+        gint              n_sheets;
+        gint              n_labels;
+        goffset           n_merge_bytes;
+        guint             bc_hits;
+        guint             bc_misses;
+} StatsReport;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static gboolean     enabled = FALSE;
+static GTimer      *timer   = NULL;
+
+static StatsTotal   phases[GL_STATS_N_PHASES];
+static StatsObject  objects[MAX_OBJECT_TYPES];
+static gint         n_object_types = 0;
+
+static gint         n_sheets_total = 0;
+static gint         n_labels_total = 0;
+static goffset      n_merge_bytes  = 0;
+
+/* Barcode cache counts are kept by bc.c: these are relative to the reset. */
+static guint        bc_hits_base   = 0;
+static guint        bc_misses_base = 0;
+static guint        bc_hits_more   = 0;
+static guint        bc_misses_more = 0;
+
+static const gchar *phase_names[GL_STATS_N_PHASES] = {
+        "load",
+        "merge",
+        "text-layout",
+        "barcode-encode",
+        "image-decode",
+        "output",
+};
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void         add_total        (StatsTotal  *total,
+                                      glStatsMark *mark);
+
+static StatsTotal  *object_total     (GType        type);
+
+static void         merge_total      (StatsTotal  *total,
+                                      StatsTotal  *more);
+
+static void         barcode_stats    (guint       *hits,
+                                      guint       *misses);
+
+static const gchar *object_name      (GType        type);
+
+static glong        peak_rss_kb      (void);
+
+static gdouble      thread_cpu       (void);
+
+static gdouble      children_cpu     (void);
+
+static gdouble      objects_wall     (void);
+
+
+/*****************************************************************************/
+/* Start collecting statistics.                                              */
+/*****************************************************************************/
+void
+gl_stats_enable (void)
+{
+        if ( !enabled )
+        {
+                timer   = g_timer_new ();
+                enabled = TRUE;
+        }
+}
+
+
+/*****************************************************************************/
+/* Are statistics being collected?                                           */
+/*****************************************************************************/
+gboolean
+gl_stats_enabled (void)
+{
+        return enabled;
+}
+
+
+/*****************************************************************************/
+/* Note start time of a measurement.                                         */
+/*****************************************************************************/
+void
+gl_stats_mark (glStatsMark *mark)
+{
+        if ( enabled )
+        {
+                mark->wall = g_timer_elapsed (timer, NULL);
+                mark->cpu  = thread_cpu ();
+        }
+}
+
+
+/*****************************************************************************/
+/* Add time since mark to phase.                                             */
+/*****************************************************************************/
+void
+gl_stats_add_phase (glStatsPhase  phase,
+                    glStatsMark  *mark)
+{
+        if ( enabled )
+        {
+                add_total (&phases[phase], mark);
+        }
+}
+
+
+/*****************************************************************************/
+/* Add time since mark to drawing of objects of given type.                  */
+/*****************************************************************************/
+void
+gl_stats_add_object (GType        type,
+                     glStatsMark *mark)
+{
+        StatsTotal *total;
+
+        if ( !enabled )
+        {
+                return;
+        }
+
+        total = object_total (type);
+        if ( total != NULL )
+        {
+                add_total (total, mark);
+        }
+}
+
+
+/*****************************************************************************/
+/* Count sheets (or roll labels) and labels written.                         */
+/*****************************************************************************/
+void
+gl_stats_add_output (gint n_sheets,
+                     gint n_labels)
+{
+        if ( enabled )
+        {
+                n_sheets_total += n_sheets;
+                n_labels_total += n_labels;
+        }
+}
+
+
+/*****************************************************************************/
+/* Count bytes of merge data read.                                           */
+/*****************************************************************************/
+void
+gl_stats_add_merge_bytes (goffset n_bytes)
+{
+        if ( enabled )
+        {
+                n_merge_bytes += n_bytes;
+        }
+}
+
+
+/*****************************************************************************/
+/* Start counting from zero, in a newly forked worker.                       */
+/*****************************************************************************/
+void
+gl_stats_reset (void)
+{
+        memset (phases, 0, sizeof (phases));
+        memset (objects, 0, sizeof (objects));
+        n_object_types = 0;
+
+        n_sheets_total = 0;
+        n_labels_total = 0;
+        n_merge_bytes  = 0;
+
+        gl_barcode_cache_get_stats (&bc_hits_base, &bc_misses_base);
+        bc_hits_more   = 0;
+        bc_misses_more = 0;
+}
+
+
+/*****************************************************************************/
+/* Write counts to fd, for gl_stats_read() in parent process.                */
+/*                                                                           */
+/* The report is far smaller than a pipe's buffer, so this does not wait     */
+/* for the parent to read it.                                                */
+/*****************************************************************************/
+void
+gl_stats_write (gint fd)
+{
+        StatsReport  report;
+        const gchar *p;
+        gsize        n_left;
+        gssize       n;
+
+        memset (&report, 0, sizeof (report));
+        memcpy (report.phases, phases, sizeof (phases));
+        memcpy (report.objects, objects, sizeof (objects));
+        report.n_object_types = n_object_types;
+        report.n_sheets       = n_sheets_total;
+        report.n_labels       = n_labels_total;
+        report.n_merge_bytes  = n_merge_bytes;
+        barcode_stats (&report.bc_hits, &report.bc_misses);
+
+        p      = (const gchar *)&report;
+        n_left = sizeof (report);
+        while ( n_left > 0 )
+        {
+                n = write (fd, p, n_left);
+                if ( n < 0 )
+                {
+                        if ( errno == EINTR )
+                        {
+                                continue;
+                        }
+                        return;
+                }
+                p      += n;
+                n_left -= n;
+        }
+}
+
+
+/*****************************************************************************/
+/* Read counts of a worker from fd, and add them to ours.                    */
+/*****************************************************************************/
+void
+gl_stats_read (gint fd)
+{
+        StatsReport  report;
+        gchar       *p;
+        gsize        n_left;
+        gssize       n;
+        StatsTotal  *total;
+        gint         i;
+
+        p      = (gchar *)&report;
+        n_left = sizeof (report);
+        while ( n_left > 0 )
+        {
+                n = read (fd, p, n_left);
+                if ( n < 0 )
+                {
+                        if ( errno == EINTR )
+                        {
+                                continue;
+                        }
+                        return;
+                }
+                if ( n == 0 )
+                {
+                        /* Worker died before reporting. */
+                        return;
+                }
+                p      += n;
+                n_left -= n;
+        }
+
+        for ( i = 0; i < GL_STATS_N_PHASES; i++ )
+        {
+                merge_total (&phases[i], &report.phases[i]);
+        }
+
+        for ( i = 0; i < MIN (report.n_object_types, MAX_OBJECT_TYPES); i++ )
+        {
+                total = object_total (report.objects[i].type);
+                if ( total != NULL )
+                {
+                        merge_total (total, &report.objects[i].total);
+                }
+        }
+
+        n_sheets_total += report.n_sheets;
+        n_labels_total += report.n_labels;
+        n_merge_bytes  += report.n_merge_bytes;
+        bc_hits_more   += report.bc_hits;
+        bc_misses_more += report.bc_misses;
+}
+
+
+/*****************************************************************************/
+/* Print human readable report.                                              */
+/*****************************************************************************/
+void
+gl_stats_print (FILE *fp)
+{
+        gdouble wall, cpu;
+        gint    i;
+        guint   bc_hits, bc_misses;
+
+        wall = g_timer_elapsed (timer, NULL);
+        cpu  = (gdouble)clock () / CLOCKS_PER_SEC + children_cpu ();
+
+        fprintf ( fp, _("Total: %.3f s wall, %.3f s CPU, peak RSS %ld kB\n"),
+                  wall, cpu, peak_rss_kb () );
+        fprintf ( fp, _("Output: %d sheets (%.1f/s), %d labels (%.1f/s), %" G_GINT64_FORMAT " bytes of merge data\n"),
+                  n_sheets_total, (wall > 0.0) ? n_sheets_total / wall : 0.0,
+                  n_labels_total, (wall > 0.0) ? n_labels_total / wall : 0.0,
+                  (gint64)n_merge_bytes );
+
+        barcode_stats (&bc_hits, &bc_misses);
+        fprintf ( fp, _("Barcode cache: %u hits, %u misses\n"), bc_hits, bc_misses );
+
+        fprintf ( fp, _("Phase              Count    Wall (s)     CPU (s)\n") );
+        for ( i = 0; i < GL_STATS_N_PHASES; i++ )
+        {
+                fprintf ( fp, "%-16s %7d %11.3f %11.3f\n",
+                          phase_names[i], phases[i].count, phases[i].wall, phases[i].cpu );
+        }
+
+        fprintf ( fp, _("Object drawn       Count    Wall (s)     CPU (s)\n") );
+        for ( i = 0; i < n_object_types; i++ )
+        {
+                fprintf ( fp, "%-16s %7d %11.3f %11.3f\n",
+                          object_name (objects[i].type), objects[i].total.count,
+                          objects[i].total.wall, objects[i].total.cpu );
+        }
+        fprintf ( fp, _("Output not spent drawing objects: %.3f s\n"),
+                  MAX (0.0, phases[GL_STATS_PHASE_OUTPUT].wall - objects_wall ()) );
+}
+
+
+/*****************************************************************************/
+/* Print report as a JSON object.                                            */
+/*****************************************************************************/
+void
+gl_stats_print_json (FILE *fp)
+{
+        gdouble wall, cpu;
+        gint    i;
+        guint   bc_hits, bc_misses;
+
+        wall = g_timer_elapsed (timer, NULL);
+        cpu  = (gdouble)clock () / CLOCKS_PER_SEC + children_cpu ();
+
+        fprintf ( fp, "{\"wall-time\": %.6f, \"cpu-time\": %.6f, \"peak-rss-kb\": %ld,\n",
+                  wall, cpu, peak_rss_kb () );
+        fprintf ( fp, " \"sheets\": %d, \"sheets-per-second\": %.3f,\n",
+                  n_sheets_total, (wall > 0.0) ? n_sheets_total / wall : 0.0 );
+        fprintf ( fp, " \"labels\": %d, \"labels-per-second\": %.3f,\n",
+                  n_labels_total, (wall > 0.0) ? n_labels_total / wall : 0.0 );
+        fprintf ( fp, " \"merge-bytes\": %" G_GINT64_FORMAT ",\n", (gint64)n_merge_bytes );
+
+        barcode_stats (&bc_hits, &bc_misses);
+        fprintf ( fp, " \"barcode-cache-hits\": %u, \"barcode-cache-misses\": %u,\n",
+                  bc_hits, bc_misses );
+
+        fprintf ( fp, " \"phases\": {" );
+        for ( i = 0; i < GL_STATS_N_PHASES; i++ )
+        {
+                fprintf ( fp, "%s\n  \"%s\": {\"count\": %d, \"wall-time\": %.6f, \"cpu-time\": %.6f}",
+                          (i > 0) ? "," : "", phase_names[i],
+                          phases[i].count, phases[i].wall, phases[i].cpu );
+        }
+        fprintf ( fp, "},\n" );
+
+        fprintf ( fp, " \"objects\": {" );
+        for ( i = 0; i < n_object_types; i++ )
+        {
+                fprintf ( fp, "%s\n  \"%s\": {\"count\": %d, \"wall-time\": %.6f, \"cpu-time\": %.6f}",
+                          (i > 0) ? "," : "", object_name (objects[i].type),
+                          objects[i].total.count, objects[i].total.wall, objects[i].total.cpu );
+        }
+        fprintf ( fp, "}}\n" );
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add time since mark to total.                                   */
+/*---------------------------------------------------------------------------*/
+static void
+add_total (StatsTotal  *total,
+           glStatsMark *mark)
+{
+        total->count++;
+        total->wall += g_timer_elapsed (timer, NULL) - mark->wall;
+        total->cpu  += thread_cpu () - mark->cpu;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Total of objects of given type, or NULL if out of room.         */
+/*---------------------------------------------------------------------------*/
+static StatsTotal *
+object_total (GType type)
+{
+        gint i;
+
+        for ( i = 0; i < n_object_types; i++ )
+        {
+                if ( objects[i].type == type )
+                {
+                        return &objects[i].total;
+                }
+        }
+
+        if ( n_object_types == MAX_OBJECT_TYPES )
+        {
+                return NULL;
+        }
+        objects[i].type = type;
+        n_object_types++;
+
+        return &objects[i].total;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add total of a worker to ours.                                  */
+/*---------------------------------------------------------------------------*/
+static void
+merge_total (StatsTotal *total,
+             StatsTotal *more)
+{
+        total->count += more->count;
+        total->wall  += more->wall;
+        total->cpu   += more->cpu;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Barcode cache hits and misses, since reset and of workers.      */
+/*---------------------------------------------------------------------------*/
+static void
+barcode_stats (guint *hits,
+               guint *misses)
+{
+        gl_barcode_cache_get_stats (hits, misses);
+
+        *hits   = *hits   - bc_hits_base   + bc_hits_more;
+        *misses = *misses - bc_misses_base + bc_misses_more;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Short name of object type.                                      */
+/*---------------------------------------------------------------------------*/
+static const gchar *
+object_name (GType type)
+{
+        if ( type == GL_TYPE_LABEL_TEXT )    return "text";
+        if ( type == GL_TYPE_LABEL_BARCODE ) return "barcode";
+        if ( type == GL_TYPE_LABEL_IMAGE )   return "image";
+        if ( type == GL_TYPE_LABEL_BOX )     return "box";
+        if ( type == GL_TYPE_LABEL_ELLIPSE ) return "ellipse";
+        if ( type == GL_TYPE_LABEL_LINE )    return "line";
+
+        return g_type_name (type);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Peak resident set size of process, or of its largest worker.    */
+/*---------------------------------------------------------------------------*/
+static glong
+peak_rss_kb (void)
+{
+        struct rusage usage;
+        glong         rss = 0;
+
+        if ( getrusage (RUSAGE_SELF, &usage) == 0 )
+        {
+                rss = usage.ru_maxrss;
+        }
+        if ( getrusage (RUSAGE_CHILDREN, &usage) == 0 )
+        {
+                rss = MAX (rss, usage.ru_maxrss);
+        }
+
+        return rss;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  CPU time of calling thread.                                     */
+/*---------------------------------------------------------------------------*/
+static gdouble
+thread_cpu (void)
+{
+        struct timespec ts;
+
+        if ( clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) != 0 )
+        {
+                return 0.0;
+        }
+
+        return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  CPU time of finished workers.                                   */
+/*---------------------------------------------------------------------------*/
+static gdouble
+children_cpu (void)
+{
+        struct rusage usage;
+
+        if ( getrusage (RUSAGE_CHILDREN, &usage) != 0 )
+        {
+                return 0.0;
+        }
+
+        return   usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1.0e6
+               + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1.0e6;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Total time spent drawing objects.                               */
+/*---------------------------------------------------------------------------*/
+static gdouble
+objects_wall (void)
+{
+        gdouble wall = 0.0;
+        gint    i;
+
+        for ( i = 0; i < n_object_types; i++ )
+        {
+                wall += objects[i].total.wall;
+        }
+
+        return wall;
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -0,0 +1,89 @@
+/*
+ *  stats.h
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <glib-object.h>
+#include <stdio.h>
+
+G_BEGIN_DECLS
+
+
+typedef enum {
+        GL_STATS_PHASE_LOAD,
+        GL_STATS_PHASE_MERGE,
+        GL_STATS_PHASE_TEXT_LAYOUT,
+        GL_STATS_PHASE_BARCODE_ENCODE,
+        GL_STATS_PHASE_IMAGE_DECODE,
+        GL_STATS_PHASE_OUTPUT,
+
+        GL_STATS_N_PHASES
+} glStatsPhase;
+
+
+typedef struct {
+        gdouble           wall;
+        gdouble           cpu;          /* CPU time of calling thread. */
+} glStatsMark;
+
+
+void      gl_stats_enable           (void);
+
+gboolean  gl_stats_enabled          (void);
+
+void      gl_stats_mark             (glStatsMark   *mark);
+
+void      gl_stats_add_phase        (glStatsPhase   phase,
+                                     glStatsMark   *mark);
+
+void      gl_stats_add_object       (GType          type,
+                                     glStatsMark   *mark);
+
+void      gl_stats_add_output       (gint           n_sheets,
+                                     gint           n_labels);
+
+void      gl_stats_add_merge_bytes  (goffset        n_bytes);
+
+void      gl_stats_reset            (void);
+
+void      gl_stats_write            (gint           fd);
+
+void      gl_stats_read             (gint           fd);
+
+void      gl_stats_print            (FILE          *fp);
+
+void      gl_stats_print_json       (FILE          *fp);
+
+
+G_END_DECLS
+
+#endif /* __STATS_H__ */
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -0,0 +1,745 @@
+/*
+ *  zpl.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * ZPL II output.  Each label becomes one ^XA ... ^XZ format.  Objects are
+ * translated to native ZPL fields where ZPL has an equivalent: text to ^A0
+ * fields, boxes and lines to ^GB/^GD, ellipses to ^GE and common barcodes
+ * to their own commands.  Everything else (images, other symbologies,
+ * objects at odd angles) is drawn and sent as a ^GF graphic.
+ */
+
+#include <config.h>
+
+#include "zpl.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <cairo.h>
+
+#include "label-text.h"
+#include "label-box.h"
+#include "label-line.h"
+#include "label-ellipse.h"
+#include "label-image.h"
+#include "label-barcode.h"
+#include "text-node.h"
+#include "color.h"
+#include "bc.h"
+
+#include "debug.h"
+
+
+/*===========================================*/
+/* Private types.                            */
+/*===========================================*/
+
+typedef enum {
+        ZPL_BC_CODE128,
+        ZPL_BC_CODE39,
+        ZPL_BC_CODE93,
+        ZPL_BC_EAN13,
+        ZPL_BC_EAN8,
+        ZPL_BC_UPCA,
+        ZPL_BC_UPCE,
+        ZPL_BC_I25,
+        ZPL_BC_POSTNET,
+        ZPL_BC_QR,
+        ZPL_BC_DATAMATRIX,
+} ZplBarcodeType;
+
+typedef struct {
+        const gchar    *id;
+        ZplBarcodeType  type;
+} ZplBarcode;
+
+typedef struct {
+        GString        *zpl;
+        gdouble         scale;         /* Dots per point. */
+        glMergeRecord  *record;
+} ZplInfo;
+
+
+/*===========================================*/
+/* Private globals.                          */
+/*===========================================*/
+
+/* Barcode styles with a native ZPL command (ids of both bc.c backends). */
+static const ZplBarcode zpl_barcodes[] = {
+        { "Code128",    ZPL_BC_CODE128 },
+        { "Code128B",   ZPL_BC_CODE128 },
+        { "Code128C",   ZPL_BC_CODE128 },
+        { "Code39",     ZPL_BC_CODE39 },
+        { "Code93",     ZPL_BC_CODE93 },
+        { "EAN-13",     ZPL_BC_EAN13 },
+        { "EAN-8",      ZPL_BC_EAN8 },
+        { "UPC-A",      ZPL_BC_UPCA },
+        { "UPC-E",      ZPL_BC_UPCE },
+        { "I25",        ZPL_BC_I25 },
+        { "POSTNET",    ZPL_BC_POSTNET },
+        { "POSTNET-5",  ZPL_BC_POSTNET },
+        { "POSTNET-9",  ZPL_BC_POSTNET },
+        { "POSTNET-11", ZPL_BC_POSTNET },
+        { "QR",         ZPL_BC_QR },
+        { "IEC18004",   ZPL_BC_QR },
+        { "DMTX",       ZPL_BC_DATAMATRIX },
+        { "IEC16022",   ZPL_BC_DATAMATRIX },
+        { NULL }
+};
+
+
+/*===========================================*/
+/* Private function prototypes.              */
+/*===========================================*/
+
+static gint      dots                (ZplInfo          *zi,
+                                      gdouble           points);
+
+static gboolean  get_orientation     (glLabelObject    *object,
+                                      gchar            *orientation);
+
+static gchar     color_to_zpl        (guint             color);
+
+static void      append_field_data   (GString          *zpl,
+                                      const gchar      *text);
+
+static void      zpl_text            (ZplInfo          *zi,
+                                      glLabelObject    *object,
+                                      gchar             orientation);
+
+static void      zpl_box             (ZplInfo          *zi,
+                                      glLabelObject    *object,
+                                      gboolean          ellipse_flag);
+
+static void      zpl_line            (ZplInfo          *zi,
+                                      glLabelObject    *object);
+
+static gboolean  zpl_barcode         (ZplInfo          *zi,
+                                      glLabelObject    *object,
+                                      gchar             orientation);
+
+static void      zpl_graphic         (ZplInfo          *zi,
+                                      glLabelObject    *object);
+
+
+/*****************************************************************************/
+/* Append ZPL format for one label to string.                                */
+/*****************************************************************************/
+void
+gl_zpl_label (glLabel          *label,
+              GString          *zpl,
+              glMergeRecord    *record,
+              gdouble           dpi,
+              gint              quantity,
+              gboolean          outline_flag,
+              gboolean          reverse_flag)
+{
+        ZplInfo        zi;
+        const GList   *p;
+        glLabelObject *object;
+        gdouble        w, h;
+        gchar          orientation;
+
+	gl_debug (DEBUG_PRINT, "START");
+
+        zi.zpl    = zpl;
+        zi.scale  = dpi / 72.0;
+        zi.record = record;
+
+        gl_label_get_size (label, &w, &h);
+
+        g_string_append (zpl, "^XA\n");
+        g_string_append (zpl, "^CI28\n");
+        g_string_append_printf (zpl, "^PW%d\n^LL%d\n^LH0,0\n", dots (&zi, w), dots (&zi, h));
+        if ( reverse_flag )
+        {
+                g_string_append (zpl, "^PMY\n");
+        }
+
+        for ( p = gl_label_get_object_list (label); p != NULL; p = p->next )
+        {
+                object = GL_LABEL_OBJECT (p->data);
+
+                if ( !get_orientation (object, &orientation) )
+                {
+                        zpl_graphic (&zi, object);
+                }
+                else if ( GL_IS_LABEL_TEXT (object) )
+                {
+                        zpl_text (&zi, object, orientation);
+                }
+                else if ( GL_IS_LABEL_BOX (object) )
+                {
+                        zpl_box (&zi, object, FALSE);
+                }
+                else if ( GL_IS_LABEL_ELLIPSE (object) )
+                {
+                        zpl_box (&zi, object, TRUE);
+                }
+                else if ( GL_IS_LABEL_LINE (object) )
+                {
+                        zpl_line (&zi, object);
+                }
+                else if ( !GL_IS_LABEL_BARCODE (object) || !zpl_barcode (&zi, object, orientation) )
+                {
+                        zpl_graphic (&zi, object);
+                }
+        }
+
+        if ( outline_flag )
+        {
+                g_string_append_printf (zpl, "^FO0,0^GB%d,%d,1,B,0^FS\n", dots (&zi, w), dots (&zi, h));
+        }
+
+        if ( quantity > 1 )
+        {
+                g_string_append_printf (zpl, "^PQ%d\n", quantity);
+        }
+        g_string_append (zpl, "^XZ\n");
+
+	gl_debug (DEBUG_PRINT, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Convert points to printer dots.                                 */
+/*---------------------------------------------------------------------------*/
+static gint
+dots (ZplInfo *zi,
+      gdouble  points)
+{
+        return (gint) floor (points * zi->scale + 0.5);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get ZPL field orientation of object.  Returns FALSE if object   */
+/* is not at a multiple of 90 degrees (or is skewed), so has no native form. */
+/*---------------------------------------------------------------------------*/
+static gboolean
+get_orientation (glLabelObject *object,
+                 gchar         *orientation)
+{
+        cairo_matrix_t matrix;
+        gdouble        angle;
+        gint           quadrant;
+
+        gl_label_object_get_matrix (object, &matrix);
+
+        angle    = atan2 (matrix.yx, matrix.xx) * 180.0 / G_PI;
+        quadrant = (gint) floor (angle / 90.0 + 0.5);
+
+        if ( fabs (angle - 90.0 * quadrant) > 0.5 )
+        {
+                return FALSE;
+        }
+        if ( fabs (matrix.xx * matrix.xy + matrix.yx * matrix.yy) > 1.0e-6 )
+        {
+                return FALSE;
+        }
+
+        switch ( (quadrant + 4) % 4 )
+        {
+        case 1:
+                *orientation = 'R';
+                break;
+        case 2:
+                *orientation = 'I';
+                break;
+        case 3:
+                *orientation = 'B';
+                break;
+        default:
+                *orientation = 'N';
+                break;
+        }
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Map color to ZPL black ('B') or white ('W').                    */
+/*---------------------------------------------------------------------------*/
+static gchar
+color_to_zpl (guint color)
+{
+        gdouble luminance;
+
+        luminance = 0.299 * GL_COLOR_F_RED (color)
+                + 0.587 * GL_COLOR_F_GREEN (color)
+                + 0.114 * GL_COLOR_F_BLUE (color);
+
+        return (luminance > 0.5) ? 'W' : 'B';
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Append ^FD data, hex escaping ZPL command characters (^FH).     */
+/*---------------------------------------------------------------------------*/
+static void
+append_field_data (GString     *zpl,
+                   const gchar *text)
+{
+        const gchar *p;
+
+        g_string_append (zpl, "^FH^FD");
+        for ( p = text; *p != '\0'; p++ )
+        {
+                switch (*p)
+                {
+                case '^':
+                case '~':
+                case '_':
+                case '\\':
+                        g_string_append_printf (zpl, "_%02X", (guchar)*p);
+                        break;
+                case '\n':
+                        /* ^FB line break. */
+                        g_string_append (zpl, "\\&");
+                        break;
+                default:
+                        g_string_append_c (zpl, *p);
+                        break;
+                }
+        }
+        g_string_append (zpl, "^FS\n");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Text object as scalable font field block.                       */
+/*---------------------------------------------------------------------------*/
+static void
+zpl_text (ZplInfo       *zi,
+          glLabelObject *object,
+          gchar          orientation)
+{
+        GList         *lines;
+        gchar         *text;
+        const gchar   *p;
+        glLabelRegion  extent;
+        gdouble        w, h;
+        gint           font_dots, n_lines;
+        gchar          justification;
+
+        lines = gl_label_text_get_lines (GL_LABEL_TEXT (object));
+        text  = gl_text_node_lines_expand (lines, zi->record);
+        gl_text_node_lines_free (&lines);
+
+        if ( (text == NULL) || (*text == '\0') )
+        {
+                g_free (text);
+                return;
+        }
+
+        n_lines = 1;
+        for ( p = text; *p != '\0'; p++ )
+        {
+                if ( *p == '\n' )
+                {
+                        n_lines++;
+                }
+        }
+
+        switch ( gl_label_object_get_text_alignment (object) )
+        {
+        case PANGO_ALIGN_CENTER:
+                justification = 'C';
+                break;
+        case PANGO_ALIGN_RIGHT:
+                justification = 'R';
+                break;
+        default:
+                justification = 'L';
+                break;
+        }
+
+        gl_label_object_get_extent (object, &extent);
+        gl_label_object_get_size (object, &w, &h);
+        font_dots = dots (zi, gl_label_object_get_font_size (object));
+
+        g_string_append_printf (zi->zpl, "^FO%d,%d^A0%c,%d,%d^FB%d,%d,0,%c,0",
+                                dots (zi, extent.x1), dots (zi, extent.y1),
+                                orientation, font_dots, font_dots,
+                                dots (zi, w), n_lines, justification);
+        append_field_data (zi->zpl, text);
+
+        g_free (text);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Box or ellipse object as graphic box/ellipse.                   */
+/*---------------------------------------------------------------------------*/
+static void
+zpl_box (ZplInfo       *zi,
+         glLabelObject *object,
+         gboolean       ellipse_flag)
+{
+        glLabelRegion  extent;
+        glColorNode   *color_node;
+        guint          fill_color, line_color;
+        gdouble        line_w;
+        gint           x, y, w, h;
+        const gchar   *command;
+
+        color_node = gl_label_object_get_fill_color (object);
+        fill_color = gl_color_node_expand (color_node, zi->record);
+        gl_color_node_free (&color_node);
+
+        color_node = gl_label_object_get_line_color (object);
+        line_color = gl_color_node_expand (color_node, zi->record);
+        gl_color_node_free (&color_node);
+
+        line_w = gl_label_object_get_line_width (object);
+
+        /* Extent includes outline, which ZPL draws inside the box. */
+        gl_label_object_get_extent (object, &extent);
+        x = dots (zi, extent.x1);
+        y = dots (zi, extent.y1);
+        w = MAX (1, dots (zi, extent.x2 - extent.x1));
+        h = MAX (1, dots (zi, extent.y2 - extent.y1));
+
+        command = ellipse_flag ? "GE" : "GB";
+
+        if ( GL_COLOR_F_ALPHA (fill_color) > 0.0 )
+        {
+                g_string_append_printf (zi->zpl, "^FO%d,%d^%s%d,%d,%d,%c^FS\n",
+                                        x, y, command, w, h, MIN (w, h),
+                                        color_to_zpl (fill_color));
+        }
+
+        if ( (GL_COLOR_F_ALPHA (line_color) > 0.0) && (line_w > 0.0) )
+        {
+                g_string_append_printf (zi->zpl, "^FO%d,%d^%s%d,%d,%d,%c^FS\n",
+                                        x, y, command, w, h, MAX (1, dots (zi, line_w)),
+                                        color_to_zpl (line_color));
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Line object as graphic box (straight) or diagonal line.         */
+/*---------------------------------------------------------------------------*/
+static void
+zpl_line (ZplInfo       *zi,
+          glLabelObject *object)
+{
+        glColorNode    *color_node;
+        guint           line_color;
+        cairo_matrix_t  matrix;
+        gdouble         x0, y0, dx, dy, line_w;
+        gint            thickness, x, y, w, h;
+
+        color_node = gl_label_object_get_line_color (object);
+        line_color = gl_color_node_expand (color_node, zi->record);
+        gl_color_node_free (&color_node);
+
+        line_w = gl_label_object_get_line_width (object);
+
+        if ( (GL_COLOR_F_ALPHA (line_color) == 0.0) || (line_w <= 0.0) )
+        {
+                return;
+        }
+
+        gl_label_object_get_position (object, &x0, &y0);
+        gl_label_object_get_size (object, &dx, &dy);
+        gl_label_object_get_matrix (object, &matrix);
+        cairo_matrix_transform_distance (&matrix, &dx, &dy);
+
+        thickness = MAX (1, dots (zi, line_w));
+        x = dots (zi, x0 + MIN (dx, 0.0));
+        y = dots (zi, y0 + MIN (dy, 0.0));
+        w = dots (zi, fabs (dx));
+        h = dots (zi, fabs (dy));
+
+        if ( (w == 0) || (h == 0) )
+        {
+                /* Straight line, centred on its path. */
+                if ( w == 0 )
+                {
+                        x -= thickness / 2;
+                }
+                else
+                {
+                        y -= thickness / 2;
+                }
+                g_string_append_printf (zi->zpl, "^FO%d,%d^GB%d,%d,%d,%c^FS\n",
+                                        x, y, MAX (w, thickness), MAX (h, thickness), thickness,
+                                        color_to_zpl (line_color));
+        }
+        else
+        {
+                g_string_append_printf (zi->zpl, "^FO%d,%d^GD%d,%d,%d,%c,%c^FS\n",
+                                        x, y, w, h, thickness,
+                                        color_to_zpl (line_color),
+                                        ((dx > 0) == (dy > 0)) ? 'L' : 'R');
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Barcode object as native barcode field.  Returns FALSE if the   */
+/* style has no ZPL equivalent.                                              */
+/*                                                                           */
+/* The data is encoded by the usual barcode backend first, both to validate  */
+/* it and to get the module (narrowest bar) width and bar height.  Bars come */
+/* narrowed for ink spread, which the printer does not expect of ^BY.        */
+/*---------------------------------------------------------------------------*/
+static gboolean
+zpl_barcode (ZplInfo       *zi,
+             glLabelObject *object,
+             gchar          orientation)
+{
+        const ZplBarcode *zb;
+        glTextNode       *text_node;
+        gchar            *id, *data, *digits;
+        const gchar      *p;
+        gboolean          text_flag, checksum_flag;
+        guint             format_digits;
+        gdouble           w, h, module_w, bar_h;
+        glBarcode        *gbc;
+        guint             i;
+        glLabelRegion     extent;
+        gint              module, height;
+        gchar             interp;
+
+        gl_label_barcode_get_props (GL_LABEL_BARCODE (object),
+                                    &id, &text_flag, &checksum_flag, &format_digits);
+
+        for ( zb = zpl_barcodes; zb->id != NULL; zb++ )
+        {
+                if ( strcmp (zb->id, id) == 0 )
+                {
+                        break;
+                }
+        }
+        if ( zb->id == NULL )
+        {
+                g_free (id);
+                return FALSE;
+        }
+
+        text_node = gl_label_barcode_get_data (GL_LABEL_BARCODE (object));
+        data = gl_text_node_expand (text_node, zi->record);
+        gl_text_node_free (&text_node);
+
+        gl_label_object_get_size (object, &w, &h);
+        gbc = gl_barcode_style_new (gl_label_barcode_get_style (GL_LABEL_BARCODE (object)),
+                                    text_flag, checksum_flag, w, h, data);
+        g_free (id);
+
+        gl_label_object_get_extent (object, &extent);
+        g_string_append_printf (zi->zpl, "^FO%d,%d", dots (zi, extent.x1), dots (zi, extent.y1));
+
+        if ( gbc == NULL )
+        {
+                /* Leave a note, as the PDF output shows an error message. */
+                g_string_append (zi->zpl, "^FXInvalid barcode data^FS\n");
+                g_free (data);
+                return TRUE;
+        }
+
+        module_w = (gbc->matrix != NULL) ? gbc->matrix->module_size : 0.0;
+        bar_h    = 0.0;
+        for ( i = 0; i < gbc->lines.n; i++ )
+        {
+                if ( (module_w == 0.0) || (gbc->lines.width[i] < module_w) )
+                {
+                        module_w = gbc->lines.width[i];
+                }
+                bar_h = MAX (bar_h, gbc->lines.length[i]);
+        }
+        if ( gbc->lines.n > 0 )
+        {
+                module_w += gbc->bar_shrink;
+        }
+        gl_barcode_free (&gbc);
+
+        module = MAX (1, dots (zi, module_w));
+        height = MAX (1, dots (zi, bar_h));
+        interp = text_flag ? 'Y' : 'N';
+
+        g_string_append_printf (zi->zpl, "^BY%d,3,%d", module, height);
+
+        switch (zb->type)
+        {
+        case ZPL_BC_CODE128:
+                g_string_append_printf (zi->zpl, "^BC%c,%d,%c,N,N,A", orientation, height, interp);
+                break;
+        case ZPL_BC_CODE39:
+                g_string_append_printf (zi->zpl, "^B3%c,%c,%d,%c,N", orientation,
+                                        checksum_flag ? 'Y' : 'N', height, interp);
+                break;
+        case ZPL_BC_CODE93:
+                g_string_append_printf (zi->zpl, "^BA%c,%d,%c,N,N", orientation, height, interp);
+                break;
+        case ZPL_BC_EAN13:
+                g_string_append_printf (zi->zpl, "^BE%c,%d,%c,N", orientation, height, interp);
+                break;
+        case ZPL_BC_EAN8:
+                g_string_append_printf (zi->zpl, "^B8%c,%d,%c,N", orientation, height, interp);
+                break;
+        case ZPL_BC_UPCA:
+                g_string_append_printf (zi->zpl, "^BU%c,%d,%c,N,Y", orientation, height, interp);
+                break;
+        case ZPL_BC_UPCE:
+                g_string_append_printf (zi->zpl, "^B9%c,%d,%c,N,Y", orientation, height, interp);
+                break;
+        case ZPL_BC_I25:
+                g_string_append_printf (zi->zpl, "^B2%c,%d,%c,N,%c", orientation, height, interp,
+                                        checksum_flag ? 'Y' : 'N');
+                break;
+        case ZPL_BC_POSTNET:
+                g_string_append_printf (zi->zpl, "^BZ%c,%d,N,N,0", orientation, height);
+                break;
+        case ZPL_BC_QR:
+                g_string_append_printf (zi->zpl, "^BQ%c,2,%d", orientation, MIN (module, 10));
+                break;
+        case ZPL_BC_DATAMATRIX:
+                g_string_append_printf (zi->zpl, "^BX%c,%d,200", orientation, module);
+                break;
+        }
+
+        switch (zb->type)
+        {
+        case ZPL_BC_POSTNET:
+        case ZPL_BC_EAN13:
+        case ZPL_BC_EAN8:
+        case ZPL_BC_UPCA:
+        case ZPL_BC_UPCE:
+        case ZPL_BC_I25:
+                /* Digits only, without the separators glabels accepts. */
+                digits = g_malloc0 (strlen (data) + 1);
+                for ( p = data; *p != '\0'; p++ )
+                {
+                        if ( g_ascii_isdigit (*p) )
+                        {
+                                digits[strlen (digits)] = *p;
+                        }
+                }
+                append_field_data (zi->zpl, digits);
+                g_free (digits);
+                break;
+        case ZPL_BC_QR:
+                /* Error correction level M, automatic data mode. */
+                digits = g_strconcat ("MA,", data, NULL);
+                append_field_data (zi->zpl, digits);
+                g_free (digits);
+                break;
+        default:
+                append_field_data (zi->zpl, data);
+                break;
+        }
+
+        g_free (data);
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Any object as a 1-bit graphic field.                            */
+/*---------------------------------------------------------------------------*/
+static void
+zpl_graphic (ZplInfo       *zi,
+             glLabelObject *object)
+{
+        glLabelRegion    extent;
+        cairo_surface_t *surface;
+        cairo_t         *cr;
+        gint             width, height, stride, bytes_per_row;
+        guchar          *data;
+        guint32          pixel;
+        guint            byte, luminance;
+        gint             x, y;
+
+        gl_label_object_get_extent (object, &extent);
+
+        width  = dots (zi, extent.x2 - extent.x1);
+        height = dots (zi, extent.y2 - extent.y1);
+        if ( (width <= 0) || (height <= 0) )
+        {
+                return;
+        }
+
+        surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+        cr = cairo_create (surface);
+
+        cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+        cairo_paint (cr);
+        cairo_scale (cr, zi->scale, zi->scale);
+        cairo_translate (cr, -extent.x1, -extent.y1);
+
+        gl_label_object_draw (object, cr, FALSE, zi->record);
+
+        cairo_destroy (cr);
+        cairo_surface_flush (surface);
+
+        data          = cairo_image_surface_get_data (surface);
+        stride        = cairo_image_surface_get_stride (surface);
+        bytes_per_row = (width + 7) / 8;
+
+        g_string_append_printf (zi->zpl, "^FO%d,%d^GFA,%d,%d,%d,",
+                                dots (zi, extent.x1), dots (zi, extent.y1),
+                                bytes_per_row * height, bytes_per_row * height, bytes_per_row);
+
+        for ( y = 0; y < height; y++ )
+        {
+                byte = 0;
+                for ( x = 0; x < width; x++ )
+                {
+                        pixel = ((guint32 *)(data + y * stride))[x];
+                        luminance = (  299 * ((pixel >> 16) & 0xff)
+                                     + 587 * ((pixel >> 8) & 0xff)
+                                     + 114 * (pixel & 0xff) ) / 1000;
+
+                        byte = (byte << 1) | (luminance < 128 ? 1 : 0);
+
+                        if ( (x % 8) == 7 )
+                        {
+                                g_string_append_printf (zi->zpl, "%02X", byte);
+                                byte = 0;
+                        }
+                }
+                if ( (width % 8) != 0 )
+                {
+                        byte <<= 8 - (width % 8);
+                        g_string_append_printf (zi->zpl, "%02X", byte);
+                }
+        }
+        g_string_append (zi->zpl, "^FS\n");
+
+        cairo_surface_destroy (surface);
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
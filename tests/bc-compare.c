@@ -0,0 +1,335 @@
+/*
+ *  bc-compare.c
+ *  Copyright (C) 2001-2009  Jim Evins <evins@snaught.com>.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Check the built-in linear barcode encoders (bc-builtin.c), for each style
+ * they cover, with and without text and checksum, at the natural size and
+ * scaled.  Only bars are checked: text placement may differ.
+ *
+ * The bar and space widths, in modules, are always checked against the
+ * reference patterns below.  These were decoded back to the data and check
+ * digits by hand from each symbology's specification.  When GNU Barcode is
+ * available, the bars are also compared exactly against the backend the
+ * built-in encoders replace.
+ *
+ * Exits non-zero, listing the differences on standard error, if any case
+ * does not match.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <math.h>
+#include <string.h>
+
+#include "bc.h"
+#include "bc-builtin.h"
+#ifdef HAVE_LIBBARCODE
+#include "bc-gnubarcode.h"
+#endif
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define EPSILON 1.0e-6
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        const gchar *id;
+        const gchar *digits;
+        const gchar *widths[2];  /* Bar, space, bar, ... widths in modules, */
+                                 /* without and with checksum.              */
+} Case;
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static const Case cases[] = {
+        { "EAN-13",   "400638133393",
+          { "11132111123111414113121122211111141114111411311214112221111",
+            "11132111123111414113121122211111141114111411311214112221111" } },
+        { "EAN-13",   "4006381333931",
+          { "11132111123111414113121122211111141114111411311214112221111",
+            "11132111123111414113121122211111141114111411311214112221111" } },
+        { "EAN-8",    "9638507",
+          { "1113112111414111213111111231321113121132111",
+            "1113112111414111213111111231321113121132111" } },
+        { "EAN-8",    "96385074",
+          { "1113112111414111213111111231321113121132111",
+            "1113112111414111213111111231321113121132111" } },
+        { "UPC-A",    "03600029145",
+          { "11132111411111432113211321111111212231122221113212312122111",
+            "11132111411111432113211321111111212231122221113212312122111" } },
+        { "UPC-A",    "036000291452",
+          { "11132111411111432113211321111111212231122221113212312122111",
+            "11132111411111432113211321111111212231122221113212312122111" } },
+        { "UPC-E",    "425261",
+          { "111231121221321221211142221111111",
+            "111231121221321221211142221111111" } },
+        { "UPC-E",    "04252614",
+          { "111231121221321221211142221111111",
+            "111231121221321221211142221111111" } },
+        { "Code39",   "GLABELS-3",
+          { "121121211111111221211121111221211112112111211211212111221111"
+            "1121111221112111221112111121212122111111121121211",
+            "121121211111111221211121111221211112112111211211212111221111"
+            "11211112211121112211121111212121221111111221111121121121211" } },
+        { "Code39",   "A1 $/+%.",
+          { "121121211121111211212112111121122111211112121211111212111211"
+            "121112121111121212112211112111121121211",
+            "121121211121111211212112111121122111211112121211111212111211"
+            "1211121211111212121122111121111211211121121121211" } },
+        { "Code128",  "Hello 123456",
+          { "211214231113112214221114221114134111212222113141112232131123"
+            "3311211142122331112",
+            "211214231113112214221114221114134111212222113141112232131123"
+            "3311211142122331112" } },
+        { "Code128",  "1234567890",
+          { "2112321122321311233311212411122141211242112331112",
+            "2112321122321311233311212411122141211242112331112" } },
+        { "Code128",  "ab12",
+          { "2112141211241214211232212232111122322331112",
+            "2112141211241214211232212232111122322331112" } },
+        { "Code128B", "glabels 3",
+          { "211214122114221114121124121421112214221114114212212222221132"
+            "1421122331112",
+            "211214122114221114121124121421112214221114114212212222221132"
+            "1421122331112" } },
+        { "Code128C", "12345678",
+          { "2112321122321311233311212411121331212331112",
+            "2112321122321311233311212411121331212331112" } },
+        { "I25",      "1234567",
+          { "11111311313113133311113113113311311131311313311",
+            "11113113111133313113111331133311111111133331311" } },
+        { "I25",      "1234567890",
+          { "111131131111333131131113311333111113111133311131133311311",
+            "111113113131131333111131131133113111313113133113113311131133"
+            "3111311" } },
+        { NULL }
+};
+
+static const gdouble sizes[][2] = {
+        {   0.0,  0.0 },
+        { 216.0, 72.0 },
+        {  36.0, 18.0 },
+};
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static gchar   *get_widths (glBarcode  *gbc);
+
+static gboolean compare (const Case *c,
+                         gboolean    text_flag,
+                         gboolean    checksum_flag,
+                         gdouble     w,
+                         gdouble     h);
+
+
+
+/*****************************************************************************/
+/* Main                                                                      */
+/*****************************************************************************/
+int
+main (int argc, char **argv)
+{
+        const Case *c;
+        guint       i;
+        gint        text_flag, checksum_flag;
+        gint        n_cases = 0, n_failed = 0;
+
+        for ( c = cases; c->id != NULL; c++ )
+        {
+                for ( i = 0; i < G_N_ELEMENTS (sizes); i++ )
+                {
+                        for ( text_flag = 0; text_flag < 2; text_flag++ )
+                        {
+                                for ( checksum_flag = 0; checksum_flag < 2; checksum_flag++ )
+                                {
+                                        n_cases++;
+                                        if ( !compare (c, text_flag, checksum_flag,
+                                                       sizes[i][0], sizes[i][1]) )
+                                        {
+                                                n_failed++;
+                                        }
+                                }
+                        }
+                }
+        }
+
+        g_print ("%d of %d cases match\n", n_cases - n_failed, n_cases);
+
+        return (n_failed == 0) ? 0 : 1;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Bar and space widths of gbc, in modules.                        */
+/*                                                                           */
+/* The narrowest bar or space is taken as one module, so this does not       */
+/* depend on the scale.                                                      */
+/*---------------------------------------------------------------------------*/
+static gchar *
+get_widths (glBarcode *gbc)
+{
+        GString *widths;
+        gdouble  module = 0.0, left, right, w;
+        guint    i;
+
+        /* Bars are drawn centred on x, narrowed by bar_shrink. */
+        for ( i = 0; i < gbc->lines.n; i++ )
+        {
+                w = gbc->lines.width[i] + gbc->bar_shrink;
+                if ( (module == 0.0) || (w < module) )
+                {
+                        module = w;
+                }
+                if ( i > 0 )
+                {
+                        left  = gbc->lines.x[i] - w/2;
+                        right = gbc->lines.x[i-1] + (gbc->lines.width[i-1] + gbc->bar_shrink)/2;
+                        if ( left - right < module )
+                        {
+                                module = left - right;
+                        }
+                }
+        }
+
+        widths = g_string_new ("");
+        for ( i = 0; i < gbc->lines.n; i++ )
+        {
+                w = gbc->lines.width[i] + gbc->bar_shrink;
+                if ( i > 0 )
+                {
+                        left  = gbc->lines.x[i] - w/2;
+                        right = gbc->lines.x[i-1] + (gbc->lines.width[i-1] + gbc->bar_shrink)/2;
+                        g_string_append_printf (widths, "%d", (gint)floor ((left - right)/module + 0.5));
+                }
+                g_string_append_printf (widths, "%d", (gint)floor (w/module + 0.5));
+        }
+
+        return g_string_free (widths, FALSE);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Encode one case, and compare the bars against the reference     */
+/* widths and, when available, against GNU Barcode.                          */
+/*---------------------------------------------------------------------------*/
+static gboolean
+compare (const Case *c,
+         gboolean    text_flag,
+         gboolean    checksum_flag,
+         gdouble     w,
+         gdouble     h)
+{
+        glBarcode *builtin;
+        gchar     *widths;
+        gboolean   ok = TRUE;
+#ifdef HAVE_LIBBARCODE
+        glBarcode *gnu;
+        guint      i;
+#endif
+
+        builtin = gl_barcode_builtin_new (c->id, text_flag, checksum_flag, w, h, c->digits);
+        if ( builtin == NULL )
+        {
+                g_printerr ("%s \"%s\" text=%d checksum=%d %gx%g: builtin backend rejects data\n",
+                            c->id, c->digits, text_flag, checksum_flag, w, h);
+                return FALSE;
+        }
+
+        widths = get_widths (builtin);
+        if ( strcmp (widths, c->widths[checksum_flag]) != 0 )
+        {
+                g_printerr ("%s \"%s\" text=%d checksum=%d %gx%g: widths are %s, expected %s\n",
+                            c->id, c->digits, text_flag, checksum_flag, w, h,
+                            widths, c->widths[checksum_flag]);
+                ok = FALSE;
+        }
+        g_free (widths);
+
+#ifdef HAVE_LIBBARCODE
+        gnu = gl_barcode_gnubarcode_new (c->id, text_flag, checksum_flag, w, h, c->digits);
+
+        if ( gnu == NULL )
+        {
+                g_printerr ("%s \"%s\" text=%d checksum=%d %gx%g: GNU Barcode backend rejects data\n",
+                            c->id, c->digits, text_flag, checksum_flag, w, h);
+                ok = FALSE;
+        }
+        else if ( builtin->lines.n != gnu->lines.n )
+        {
+                g_printerr ("%s \"%s\" text=%d checksum=%d %gx%g: %u bars, expected %u\n",
+                            c->id, c->digits, text_flag, checksum_flag, w, h,
+                            builtin->lines.n, gnu->lines.n);
+                ok = FALSE;
+        }
+        else
+        {
+                for ( i = 0; i < gnu->lines.n; i++ )
+                {
+                        if ( (fabs (builtin->lines.x[i] - gnu->lines.x[i]) > EPSILON) ||
+                             (fabs (builtin->lines.y[i] - gnu->lines.y[i]) > EPSILON) ||
+                             (fabs (builtin->lines.length[i] - gnu->lines.length[i]) > EPSILON) ||
+                             (fabs (builtin->lines.width[i] - gnu->lines.width[i]) > EPSILON) )
+                        {
+                                g_printerr ("%s \"%s\" text=%d checksum=%d %gx%g: bar %u is"
+                                            " (%g,%g %gx%g), expected (%g,%g %gx%g)\n",
+                                            c->id, c->digits, text_flag, checksum_flag, w, h, i,
+                                            builtin->lines.x[i], builtin->lines.y[i],
+                                            builtin->lines.width[i], builtin->lines.length[i],
+                                            gnu->lines.x[i], gnu->lines.y[i],
+                                            gnu->lines.width[i], gnu->lines.length[i]);
+                                ok = FALSE;
+                                break;
+                        }
+                }
+        }
+
+        gl_barcode_free (&gnu);
+#endif
+
+        gl_barcode_free (&builtin);
+
+        return ok;
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
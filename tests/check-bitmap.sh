@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Golden output test for glabels-3-batch --bitmap.
+#
+# The bitmap/grey.glabels fixture is printed at 72 dpi, so that its points
+# map one to one onto dots, with each dither and with and without --rle, and
+# the result compared with bitmap/grey-DITHER[-rle].bin.  The fixture has a
+# 50% grey, a 25% grey and a black area, and two blank lines at the bottom:
+# threshold dithering keeps only the darker grey, ordered dithering turns
+# the greys into patterns, and PackBits sees both runs and literals.
+#
+
+: ${srcdir=.}
+: ${top_builddir=..}
+
+batch=$top_builddir/src/glabels-3-batch
+status=0
+
+# Opening a label registers its template in the user's configuration.
+XDG_CONFIG_HOME=`pwd`/bitmap-config
+export XDG_CONFIG_HOME
+
+for test in threshold: threshold:--rle ordered: ordered:--rle
+do
+        dither=${test%:*}
+        rle=${test#*:}
+        name=grey-$dither${rle:+-rle}
+
+        if ! $batch --bitmap $dither $rle --dpi 72 -o bitmap-$name.out $srcdir/bitmap/grey.glabels > /dev/null
+        then
+                echo "FAIL: $name: glabels-3-batch failed"
+                status=1
+        elif ! cmp $srcdir/bitmap/$name.bin bitmap-$name.out
+        then
+                echo "FAIL: $name: output differs from bitmap/$name.bin"
+                status=1
+        else
+                echo "PASS: $name"
+                rm -f bitmap-$name.out
+        fi
+done
+
+rm -rf bitmap-config
+
+exit $status
@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Golden output test for glabels-3-batch --zpl.
+#
+# Each zpl/NAME.glabels fixture is printed as ZPL at the resolution listed
+# below, and the result compared with zpl/NAME.zpl.  The image fixture is
+# printed at 72 dpi, so that its pixels map one to one onto printer dots.
+#
+
+: ${srcdir=.}
+: ${top_builddir=..}
+
+batch=$top_builddir/src/glabels-3-batch
+status=0
+
+# Opening a label registers its template in the user's configuration.
+XDG_CONFIG_HOME=`pwd`/zpl-config
+export XDG_CONFIG_HOME
+
+for test in box:203 line:203 image:72 barcode:203
+do
+        name=${test%:*}
+        dpi=${test#*:}
+
+        if ! $batch --zpl --dpi $dpi -o zpl-$name.out $srcdir/zpl/$name.glabels > /dev/null
+        then
+                echo "FAIL: $name: glabels-3-batch failed"
+                status=1
+        elif ! diff -u $srcdir/zpl/$name.zpl zpl-$name.out
+        then
+                echo "FAIL: $name: output differs from zpl/$name.zpl"
+                status=1
+        else
+                echo "PASS: $name"
+                rm -f zpl-$name.out
+        fi
+done
+
+rm -rf zpl-config
+
+exit $status